@@ -0,0 +1,97 @@
+#include "arena.h"
+#include <new>
+
+const size_t ARENA_BLOCK_SIZE = 65536;
+const size_t ARENA_ALIGN = 8;
+
+Arena* Arena::current = NULL;
+
+//---Arena---
+
+Arena::Arena():
+    block_cur(NULL),
+    block_left(0),
+    objects(NULL),
+    previous(current)
+{
+    current = this;
+}
+
+Arena::~Arena()
+{
+    Clear();
+    current = previous;
+}
+
+void* Arena::Allocate(size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (block_left < size)
+    {
+        size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        blocks.push_back((char*)malloc(block_size));
+        if (blocks.back() == NULL) throw std::bad_alloc();
+        block_cur = blocks.back();
+        block_left = block_size;
+    }
+    void* res = block_cur;
+    block_cur += size;
+    block_left -= size;
+    return res;
+}
+
+void Arena::Clear()
+{
+    for (Header* it = objects; it != NULL; it = it->next)
+        if (it->arena != NULL) ((ArenaObject*)(it + 1))->~ArenaObject();
+    objects = NULL;
+    for (std::vector<char*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+        free(*it);
+    blocks.clear();
+    block_cur = NULL;
+    block_left = 0;
+}
+
+void* Arena::New(size_t size)
+{
+    Header* header;
+    if (current == NULL)
+    {
+        header = (Header*)malloc(sizeof(Header) + size);
+        if (header == NULL) throw std::bad_alloc();
+        header->arena = NULL;
+        header->next = NULL;
+    }
+    else
+    {
+        header = (Header*)current->Allocate(sizeof(Header) + size);
+        header->arena = current;
+        header->next = current->objects;
+        current->objects = header;
+    }
+    return header + 1;
+}
+
+void Arena::Delete(void* ptr)
+{
+    if (ptr == NULL) return;
+    Header* header = (Header*)ptr - 1;
+    if (header->arena == NULL) free(header);
+    else header->arena = NULL;
+}
+
+//---ArenaObject---
+
+ArenaObject::~ArenaObject()
+{
+}
+
+void* ArenaObject::operator new(size_t size)
+{
+    return Arena::New(size);
+}
+
+void ArenaObject::operator delete(void* ptr)
+{
+    Arena::Delete(ptr);
+}
@@ -0,0 +1,39 @@
+#ifndef ARENA
+#define ARENA
+
+#include <stdlib.h>
+#include <vector>
+
+class ArenaObject;
+
+class Arena{
+private:
+    struct Header{
+        Arena* arena;
+        Header* next;
+    };
+    std::vector<char*> blocks;
+    char* block_cur;
+    size_t block_left;
+    Header* objects;
+    Arena* previous;
+    static Arena* current;
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+public:
+    Arena();
+    ~Arena();
+    void* Allocate(size_t size);
+    void Clear();
+    static void* New(size_t size);
+    static void Delete(void* ptr);
+};
+
+class ArenaObject{
+public:
+    virtual ~ArenaObject();
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+};
+
+#endif
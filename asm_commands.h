@@ -46,17 +46,41 @@ enum RegisterName{
     REG_ST4,
     REG_ST5,
     REG_ST6,
-    REG_ST7
+    REG_ST7,
+    REG_XMM0,
+    REG_XMM1,
+    REG_R11D,
+    REG_R12D,
+    REG_R13D,
+    REG_R14D,
+    REG_R15D,
+    REG_RAX,
+    REG_RBX,
+    REG_RCX,
+    REG_RDX,
+    REG_RDI,
+    REG_RSI,
+    REG_RBP,
+    REG_RSP,
+    REG_R11,
+    REG_R12,
+    REG_R13,
+    REG_R14,
+    REG_R15
 };
 
 extern const string REG_TO_STR[];
 
 enum AsmCmdName{
     ASM_ADD,
+    ASM_ADDSS,
     ASM_AND,
     ASM_CALL,
     ASM_CMP,
+    ASM_CVTSI2SS,
+    ASM_CVTSS2SD,
     ASM_DIV,
+    ASM_DIVSS,
     ASM_FADDP,
     ASM_FCH,
     ASM_FCOMPP,
@@ -70,6 +94,12 @@ enum AsmCmdName{
     ASM_FXCH,
     ASM_IDIV,
     ASM_IMUL,
+    ASM_JA,
+    ASM_JAE,
+    ASM_JB,
+    ASM_JBE,
+    ASM_JG,
+    ASM_JL,
     ASM_JMP,
     ASM_JNE,
     ASM_JNG,
@@ -78,8 +108,11 @@ enum AsmCmdName{
     ASM_JZ,
     ASM_LEA,
     ASM_MOV,
+    ASM_MOVSD,
+    ASM_MOVSS,
     ASM_MOVZB,
     ASM_MUL,
+    ASM_MULSS,
     ASM_NEG ,
     ASM_NOT,
     ASM_OR,
@@ -100,12 +133,30 @@ enum AsmCmdName{
     ASM_SETE,
     ASM_SETNE, 
     ASM_SUB,
+    ASM_SUBSS,
     ASM_TEST,
+    ASM_UCOMISS,
     ASM_XOR
 };
 
 extern const string ASM_CMD_TO_STR[];
 
+enum AsmCmdClass{
+    CMD_RAW,
+    CMD_LABEL,
+    CMD_0,
+    CMD_1,
+    CMD_2
+};
+
+enum AsmOperandClass{
+    OPERAND_NONE,
+    OPERAND_REGISTER,
+    OPERAND_INT,
+    OPERAND_STR,
+    OPERAND_MEMORY
+};
+
 enum AsmDataType{
     DATA_UNTYPED,
     DATA_INT,
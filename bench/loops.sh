@@ -0,0 +1,34 @@
+#!/bin/sh
+# Optimizer benchmark: deeply nested loops with many statements on each level.
+# Usage: sh loops.sh [depth] [statements per level] [variables]
+# COMPILER environment variable overrides the compiler binary (../debug).
+
+depth=${1:-160}
+stmts=${2:-100}
+vars=${3:-200}
+src=loops.pas
+
+awk -v depth=$depth -v stmts=$stmts -v vars=$vars 'BEGIN {
+	print "var";
+	for (d = 1; d <= depth; d++) print "  i" d ": integer;";
+	for (v = 1; v <= vars; v++) print "  v" v ": integer;";
+	print "begin";
+	srand(1);
+	for (d = 1; d <= depth; d++) {
+		print "for i" d " := 1 to 2 do";
+		print "begin";
+		for (s = 1; s <= stmts; s++) {
+			a = int(rand() * vars) + 1; b = int(rand() * vars) + 1;
+			print "  v" a " := v" b " + i" int(rand() * d) + 1 ";";
+		}
+	}
+	for (d = 1; d <= depth; d++) print "end;";
+	print "end.";
+}' > $src
+
+echo "depth $depth, $stmts statements per level, $vars variables"
+start=$(date +%s%N)
+${COMPILER:-../debug} -B $src > /dev/null
+end=$(date +%s%N)
+echo "$(( (end - start) / 1000000 )) ms"
+rm -f $src
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Optimizer benchmark: a ring of mutually recursive procedures.
+# Usage: sh recursion.sh [procedures] [calls per procedure]
+# COMPILER environment variable overrides the compiler binary (../debug).
+
+procs=${1:-16}
+calls=${2:-4}
+src=recursion.pas
+
+awk -v procs=$procs -v calls=$calls 'BEGIN {
+	printf "var";
+	for (p = 1; p <= procs; p++) printf " g%d%s", p, p < procs ? "," : ": integer;\n";
+	for (p = 1; p <= procs; p++) print "procedure p" p "(n: integer); forward;";
+	for (p = 1; p <= procs; p++) {
+		print "procedure p" p "(n: integer);";
+		print "begin";
+		print "  if n > 0 then";
+		print "  begin";
+		print "    g" p " := g" p " + n;";
+		for (c = 1; c <= calls; c++) print "    p" (p + c - 1) % procs + 1 "(n - " c ");";
+		print "  end;";
+		print "end;";
+	}
+	print "begin";
+	print "  p1(10);";
+	print "end.";
+}' > $src
+
+echo "$procs procedures, $calls calls each"
+start=$(date +%s%N)
+${COMPILER:-../debug} -B $src > /dev/null
+end=$(date +%s%N)
+echo "$(( (end - start) / 1000000 )) ms"
+rm -f $src
@@ -0,0 +1,35 @@
+#!/bin/sh
+# Parser benchmark: deeply nested procedures with many locals each.
+# Usage: sh scopes.sh [depth] [locals per level] [statements in innermost body]
+# COMPILER environment variable overrides the compiler binary (../debug).
+
+depth=${1:-300}
+locals=${2:-300}
+stmts=${3:-20000}
+src=scopes.pas
+
+awk -v depth=$depth -v locals=$locals -v stmts=$stmts 'BEGIN {
+	print "var g: integer;";
+	for (d = 1; d <= depth; d++) {
+		print "procedure p" d ";";
+		print "var";
+		for (i = 1; i <= locals; i++) print "  v" d "_" i ": integer;";
+	}
+	print "begin";
+	srand(1);
+	for (s = 1; s <= stmts; s++) {
+		d1 = int(rand() * depth) + 1; i1 = int(rand() * locals) + 1;
+		d2 = int(rand() * depth) + 1; i2 = int(rand() * locals) + 1;
+		print "  v" d1 "_" i1 " := v" d2 "_" i2 " + g;";
+	}
+	print "end;";
+	for (d = 1; d < depth; d++) print "begin end;";
+	print "begin end.";
+}' > $src
+
+echo "depth $depth, $locals locals per level, $stmts statements"
+start=$(date +%s%N)
+${COMPILER:-../debug} -s $src > /dev/null
+end=$(date +%s%N)
+echo "$(( (end - start) / 1000000 )) ms"
+rm -f $src
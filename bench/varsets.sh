@@ -0,0 +1,30 @@
+#!/bin/sh
+# Optimizer benchmark: one loop body over many global variables.
+# Usage: sh varsets.sh [variables] [statements in the loop body]
+# COMPILER environment variable overrides the compiler binary (../debug).
+
+vars=${1:-2000}
+stmts=${2:-20000}
+src=varsets.pas
+
+awk -v vars=$vars -v stmts=$stmts 'BEGIN {
+	print "var i: integer;";
+	for (v = 1; v <= vars; v++) print "  v" v ": integer;";
+	print "begin";
+	print "  for i := 1 to 10 do";
+	print "  begin";
+	srand(1);
+	for (s = 1; s <= stmts; s++) {
+		a = int(rand() * vars) + 1; b = int(rand() * vars) + 1; c = int(rand() * vars) + 1;
+		print "    v" a " := v" b " + v" c ";";
+	}
+	print "  end;";
+	print "end.";
+}' > $src
+
+echo "$vars variables, $stmts statements"
+start=$(date +%s%N)
+${COMPILER:-../debug} -B $src > /dev/null
+end=$(date +%s%N)
+echo "$(( (end - start) / 1000000 )) ms"
+rm -f $src
@@ -0,0 +1,314 @@
+#include "bytecode.h"
+#include "sym_table.h"
+#include "exception.h"
+
+//---BCProgram---
+
+BCProgram::BCProgram():
+    globals_size(BC_GLOBALS_BASE),
+    main_temps_size(0)
+{
+}
+
+//---BCBuilder---
+
+BCBuilder::BCBuilder(BCProgram& program_, unsigned params_offset_):
+    program(program_),
+    params_offset(params_offset_),
+    in_main(true),
+    temps_base(0),
+    temps_size(0),
+    max_temps_size(0),
+    exit_label(BC_NO_LABEL)
+{
+}
+
+void BCBuilder::AddGlobal(const SymVar* var)
+{
+    globals[var] = program.globals_size;
+    program.globals_size += (var->GetVarType()->GetSize() + 3) & ~3;
+}
+
+int BCBuilder::GlobalAddr(const SymVar* var) const
+{
+    std::map<const SymVar*, int>::const_iterator it = globals.find(var);
+    if (it == globals.end()) throw CompilerException("unknown global variable");
+    return it->second;
+}
+
+unsigned BCBuilder::FunctionIndex(SymProc* proc)
+{
+    std::map<const SymProc*, unsigned>::iterator it = functions.find(proc);
+    if (it != functions.end()) return it->second;
+    BCFunction func = { 0, params_offset + proc->GetSymTable()->GetParamsSize(), 0 };
+    program.functions.push_back(func);
+    pending.push_back(proc);
+    return functions[proc] = program.functions.size() - 1;
+}
+
+void BCBuilder::BuildBody(NodeStatement* body, bool main, int temps_base_)
+{
+    in_main = main;
+    temps_base = temps_base_;
+    temps_size = max_temps_size = 0;
+    exit_label = NewLabel();
+    loops.clear();
+    body->GenerateBC(*this);
+    BindLabel(exit_label);
+    Emit(BC_RET);
+}
+
+void BCBuilder::Build(NodeStatement* body)
+{
+    BuildBody(body, true, program.globals_size);
+    program.main_temps_size = max_temps_size;
+    while (!pending.empty())
+    {
+        SymProc* proc = pending.back();
+        pending.pop_back();
+        unsigned locals_size = proc->GetSymTable()->GetLocalsSize();
+        BCFunction& func = program.functions[functions[proc]];
+        func.entry = program.code.size();
+        BuildBody(proc->GetBody(), false, -(int)locals_size - 4);
+        program.functions[functions[proc]].frame_size = locals_size + 4 + max_temps_size;
+    }
+    for (std::vector<Fixup>::const_iterator it = fixups.begin(); it != fixups.end(); ++it)
+        program.code[it->pos].c = labels[it->label];
+}
+
+int BCBuilder::NewTemp(unsigned size)
+{
+    int reg = in_main ? temps_base + temps_size : temps_base - (int)(temps_size + size);
+    temps_size += size;
+    max_temps_size = max(max_temps_size, temps_size);
+    return reg;
+}
+
+unsigned BCBuilder::GetTempsMark() const
+{
+    return temps_size;
+}
+
+void BCBuilder::ReleaseTemps(unsigned mark)
+{
+    temps_size = mark;
+}
+
+bool BCBuilder::IsTemp(int reg) const
+{
+    return in_main ? reg >= temps_base : reg < temps_base;
+}
+
+int BCBuilder::Snapshot(int reg, unsigned size)
+{
+    int res = NewTemp(size);
+    Move(res, reg, size);
+    return res;
+}
+
+void BCBuilder::Emit(BCOpcode op, int a, int b, int c)
+{
+    BCInstr instr = { op, a, b, c };
+    program.code.push_back(instr);
+}
+
+int BCBuilder::Const(int value)
+{
+    int res = NewTemp();
+    Emit(BC_LDI, res, value);
+    return res;
+}
+
+int BCBuilder::String(const string& value)
+{
+    std::map<string, int>::iterator it = strings.find(value);
+    if (it == strings.end())
+    {
+        it = strings.insert(make_pair(value, (int)program.strings.size())).first;
+        program.strings += value;
+        program.strings += '\0';
+    }
+    int res = NewTemp();
+    Emit(BC_LDS, res, it->second);
+    return res;
+}
+
+int BCBuilder::Binary(BCOpcode op, int a, int b)
+{
+    int res = IsTemp(a) ? a : IsTemp(b) ? b : NewTemp();
+    Emit(op, res, a, b);
+    return res;
+}
+
+int BCBuilder::Unary(BCOpcode op, int a)
+{
+    int res = IsTemp(a) ? a : NewTemp();
+    Emit(op, res, a);
+    return res;
+}
+
+int BCBuilder::BinaryImm(BCOpcode op, int a, int value)
+{
+    int res = IsTemp(a) ? a : NewTemp();
+    Emit(op, res, a, value);
+    return res;
+}
+
+int BCBuilder::VarCell(const SymVar* var) const
+{
+    if (var->GetClassName() & SYM_VAR_GLOBAL) return in_main ? GlobalAddr(var) : BC_NO_REG;
+    if (var->GetClassName() & SYM_VAR_LOCAL) return -(int)((SymVarLocal*)var)->GetOffset() - 4;
+    if ((var->GetClassName() & SYM_VAR_PARAM) && !((SymVarParam*)var)->IsByRef())
+        return ((SymVarParam*)var)->GetOffset();
+    return BC_NO_REG;
+}
+
+int BCBuilder::LoadVar(const SymVar* var)
+{
+    unsigned size = var->GetVarType()->GetSize();
+    int cell = VarCell(var);
+    if (cell != BC_NO_REG) return cell;
+    if (!(var->GetClassName() & SYM_VAR_GLOBAL)) return Load(((SymVarParam*)var)->GetOffset(), 0, size);
+    if (size != 4) return Load(Const(GlobalAddr(var)), 0, size);
+    int res = NewTemp();
+    Emit(BC_LDG, res, GlobalAddr(var));
+    return res;
+}
+
+void BCBuilder::StoreVar(const SymVar* var, int value)
+{
+    unsigned size = var->GetVarType()->GetSize();
+    int cell = VarCell(var);
+    if (cell != BC_NO_REG)
+        Move(cell, value, size);
+    else if (!(var->GetClassName() & SYM_VAR_GLOBAL))
+        Store(((SymVarParam*)var)->GetOffset(), 0, value, size);
+    else if (size != 4)
+        Store(Const(GlobalAddr(var)), 0, value, size);
+    else
+        Emit(BC_STG, GlobalAddr(var), value);
+}
+
+int BCBuilder::VarAddr(const SymVar* var)
+{
+    if (var->GetClassName() & SYM_VAR_GLOBAL) return Const(GlobalAddr(var));
+    int cell = VarCell(var);
+    if (cell == BC_NO_REG) return ((SymVarParam*)var)->GetOffset();
+    return CellAddr(cell);
+}
+
+int BCBuilder::CellAddr(int cell)
+{
+    int res = NewTemp();
+    Emit(BC_LEA, res, cell);
+    return res;
+}
+
+int BCBuilder::Load(int addr, int offset, unsigned size)
+{
+    int res = NewTemp(size);
+    if (size == 4)
+    {
+        Emit(BC_LOAD, res, addr, offset);
+        return res;
+    }
+    if (offset) addr = BinaryImm(BC_ADDI, addr, offset);
+    Emit(BC_BLOAD, res, addr, size);
+    return res;
+}
+
+void BCBuilder::Store(int addr, int offset, int value, unsigned size)
+{
+    if (size == 4)
+    {
+        Emit(BC_STORE, addr, offset, value);
+        return;
+    }
+    if (offset) addr = BinaryImm(BC_ADDI, addr, offset);
+    Emit(BC_BSTORE, addr, value, size);
+}
+
+void BCBuilder::Move(int dst, int src, unsigned size)
+{
+    if (dst == src) return;
+    if (size == 4) Emit(BC_MOV, dst, src);
+    else Emit(BC_BMOV, dst, src, size);
+}
+
+int BCBuilder::Call(SymProc* proc, const std::vector<int>& args)
+{
+    unsigned index = FunctionIndex(proc);
+    int args_size = program.functions[index].args_size;
+    for (unsigned i = 0; i < args.size(); ++i)
+    {
+        const SymVarParam* param = proc->GetArg(i);
+        unsigned size = param->IsByRef() ? 4 : param->GetVarType()->GetSize();
+        if (size == 4) Emit(BC_ARG, param->GetOffset() - args_size, args[i]);
+        else Emit(BC_BARG, param->GetOffset() - args_size, args[i], size);
+    }
+    Emit(BC_CALL, index);
+    unsigned size = proc->GetResultType()->GetSize();
+    if (!size) return BC_NO_REG;
+    int res = NewTemp(size);
+    if (size == 4) Emit(BC_RES, res, -(int)size);
+    else Emit(BC_BRES, res, -(int)size, size);
+    return res;
+}
+
+int BCBuilder::NewLabel()
+{
+    labels.push_back(BC_NO_LABEL);
+    return labels.size() - 1;
+}
+
+void BCBuilder::BindLabel(int label)
+{
+    labels[label] = program.code.size();
+}
+
+void BCBuilder::Jump(int label)
+{
+    Branch(BC_JMP, 0, 0, label);
+}
+
+void BCBuilder::Branch(BCOpcode op, int a, int b, int label)
+{
+    Fixup fixup = { (unsigned)program.code.size(), label };
+    fixups.push_back(fixup);
+    Emit(op, a, b);
+}
+
+void BCBuilder::PushLoop(const StmtLoop* loop, int break_label, int continue_label)
+{
+    LoopLabels labels = { loop, break_label, continue_label };
+    loops.push_back(labels);
+}
+
+void BCBuilder::PopLoop()
+{
+    loops.pop_back();
+}
+
+const BCBuilder::LoopLabels* BCBuilder::FindLoop(const StmtLoop* loop) const
+{
+    for (std::vector<LoopLabels>::const_reverse_iterator it = loops.rbegin(); it != loops.rend(); ++it)
+        if (it->loop == loop) return &*it;
+    return NULL;
+}
+
+int BCBuilder::GetBreakLabel(const StmtLoop* loop) const
+{
+    const LoopLabels* labels = FindLoop(loop);
+    return labels != NULL ? labels->break_label : exit_label;
+}
+
+int BCBuilder::GetContinueLabel(const StmtLoop* loop) const
+{
+    const LoopLabels* labels = FindLoop(loop);
+    return labels != NULL ? labels->continue_label : exit_label;
+}
+
+int BCBuilder::GetExitLabel() const
+{
+    return exit_label;
+}
@@ -0,0 +1,168 @@
+#ifndef BYTECODE
+#define BYTECODE
+
+#include <vector>
+#include <map>
+#include <string>
+
+using namespace std;
+
+class SymVar;
+class SymProc;
+class NodeStatement;
+class StmtLoop;
+
+enum BCOpcode{
+    BC_MOV,
+    BC_LDI,
+    BC_LDS,
+    BC_LDG,
+    BC_STG,
+    BC_LEA,
+    BC_LOAD,
+    BC_STORE,
+    BC_BMOV,
+    BC_BLOAD,
+    BC_BSTORE,
+    BC_ADD,
+    BC_ADDI,
+    BC_SUB,
+    BC_MUL,
+    BC_MULI,
+    BC_DIV,
+    BC_MOD,
+    BC_AND,
+    BC_OR,
+    BC_XOR,
+    BC_SHL,
+    BC_SHR,
+    BC_EQ,
+    BC_NE,
+    BC_LT,
+    BC_LE,
+    BC_GT,
+    BC_GE,
+    BC_NEG,
+    BC_NOT,
+    BC_FADD,
+    BC_FSUB,
+    BC_FMUL,
+    BC_FDIV,
+    BC_FEQ,
+    BC_FNE,
+    BC_FLT,
+    BC_FLE,
+    BC_FGT,
+    BC_FGE,
+    BC_FNEG,
+    BC_ITOF,
+    BC_JMP,
+    BC_JZ,
+    BC_JNZ,
+    BC_JLE,
+    BC_JGE,
+    BC_ARG,
+    BC_BARG,
+    BC_CALL,
+    BC_RES,
+    BC_BRES,
+    BC_RET,
+    BC_WRITEI,
+    BC_WRITEF,
+    BC_WRITES,
+    BC_WRITELN,
+    BC_OPCODES_COUNT
+};
+
+const int BC_NO_REG = 0x7FFFFFFF;
+const int BC_NO_LABEL = -1;
+const unsigned BC_GLOBALS_BASE = 16;
+
+struct BCInstr{
+    BCOpcode op;
+    int a;
+    int b;
+    int c;
+};
+
+struct BCFunction{
+    unsigned entry;
+    unsigned args_size;
+    unsigned frame_size;
+};
+
+class BCProgram{
+public:
+    std::vector<BCInstr> code;
+    std::vector<BCFunction> functions;
+    string strings;
+    unsigned globals_size;
+    unsigned main_temps_size;
+    BCProgram();
+};
+
+class BCBuilder{
+private:
+    struct LoopLabels{
+        const StmtLoop* loop;
+        int break_label;
+        int continue_label;
+    };
+    struct Fixup{
+        unsigned pos;
+        int label;
+    };
+    BCProgram& program;
+    unsigned params_offset;
+    std::map<const SymVar*, int> globals;
+    std::map<const SymProc*, unsigned> functions;
+    std::vector<SymProc*> pending;
+    std::map<string, int> strings;
+    std::vector<int> labels;
+    std::vector<Fixup> fixups;
+    std::vector<LoopLabels> loops;
+    bool in_main;
+    int temps_base;
+    unsigned temps_size;
+    unsigned max_temps_size;
+    int exit_label;
+    const LoopLabels* FindLoop(const StmtLoop* loop) const;
+    unsigned FunctionIndex(SymProc* proc);
+    int GlobalAddr(const SymVar* var) const;
+    void BuildBody(NodeStatement* body, bool main, int temps_base_);
+public:
+    BCBuilder(BCProgram& program_, unsigned params_offset_);
+    void AddGlobal(const SymVar* var);
+    void Build(NodeStatement* body);
+    int NewTemp(unsigned size = 4);
+    unsigned GetTempsMark() const;
+    void ReleaseTemps(unsigned mark);
+    bool IsTemp(int reg) const;
+    int Snapshot(int reg, unsigned size = 4);
+    void Emit(BCOpcode op, int a = 0, int b = 0, int c = 0);
+    int Const(int value);
+    int String(const string& value);
+    int Binary(BCOpcode op, int a, int b);
+    int Unary(BCOpcode op, int a);
+    int BinaryImm(BCOpcode op, int a, int value);
+    int VarCell(const SymVar* var) const;
+    int LoadVar(const SymVar* var);
+    void StoreVar(const SymVar* var, int value);
+    int VarAddr(const SymVar* var);
+    int CellAddr(int cell);
+    int Load(int addr, int offset, unsigned size);
+    void Store(int addr, int offset, int value, unsigned size);
+    void Move(int dst, int src, unsigned size);
+    int Call(SymProc* proc, const std::vector<int>& args);
+    int NewLabel();
+    void BindLabel(int label);
+    void Jump(int label);
+    void Branch(BCOpcode op, int a, int b, int label);
+    void PushLoop(const StmtLoop* loop, int break_label, int continue_label);
+    void PopLoop();
+    int GetBreakLabel(const StmtLoop* loop) const;
+    int GetContinueLabel(const StmtLoop* loop) const;
+    int GetExitLabel() const;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "call_graph.h"
+
+//---CallGraph---
+
+CallGraph::CallGraph(SymTable* sym_table)
+{
+    AddProcs(sym_table);
+    for (std::vector<SymProc*>::iterator it = procs.begin(); it != procs.end(); ++it)
+        if (index.find(*it) == index.end()) FindComponents(*it);
+}
+
+void CallGraph::AddProcs(SymTable* sym_table)
+{
+    const std::vector<Symbol*>& symbols = sym_table->GetSymbols();
+    for (std::vector<Symbol*>::const_iterator it = symbols.begin(); it != symbols.end(); ++it)
+    {
+        if (!((*it)->GetClassName() & SYM_PROC)) continue;
+        SymProc* proc = (SymProc*)*it;
+        procs.push_back(proc);
+        proc->GetAllCalls(calls[proc]);
+        AddProcs(proc->GetSymTable());
+    }
+}
+
+void CallGraph::FindComponents(SymProc* proc)
+{
+    unsigned num = index.size();
+    index[proc] = num;
+    low_link[proc] = num;
+    stack.push_back(proc);
+    ProcsContainer& callees = calls[proc];
+    for (ProcsContainer::iterator it = callees.begin(); it != callees.end(); ++it)
+    {
+        if (index.find(*it) == index.end())
+        {
+            FindComponents(*it);
+            low_link[proc] = std::min(low_link[proc], low_link[*it]);
+        }
+        else if (std::find(stack.begin(), stack.end(), *it) != stack.end())
+            low_link[proc] = std::min(low_link[proc], index[*it]);
+    }
+    if (low_link[proc] != index[proc]) return;
+    components.push_back(std::vector<SymProc*>());
+    SymProc* top;
+    do
+    {
+        top = stack.back();
+        stack.pop_back();
+        components.back().push_back(top);
+    } while (top != proc);
+    const std::vector<SymProc*>& component = components.back();
+    if (component.size() > 1 || calls[proc].count(proc))
+        recursive.insert(component.begin(), component.end());
+}
+
+void CallGraph::SolveComponent(const std::vector<SymProc*>& component)
+{
+    if (!IsRecursive(component.front()))
+    {
+        component.front()->UpdateSummary();
+        return;
+    }
+    bool changed = true;
+    while (changed)
+    {
+        SyntaxNodeBase::ResetAllCaches();
+        changed = false;
+        for (std::vector<SymProc*>::const_iterator it = component.begin(); it != component.end(); ++it)
+            changed |= (*it)->UpdateSummary();
+    }
+}
+
+void CallGraph::ComputeSummaries()
+{
+    SyntaxNodeBase::ResetAllCaches();
+    for (std::vector<SymProc*>::iterator it = procs.begin(); it != procs.end(); ++it)
+        (*it)->ClearSummary();
+    for (std::vector<std::vector<SymProc*> >::iterator it = components.begin(); it != components.end(); ++it)
+        SolveComponent(*it);
+}
+
+bool CallGraph::IsRecursive(SymProc* proc) const
+{
+    return recursive.find(proc) != recursive.end();
+}
@@ -0,0 +1,26 @@
+#ifndef CALL_GRAPH
+#define CALL_GRAPH
+
+#include "sym_table.h"
+#include <map>
+#include <vector>
+
+class CallGraph{
+private:
+    std::vector<SymProc*> procs;
+    std::map<SymProc*, ProcsContainer> calls;
+    std::map<SymProc*, unsigned> index;
+    std::map<SymProc*, unsigned> low_link;
+    std::vector<SymProc*> stack;
+    std::vector<std::vector<SymProc*> > components;
+    ProcsContainer recursive;
+    void AddProcs(SymTable* sym_table);
+    void FindComponents(SymProc* proc);
+    void SolveComponent(const std::vector<SymProc*>& component);
+public:
+    CallGraph(SymTable* sym_table);
+    void ComputeSummaries();
+    bool IsRecursive(SymProc* proc) const;
+};
+
+#endif
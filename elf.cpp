@@ -0,0 +1,202 @@
+#include "elf.h"
+#include <string>
+#include <map>
+
+enum ElfSectionIndex{
+    ELF_SEC_NULL,
+    ELF_SEC_TEXT,
+    ELF_SEC_DATA,
+    ELF_SEC_BSS,
+    ELF_SEC_RELA,
+    ELF_SEC_SYMTAB,
+    ELF_SEC_STRTAB,
+    ELF_SEC_SHSTRTAB,
+    ELF_SEC_NOTE,
+    ELF_SEC_COUNT
+};
+
+static const char ELF_SECTION_NAMES[] = "\0.text\0.data\0.bss\0.rela.text\0.symtab\0.strtab\0.shstrtab\0.note.GNU-stack";
+static const unsigned ELF_SECTION_NAME_OFFSETS[] = { 0, 1, 7, 13, 18, 29, 37, 45, 55 };
+
+static const unsigned SHT_PROGBITS = 1;
+static const unsigned SHT_SYMTAB = 2;
+static const unsigned SHT_STRTAB = 3;
+static const unsigned SHT_RELA = 4;
+static const unsigned SHT_NOBITS = 8;
+static const unsigned SHF_WRITE = 1;
+static const unsigned SHF_ALLOC = 2;
+static const unsigned SHF_EXECINSTR = 4;
+static const unsigned SHF_INFO_LINK = 0x40;
+
+static const unsigned R_X86_64_PC32 = 2;
+static const unsigned R_X86_64_PLT32 = 4;
+static const unsigned R_X86_64_32 = 10;
+static const unsigned R_X86_64_32S = 11;
+
+static const unsigned ELF_HEADER_SIZE = 64;
+static const unsigned ELF_SECTION_HEADER_SIZE = 64;
+static const unsigned ELF_SYMBOL_SIZE = 24;
+static const unsigned ELF_RELA_SIZE = 24;
+
+static unsigned AlignUp(unsigned value, unsigned alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+//---ElfWriter---
+
+ElfWriter::ElfWriter(const AsmEncoder& encoder_):
+    encoder(encoder_)
+{
+}
+
+void ElfWriter::Put(unsigned long long value, unsigned size)
+{
+    for (unsigned i = 0; i < size; ++i)
+        out.push_back(value >> (8 * i) & 0xFF);
+}
+
+void ElfWriter::Align(unsigned alignment)
+{
+    out.resize(AlignUp(out.size(), alignment), 0);
+}
+
+void ElfWriter::PutSection(unsigned name, unsigned type, unsigned long long flags, unsigned offset, unsigned size,
+                           unsigned link, unsigned info, unsigned alignment, unsigned entry_size)
+{
+    Put(name, 4);
+    Put(type, 4);
+    Put(flags, 8);
+    Put(0, 8);
+    Put(offset, 8);
+    Put(size, 8);
+    Put(link, 4);
+    Put(info, 4);
+    Put(alignment, 8);
+    Put(entry_size, 8);
+}
+
+void ElfWriter::Write(ostream& o)
+{
+    const std::vector<unsigned char>& text = encoder.GetText();
+    const std::vector<unsigned char>& data = encoder.GetData();
+    const std::map<string, EncSymbol>& symbols = encoder.GetSymbols();
+    const std::vector<EncReloc>& relocs = encoder.GetRelocs();
+
+    std::vector<string> names;
+    std::vector<const EncSymbol*> defs;
+    for (int pass = 0; pass < 2; ++pass)
+        for (std::map<string, EncSymbol>::const_iterator it = symbols.begin(); it != symbols.end(); ++it)
+            if (it->second.section != SECTION_UNDEF && it->second.global == (pass == 1))
+            {
+                names.push_back(it->first);
+                defs.push_back(&it->second);
+            }
+    unsigned first_global = 4;
+    for (unsigned i = 0; i < defs.size() && !defs[i]->global; ++i)
+        ++first_global;
+    for (std::vector<EncReloc>::const_iterator it = relocs.begin(); it != relocs.end(); ++it)
+    {
+        std::map<string, EncSymbol>::const_iterator sym = symbols.find(it->symbol);
+        bool known = false;
+        for (unsigned i = 0; i < names.size() && !known; ++i)
+            known = names[i] == it->symbol;
+        if (known || (sym != symbols.end() && sym->second.section != SECTION_UNDEF)) continue;
+        names.push_back(it->symbol);
+        defs.push_back(NULL);
+    }
+    std::map<string, unsigned> index;
+    string strtab(1, '\0');
+    std::vector<unsigned> name_offsets;
+    for (unsigned i = 0; i < names.size(); ++i)
+    {
+        index[names[i]] = i + 4;
+        name_offsets.push_back(strtab.size());
+        strtab += names[i];
+        strtab += '\0';
+    }
+
+    unsigned symbols_count = 4 + names.size();
+    unsigned text_offset = ELF_HEADER_SIZE;
+    unsigned data_offset = AlignUp(text_offset + text.size(), 16);
+    unsigned rela_offset = AlignUp(data_offset + data.size(), 8);
+    unsigned symtab_offset = rela_offset + ELF_RELA_SIZE * relocs.size();
+    unsigned strtab_offset = symtab_offset + ELF_SYMBOL_SIZE * symbols_count;
+    unsigned shstrtab_offset = strtab_offset + strtab.size();
+    unsigned headers_offset = AlignUp(shstrtab_offset + sizeof(ELF_SECTION_NAMES), 8);
+
+    static const unsigned char ident[] = { 0x7F, 'E', 'L', 'F', 2, 1, 1, 0 };
+    out.insert(out.end(), ident, ident + sizeof(ident));
+    Put(0, 8);
+    Put(1, 2);
+    Put(62, 2);
+    Put(1, 4);
+    Put(0, 8);
+    Put(0, 8);
+    Put(headers_offset, 8);
+    Put(0, 4);
+    Put(ELF_HEADER_SIZE, 2);
+    Put(0, 2);
+    Put(0, 2);
+    Put(ELF_SECTION_HEADER_SIZE, 2);
+    Put(ELF_SEC_COUNT, 2);
+    Put(ELF_SEC_SHSTRTAB, 2);
+
+    out.insert(out.end(), text.begin(), text.end());
+    Align(16);
+    out.insert(out.end(), data.begin(), data.end());
+    Align(8);
+    for (std::vector<EncReloc>::const_iterator it = relocs.begin(); it != relocs.end(); ++it)
+    {
+        std::map<string, EncSymbol>::const_iterator sym = symbols.find(it->symbol);
+        bool defined = sym != symbols.end() && sym->second.section != SECTION_UNDEF;
+        unsigned type = R_X86_64_32;
+        if (it->kind == RELOC_ABS32S) type = R_X86_64_32S;
+        if (it->kind == RELOC_PC32) type = defined ? R_X86_64_PC32 : R_X86_64_PLT32;
+        Put(it->offset, 8);
+        Put((unsigned long long)index[it->symbol] << 32 | type, 8);
+        Put((long long)it->addend, 8);
+    }
+    out.resize(out.size() + ELF_SYMBOL_SIZE, 0);
+    for (unsigned section = ELF_SEC_TEXT; section <= ELF_SEC_BSS; ++section)
+    {
+        Put(0, 4);
+        Put(3, 1);
+        Put(0, 1);
+        Put(section, 2);
+        Put(0, 8);
+        Put(0, 8);
+    }
+    for (unsigned i = 0; i < names.size(); ++i)
+    {
+        const EncSymbol* def = defs[i];
+        unsigned bind = def == NULL || def->global ? 1 : 0;
+        unsigned type = def == NULL ? 0 : def->section == SECTION_TEXT ? 2 : 1;
+        unsigned section = def == NULL ? 0 : def->section == SECTION_TEXT ? ELF_SEC_TEXT
+                         : def->section == SECTION_DATA ? ELF_SEC_DATA : ELF_SEC_BSS;
+        Put(name_offsets[i], 4);
+        Put(bind << 4 | type, 1);
+        Put(0, 1);
+        Put(section, 2);
+        Put(def == NULL ? 0 : def->offset, 8);
+        Put(0, 8);
+    }
+    out.insert(out.end(), strtab.begin(), strtab.end());
+    out.insert(out.end(), ELF_SECTION_NAMES, ELF_SECTION_NAMES + sizeof(ELF_SECTION_NAMES));
+    Align(8);
+
+    out.resize(out.size() + ELF_SECTION_HEADER_SIZE, 0);
+    const unsigned* name = ELF_SECTION_NAME_OFFSETS;
+    PutSection(name[ELF_SEC_TEXT], SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, text_offset, text.size(), 0, 0, 16);
+    PutSection(name[ELF_SEC_DATA], SHT_PROGBITS, SHF_WRITE | SHF_ALLOC, data_offset, data.size(), 0, 0, 16);
+    PutSection(name[ELF_SEC_BSS], SHT_NOBITS, SHF_WRITE | SHF_ALLOC, data_offset + data.size(), encoder.GetBssSize(), 0, 0, 16);
+    PutSection(name[ELF_SEC_RELA], SHT_RELA, SHF_INFO_LINK, rela_offset, ELF_RELA_SIZE * relocs.size(),
+               ELF_SEC_SYMTAB, ELF_SEC_TEXT, 8, ELF_RELA_SIZE);
+    PutSection(name[ELF_SEC_SYMTAB], SHT_SYMTAB, 0, symtab_offset, ELF_SYMBOL_SIZE * symbols_count,
+               ELF_SEC_STRTAB, first_global, 8, ELF_SYMBOL_SIZE);
+    PutSection(name[ELF_SEC_STRTAB], SHT_STRTAB, 0, strtab_offset, strtab.size());
+    PutSection(name[ELF_SEC_SHSTRTAB], SHT_STRTAB, 0, shstrtab_offset, sizeof(ELF_SECTION_NAMES));
+    PutSection(name[ELF_SEC_NOTE], SHT_PROGBITS, 0, headers_offset, 0);
+
+    o.write((const char*)&out[0], out.size());
+}
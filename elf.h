@@ -0,0 +1,21 @@
+#ifndef ELF
+#define ELF
+
+#include "encoder.h"
+#include <ostream>
+#include <vector>
+
+class ElfWriter{
+private:
+    const AsmEncoder& encoder;
+    std::vector<unsigned char> out;
+    void Put(unsigned long long value, unsigned size);
+    void Align(unsigned alignment);
+    void PutSection(unsigned name, unsigned type, unsigned long long flags, unsigned offset, unsigned size,
+                    unsigned link = 0, unsigned info = 0, unsigned alignment = 1, unsigned entry_size = 0);
+public:
+    ElfWriter(const AsmEncoder& encoder_);
+    void Write(ostream& o);
+};
+
+#endif
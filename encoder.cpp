@@ -0,0 +1,666 @@
+#include "encoder.h"
+#include "exception.h"
+#include <sstream>
+#include <stdlib.h>
+#include <ctype.h>
+
+static int RegisterCode(RegisterName reg)
+{
+    switch (reg)
+    {
+        case REG_AL:
+        case REG_AX:
+        case REG_EAX:
+        case REG_RAX:
+        case REG_XMM0:
+            return 0;
+        case REG_CL:
+        case REG_CX:
+        case REG_ECX:
+        case REG_RCX:
+        case REG_XMM1:
+            return 1;
+        case REG_DL:
+        case REG_DX:
+        case REG_EDX:
+        case REG_RDX:
+            return 2;
+        case REG_BL:
+        case REG_BX:
+        case REG_EBX:
+        case REG_RBX:
+            return 3;
+        case REG_AH:
+        case REG_ESP:
+        case REG_RSP:
+            return 4;
+        case REG_CH:
+        case REG_EBP:
+        case REG_RBP:
+            return 5;
+        case REG_DH:
+        case REG_SI:
+        case REG_ESI:
+        case REG_RSI:
+            return 6;
+        case REG_BH:
+        case REG_DI:
+        case REG_EDI:
+        case REG_RDI:
+            return 7;
+        case REG_R11D:
+        case REG_R11:
+            return 11;
+        case REG_R12D:
+        case REG_R12:
+            return 12;
+        case REG_R13D:
+        case REG_R13:
+            return 13;
+        case REG_R14D:
+        case REG_R14:
+            return 14;
+        case REG_R15D:
+        case REG_R15:
+            return 15;
+        default:
+            throw CompilerException("register " + REG_TO_STR[reg] + " cannot be encoded");
+    }
+}
+
+static unsigned ConditionCode(AsmCmdName cmd)
+{
+    switch (cmd)
+    {
+        case ASM_JB:
+        case ASM_SETB:
+            return 0x2;
+        case ASM_JAE:
+        case ASM_SETAE:
+            return 0x3;
+        case ASM_JZ:
+        case ASM_SETE:
+            return 0x4;
+        case ASM_JNE:
+        case ASM_JNZ:
+        case ASM_SETNE:
+            return 0x5;
+        case ASM_JBE:
+        case ASM_SETBE:
+            return 0x6;
+        case ASM_JA:
+        case ASM_SETA:
+            return 0x7;
+        case ASM_JL:
+        case ASM_SETL:
+            return 0xC;
+        case ASM_JNL:
+        case ASM_SETGE:
+            return 0xD;
+        case ASM_JNG:
+        case ASM_SETLE:
+            return 0xE;
+        case ASM_JG:
+        case ASM_SETG:
+            return 0xF;
+        default:
+            throw CompilerException("no condition code for " + ASM_CMD_TO_STR[cmd]);
+    }
+}
+
+static bool IsByte(int value)
+{
+    return -128 <= value && value <= 127;
+}
+
+string UnescapeAsmString(const string& str)
+{
+    string res;
+    for (unsigned i = 0; i < str.size(); ++i)
+    {
+        if (str[i] != '\\' || i + 1 == str.size())
+        {
+            res += str[i];
+            continue;
+        }
+        char c = str[++i];
+        switch (c)
+        {
+            case 'n':
+                res += '\n';
+            break;
+            case 't':
+                res += '\t';
+            break;
+            case 'r':
+                res += '\r';
+            break;
+            case 'b':
+                res += '\b';
+            break;
+            case 'f':
+                res += '\f';
+            break;
+            case 'x':
+            {
+                int value = 0;
+                while (i + 1 < str.size() && isxdigit(str[i + 1]))
+                    value = value * 16 + (isdigit(str[++i]) ? str[i] - '0' : tolower(str[i]) - 'a' + 10);
+                res += char(value);
+            }
+            break;
+            default:
+                if ('0' <= c && c <= '7')
+                {
+                    int value = c - '0';
+                    for (int j = 0; j < 2 && i + 1 < str.size() && '0' <= str[i + 1] && str[i + 1] <= '7'; ++j)
+                        value = value * 8 + str[++i] - '0';
+                    res += char(value);
+                }
+                else
+                    res += c;
+        }
+    }
+    return res;
+}
+
+//---AsmEncoder---
+
+AsmEncoder::AsmEncoder():
+    bss_size(0)
+{
+}
+
+void AsmEncoder::Emit(unsigned char byte)
+{
+    text.push_back(byte);
+}
+
+void AsmEncoder::Emit32(int value)
+{
+    for (int i = 0; i < 4; ++i)
+        Emit((unsigned)value >> (8 * i) & 0xFF);
+}
+
+void AsmEncoder::EmitImm32(const Operand& imm, EncRelocKind kind)
+{
+    if (imm.symbol.empty())
+    {
+        Emit32(imm.value);
+        return;
+    }
+    EncReloc reloc = { (unsigned)text.size(), kind, imm.symbol, imm.value };
+    relocs.push_back(reloc);
+    Emit32(0);
+}
+
+AsmEncoder::Operand AsmEncoder::Decode(AsmOperand* oper) const
+{
+    Operand res;
+    res.kind = oper->GetClassName();
+    res.reg = -1;
+    res.value = 0;
+    switch (res.kind)
+    {
+        case OPERAND_REGISTER:
+            res.reg = RegisterCode(((AsmRegister*)oper)->GetRegister());
+        break;
+        case OPERAND_INT:
+            res.value = ((AsmIntImmediate*)oper)->GetIntValue();
+        break;
+        case OPERAND_STR:
+            res.symbol = ((AsmStrImmediate*)oper)->GetStrValue();
+        break;
+        case OPERAND_MEMORY:
+        {
+            AsmOperand* base = ((AsmMemory*)oper)->GetBase();
+            Operand addr = Decode(base);
+            res.reg = addr.reg;
+            res.symbol = addr.symbol;
+            res.value = addr.value + ((AsmMemory*)oper)->GetDisp();
+        }
+        break;
+        default:
+            throw CompilerException("operand " + oper->ToString() + " cannot be encoded");
+    }
+    string::size_type plus = res.symbol.find('+');
+    if (plus != string::npos)
+    {
+        res.value += atoi(res.symbol.c_str() + plus + 1);
+        res.symbol.erase(plus);
+    }
+    return res;
+}
+
+void AsmEncoder::DefineSymbol(const string& name, EncSection section, unsigned offset)
+{
+    std::map<string, EncSymbol>::iterator it = symbols.find(name);
+    if (it != symbols.end() && it->second.section != SECTION_UNDEF)
+        throw CompilerException("symbol " + name + " is already defined");
+    EncSymbol& sym = symbols[name];
+    sym.section = section;
+    sym.offset = offset;
+    if (it == symbols.end()) sym.global = false;
+}
+
+void AsmEncoder::EmitModRM(unsigned prefix, bool wide, unsigned opcode, int reg, const Operand& rm)
+{
+    if (prefix) Emit(prefix);
+    unsigned rex = (wide ? 8 : 0) | (reg & 8 ? 4 : 0) | (rm.reg >= 0 && rm.reg & 8 ? 1 : 0);
+    if (rex) Emit(0x40 | rex);
+    if (opcode > 0xFF) Emit(opcode >> 8);
+    Emit(opcode & 0xFF);
+    reg &= 7;
+    if (rm.kind == OPERAND_REGISTER)
+    {
+        Emit(0xC0 | reg << 3 | (rm.reg & 7));
+        return;
+    }
+    if (rm.kind != OPERAND_MEMORY) throw CompilerException("register or memory operand expected");
+    if (rm.reg < 0)
+    {
+        Emit(0x04 | reg << 3);
+        Emit(0x25);
+        EmitImm32(rm, RELOC_ABS32S);
+        return;
+    }
+    int base = rm.reg & 7;
+    unsigned mod = rm.value == 0 && base != 5 ? 0 : IsByte(rm.value) ? 1 : 2;
+    Emit(mod << 6 | reg << 3 | base);
+    if (base == 4) Emit(0x24);
+    if (mod == 1) Emit(rm.value & 0xFF);
+    if (mod == 2) Emit32(rm.value);
+}
+
+void AsmEncoder::EmitBranch(unsigned opcode, const string& label)
+{
+    if (opcode > 0xFF) Emit(opcode >> 8);
+    Emit(opcode & 0xFF);
+    Fixup fixup = { (unsigned)text.size(), label };
+    fixups.push_back(fixup);
+    Emit32(0);
+}
+
+void AsmEncoder::EncodeAlu(unsigned digit, bool wide, const Operand& src, const Operand& dest)
+{
+    switch (src.kind)
+    {
+        case OPERAND_INT:
+        case OPERAND_STR:
+            if (src.symbol.empty() && IsByte(src.value))
+            {
+                EmitModRM(0, wide, 0x83, digit, dest);
+                Emit(src.value & 0xFF);
+            }
+            else
+            {
+                EmitModRM(0, wide, 0x81, digit, dest);
+                EmitImm32(src, wide ? RELOC_ABS32S : RELOC_ABS32);
+            }
+        break;
+        case OPERAND_REGISTER:
+            EmitModRM(0, wide, digit << 3 | 0x01, src.reg, dest);
+        break;
+        default:
+            EmitModRM(0, wide, digit << 3 | 0x03, dest.reg, src);
+    }
+}
+
+void AsmEncoder::EncodeMov(bool wide, const Operand& src, const Operand& dest)
+{
+    switch (src.kind)
+    {
+        case OPERAND_INT:
+        case OPERAND_STR:
+            if (!wide && dest.kind == OPERAND_REGISTER)
+            {
+                if (dest.reg & 8) Emit(0x41);
+                Emit(0xB8 | (dest.reg & 7));
+                EmitImm32(src, RELOC_ABS32);
+                return;
+            }
+            EmitModRM(0, wide, 0xC7, 0, dest);
+            EmitImm32(src, wide ? RELOC_ABS32S : RELOC_ABS32);
+        break;
+        case OPERAND_REGISTER:
+            EmitModRM(0, wide, 0x89, src.reg, dest);
+        break;
+        default:
+            EmitModRM(0, wide, 0x8B, dest.reg, src);
+    }
+}
+
+void AsmEncoder::EncodeRaw(const string& raw)
+{
+    stringstream s(raw);
+    string line;
+    while (getline(s, line))
+    {
+        stringstream words(line);
+        string word;
+        if (!(words >> word)) continue;
+        if (word == ".globl" && words >> word)
+        {
+            std::map<string, EncSymbol>::iterator it = symbols.find(word);
+            if (it == symbols.end())
+            {
+                EncSymbol sym = { SECTION_UNDEF, 0, true };
+                symbols[word] = sym;
+            }
+            else
+                it->second.global = true;
+        }
+        else if (word[word.size() - 1] == ':')
+            DefineSymbol(word.substr(0, word.size() - 1), SECTION_TEXT, text.size());
+        else
+            throw CompilerException("directive " + line + " cannot be encoded");
+    }
+}
+
+void AsmEncoder::Encode0(AsmCmdName cmd, CmdSize size)
+{
+    switch (cmd)
+    {
+        case ASM_RET:
+            Emit(0xC3);
+        break;
+        case ASM_SAHF:
+            Emit(0x9E);
+        break;
+        default:
+            throw CompilerException("command " + ASM_CMD_TO_STR[cmd] + " cannot be encoded");
+    }
+}
+
+void AsmEncoder::Encode1(AsmCmdName cmd, CmdSize size, const Operand& oper)
+{
+    bool wide = size == SIZE_QUARD;
+    switch (cmd)
+    {
+        case ASM_PUSH:
+            if (oper.kind == OPERAND_REGISTER)
+            {
+                if (oper.reg & 8) Emit(0x41);
+                Emit(0x50 | (oper.reg & 7));
+            }
+            else if (oper.kind == OPERAND_MEMORY)
+                EmitModRM(0, false, 0xFF, 6, oper);
+            else
+            {
+                Emit(0x68);
+                EmitImm32(oper, RELOC_ABS32S);
+            }
+        break;
+        case ASM_POP:
+            if (oper.kind == OPERAND_REGISTER)
+            {
+                if (oper.reg & 8) Emit(0x41);
+                Emit(0x58 | (oper.reg & 7));
+            }
+            else
+                EmitModRM(0, false, 0x8F, 0, oper);
+        break;
+        case ASM_CALL:
+            if (oper.symbol.empty()) throw CompilerException("indirect call cannot be encoded");
+            EmitBranch(0xE8, oper.symbol);
+        break;
+        case ASM_JMP:
+            EmitBranch(0xE9, oper.symbol);
+        break;
+        case ASM_JA:
+        case ASM_JAE:
+        case ASM_JB:
+        case ASM_JBE:
+        case ASM_JG:
+        case ASM_JL:
+        case ASM_JNE:
+        case ASM_JNG:
+        case ASM_JNL:
+        case ASM_JNZ:
+        case ASM_JZ:
+            EmitBranch(0x0F80 | ConditionCode(cmd), oper.symbol);
+        break;
+        case ASM_SETA:
+        case ASM_SETAE:
+        case ASM_SETB:
+        case ASM_SETBE:
+        case ASM_SETG:
+        case ASM_SETGE:
+        case ASM_SETL:
+        case ASM_SETLE:
+        case ASM_SETE:
+        case ASM_SETNE:
+            EmitModRM(0, false, 0x0F90 | ConditionCode(cmd), 0, oper);
+        break;
+        case ASM_NOT:
+            EmitModRM(0, wide, 0xF7, 2, oper);
+        break;
+        case ASM_NEG:
+            EmitModRM(0, wide, 0xF7, 3, oper);
+        break;
+        case ASM_MUL:
+            EmitModRM(0, wide, 0xF7, 4, oper);
+        break;
+        case ASM_IMUL:
+            EmitModRM(0, wide, 0xF7, 5, oper);
+        break;
+        case ASM_DIV:
+            EmitModRM(0, wide, 0xF7, 6, oper);
+        break;
+        case ASM_IDIV:
+            EmitModRM(0, wide, 0xF7, 7, oper);
+        break;
+        case ASM_RET:
+            Emit(0xC2);
+            Emit(oper.value & 0xFF);
+            Emit(oper.value >> 8 & 0xFF);
+        break;
+        default:
+            throw CompilerException("command " + ASM_CMD_TO_STR[cmd] + " cannot be encoded");
+    }
+}
+
+void AsmEncoder::Encode2(AsmCmdName cmd, CmdSize size, const Operand& src, const Operand& dest)
+{
+    bool wide = size == SIZE_QUARD;
+    switch (cmd)
+    {
+        case ASM_ADD:
+            EncodeAlu(0, wide, src, dest);
+        break;
+        case ASM_OR:
+            EncodeAlu(1, wide, src, dest);
+        break;
+        case ASM_AND:
+            EncodeAlu(4, wide, src, dest);
+        break;
+        case ASM_SUB:
+            EncodeAlu(5, wide, src, dest);
+        break;
+        case ASM_XOR:
+            EncodeAlu(6, wide, src, dest);
+        break;
+        case ASM_CMP:
+            EncodeAlu(7, wide, src, dest);
+        break;
+        case ASM_MOV:
+            EncodeMov(wide, src, dest);
+        break;
+        case ASM_LEA:
+            EmitModRM(0, wide, 0x8D, dest.reg, src);
+        break;
+        case ASM_TEST:
+            if (src.kind == OPERAND_REGISTER)
+                EmitModRM(0, wide, 0x85, src.reg, dest);
+            else
+            {
+                EmitModRM(0, wide, 0xF7, 0, dest);
+                EmitImm32(src, RELOC_ABS32);
+            }
+        break;
+        case ASM_IMUL:
+            if (src.kind == OPERAND_INT || src.kind == OPERAND_STR)
+            {
+                EmitModRM(0, wide, 0x69, dest.reg, dest);
+                EmitImm32(src, RELOC_ABS32);
+            }
+            else
+                EmitModRM(0, wide, 0x0FAF, dest.reg, src);
+        break;
+        case ASM_SAL:
+        case ASM_SAR:
+        {
+            unsigned digit = cmd == ASM_SAL ? 4 : 7;
+            if (src.kind == OPERAND_REGISTER)
+                EmitModRM(0, wide, 0xD3, digit, dest);
+            else
+            {
+                EmitModRM(0, wide, 0xC1, digit, dest);
+                Emit(src.value & 0xFF);
+            }
+        }
+        break;
+        case ASM_MOVZB:
+            EmitModRM(0, wide, 0x0FB6, dest.reg, src);
+        break;
+        case ASM_MOVSS:
+        case ASM_MOVSD:
+        {
+            unsigned prefix = cmd == ASM_MOVSS ? 0xF3 : 0xF2;
+            if (dest.kind == OPERAND_MEMORY)
+                EmitModRM(prefix, false, 0x0F11, src.reg, dest);
+            else
+                EmitModRM(prefix, false, 0x0F10, dest.reg, src);
+        }
+        break;
+        case ASM_ADDSS:
+            EmitModRM(0xF3, false, 0x0F58, dest.reg, src);
+        break;
+        case ASM_MULSS:
+            EmitModRM(0xF3, false, 0x0F59, dest.reg, src);
+        break;
+        case ASM_SUBSS:
+            EmitModRM(0xF3, false, 0x0F5C, dest.reg, src);
+        break;
+        case ASM_DIVSS:
+            EmitModRM(0xF3, false, 0x0F5E, dest.reg, src);
+        break;
+        case ASM_CVTSS2SD:
+            EmitModRM(0xF3, false, 0x0F5A, dest.reg, src);
+        break;
+        case ASM_CVTSI2SS:
+            EmitModRM(0xF3, false, 0x0F2A, dest.reg, src);
+        break;
+        case ASM_UCOMISS:
+            EmitModRM(0, false, 0x0F2E, dest.reg, src);
+        break;
+        default:
+            throw CompilerException("command " + ASM_CMD_TO_STR[cmd] + " cannot be encoded");
+    }
+}
+
+void AsmEncoder::AddData(const string& name, const string& value, AsmDataType type)
+{
+    DefineSymbol(name, SECTION_DATA, data.size());
+    switch (type)
+    {
+        case DATA_UNTYPED:
+            data.resize(data.size() + atoi(value.c_str()), 0);
+        break;
+        case DATA_INT:
+        case DATA_REAL:
+        {
+            int bits = atoi(value.c_str());
+            if (type == DATA_REAL)
+            {
+                float f = atof(value.c_str());
+                bits = *(int*)&f;
+            }
+            for (int i = 0; i < 4; ++i)
+                data.push_back((unsigned)bits >> (8 * i) & 0xFF);
+        }
+        break;
+        case DATA_STR:
+        {
+            string str = UnescapeAsmString(value);
+            data.insert(data.end(), str.begin(), str.end());
+            data.push_back(0);
+        }
+        break;
+    }
+}
+
+void AsmEncoder::AddBss(const string& name, unsigned size)
+{
+    DefineSymbol(name, SECTION_BSS, bss_size);
+    bss_size += size;
+}
+
+void AsmEncoder::Encode(AsmCmd* cmd)
+{
+    switch (cmd->GetClassName())
+    {
+        case CMD_RAW:
+            EncodeRaw(((AsmRawCmd*)cmd)->GetText());
+        break;
+        case CMD_LABEL:
+            DefineSymbol(((AsmLabel*)cmd)->GetName(), SECTION_TEXT, text.size());
+        break;
+        case CMD_0:
+            Encode0(((AsmCmd0*)cmd)->GetCommand(), ((AsmCmd0*)cmd)->GetSize());
+        break;
+        case CMD_1:
+            Encode1(((AsmCmd1*)cmd)->GetCommand(), ((AsmCmd1*)cmd)->GetSize(), Decode(((AsmCmd1*)cmd)->GetOperand()));
+        break;
+        case CMD_2:
+        {
+            AsmCmd2* cmd2 = (AsmCmd2*)cmd;
+            Encode2(cmd2->GetCommand(), cmd2->GetSize(), Decode(cmd2->GetSrc()), Decode(cmd2->GetDest()));
+        }
+        break;
+    }
+}
+
+void AsmEncoder::Finish()
+{
+    for (std::vector<Fixup>::iterator it = fixups.begin(); it != fixups.end(); ++it)
+    {
+        std::map<string, EncSymbol>::iterator sym = symbols.find(it->label);
+        if (sym == symbols.end() || sym->second.section == SECTION_UNDEF)
+        {
+            EncReloc reloc = { it->offset, RELOC_PC32, it->label, -4 };
+            relocs.push_back(reloc);
+            continue;
+        }
+        if (sym->second.section != SECTION_TEXT) throw CompilerException("jump to data label " + it->label);
+        int rel = sym->second.offset - (it->offset + 4);
+        for (int i = 0; i < 4; ++i)
+            text[it->offset + i] = (unsigned)rel >> (8 * i) & 0xFF;
+    }
+    fixups.clear();
+}
+
+const std::vector<unsigned char>& AsmEncoder::GetText() const
+{
+    return text;
+}
+
+const std::vector<unsigned char>& AsmEncoder::GetData() const
+{
+    return data;
+}
+
+unsigned AsmEncoder::GetBssSize() const
+{
+    return bss_size;
+}
+
+const std::map<string, EncSymbol>& AsmEncoder::GetSymbols() const
+{
+    return symbols;
+}
+
+const std::vector<EncReloc>& AsmEncoder::GetRelocs() const
+{
+    return relocs;
+}
@@ -0,0 +1,81 @@
+#ifndef ENCODER
+#define ENCODER
+
+#include "generator.h"
+#include <vector>
+#include <map>
+#include <string>
+
+enum EncSection{
+    SECTION_UNDEF,
+    SECTION_TEXT,
+    SECTION_DATA,
+    SECTION_BSS
+};
+
+enum EncRelocKind{
+    RELOC_ABS32,
+    RELOC_ABS32S,
+    RELOC_PC32
+};
+
+struct EncSymbol{
+    EncSection section;
+    unsigned offset;
+    bool global;
+};
+
+struct EncReloc{
+    unsigned offset;
+    EncRelocKind kind;
+    string symbol;
+    int addend;
+};
+
+class AsmEncoder{
+private:
+    struct Operand{
+        AsmOperandClass kind;
+        int reg;
+        int value;
+        string symbol;
+    };
+    struct Fixup{
+        unsigned offset;
+        string label;
+    };
+    std::vector<unsigned char> text;
+    std::vector<unsigned char> data;
+    unsigned bss_size;
+    std::map<string, EncSymbol> symbols;
+    std::vector<EncReloc> relocs;
+    std::vector<Fixup> fixups;
+    void Emit(unsigned char byte);
+    void Emit32(int value);
+    void EmitImm32(const Operand& imm, EncRelocKind kind);
+    Operand Decode(AsmOperand* oper) const;
+    void DefineSymbol(const string& name, EncSection section, unsigned offset);
+    void EmitModRM(unsigned prefix, bool wide, unsigned opcode, int reg, const Operand& rm);
+    void EmitBranch(unsigned opcode, const string& label);
+    void EncodeAlu(unsigned digit, bool wide, const Operand& src, const Operand& dest);
+    void EncodeMov(bool wide, const Operand& src, const Operand& dest);
+    void EncodeRaw(const string& raw);
+    void Encode0(AsmCmdName cmd, CmdSize size);
+    void Encode1(AsmCmdName cmd, CmdSize size, const Operand& oper);
+    void Encode2(AsmCmdName cmd, CmdSize size, const Operand& src, const Operand& dest);
+public:
+    AsmEncoder();
+    void AddData(const string& name, const string& value, AsmDataType type);
+    void AddBss(const string& name, unsigned size);
+    void Encode(AsmCmd* cmd);
+    void Finish();
+    const std::vector<unsigned char>& GetText() const;
+    const std::vector<unsigned char>& GetData() const;
+    unsigned GetBssSize() const;
+    const std::map<string, EncSymbol>& GetSymbols() const;
+    const std::vector<EncReloc>& GetRelocs() const;
+};
+
+string UnescapeAsmString(const string& str);
+
+#endif
@@ -1,4 +1,6 @@
 #include "generator.h"
+#include "peephole.h"
+#include "encoder.h"
 
 const string SIZE_TO_STR[] =
 {
@@ -42,16 +44,40 @@ const string REG_TO_STR[] =
     "%st(4)",
     "%st(5)",
     "%st(6)",
-    "%st(7)"
+    "%st(7)",
+    "%xmm0",
+    "%xmm1",
+    "%r11d",
+    "%r12d",
+    "%r13d",
+    "%r14d",
+    "%r15d",
+    "%rax",
+    "%rbx",
+    "%rcx",
+    "%rdx",
+    "%rdi",
+    "%rsi",
+    "%rbp",
+    "%rsp",
+    "%r11",
+    "%r12",
+    "%r13",
+    "%r14",
+    "%r15"
 };
 
 const string ASM_CMD_TO_STR[] =
 {
     "add",
+    "addss",
     "and",
     "call",
     "cmp",
+    "cvtsi2ss",
+    "cvtss2sd",
     "div",
+    "divss",
     "faddp",
     "fch",
     "fcompp",
@@ -65,6 +91,12 @@ const string ASM_CMD_TO_STR[] =
     "fxch",
     "idiv",
     "imul",
+    "ja",
+    "jae",
+    "jb",
+    "jbe",
+    "jg",
+    "jl",
     "jmp",
     "jne",
     "jng",
@@ -73,8 +105,11 @@ const string ASM_CMD_TO_STR[] =
     "jz",
     "lea",
     "mov",
+    "movsd",
+    "movss",
     "movzb",
     "mul",
+    "mulss",
     "neg",
     "not",
     "or",
@@ -95,10 +130,29 @@ const string ASM_CMD_TO_STR[] =
     "sete",
     "setne",
     "sub",
+    "subss",
     "test",
+    "ucomiss",
     "xor"
 };
 
+static const RegisterName MAIN_SAVED_REGS[] = { REG_RBX, REG_RBP, REG_R12, REG_R13, REG_R14, REG_R15 };
+static const int MAIN_SAVED_REGS_COUNT = sizeof(MAIN_SAVED_REGS) / sizeof(MAIN_SAVED_REGS[0]);
+static const unsigned MAIN_STACK_SIZE = 8 * 1024 * 1024;
+
+static RegisterName WideRegister(RegisterName reg)
+{
+    if (REG_EAX <= reg && reg <= REG_ESP) return RegisterName(reg - REG_EAX + REG_RAX);
+    if (REG_R11D <= reg && reg <= REG_R15D) return RegisterName(reg - REG_R11D + REG_R11);
+    return reg;
+}
+
+static AsmOperand* WidenAddress(AsmOperand* oper)
+{
+    if (oper->GetClassName() != OPERAND_MEMORY) return oper;
+    return ((AsmMemory*)oper)->Widen();
+}
+
 const string ASM_DATA_TYPE_TO_STR[] =
 {
     ".space",
@@ -113,6 +167,11 @@ void AsmCmd::Print(ostream& o) const
 {
 }
 
+AsmCmdClass AsmCmd::GetClassName() const
+{
+    return CMD_RAW;
+}
+
 //---AsmLabel---
 
 AsmLabel::AsmLabel(AsmStrImmediate* label_):
@@ -130,6 +189,16 @@ AsmLabel::AsmLabel(string label):
 {
 }
 
+AsmCmdClass AsmLabel::GetClassName() const
+{
+    return CMD_LABEL;
+}
+
+string AsmLabel::GetName() const
+{
+    return label->GetStrValue();
+}
+
 void AsmLabel::Print(ostream& o) const
 {
     o << "  ";
@@ -144,6 +213,11 @@ AsmRawCmd::AsmRawCmd(string cmd):
 {
 }
 
+string AsmRawCmd::GetText() const
+{
+    return str;
+}
+
 void AsmRawCmd::Print(ostream& o) const
 {
     o << str;
@@ -157,6 +231,21 @@ AsmCmd0::AsmCmd0(AsmCmdName cmd, CmdSize cmd_size):
 {
 }
 
+AsmCmdClass AsmCmd0::GetClassName() const
+{
+    return CMD_0;
+}
+
+AsmCmdName AsmCmd0::GetCommand() const
+{
+    return command;
+}
+
+CmdSize AsmCmd0::GetSize() const
+{
+    return size;
+}
+
 void AsmCmd0::Print(ostream& o) const
 {
     o << "    " << ASM_CMD_TO_STR[command] << SIZE_TO_STR[size];
@@ -171,6 +260,21 @@ AsmData::AsmData(string name_, string value_, AsmDataType type_):
 {
 }
 
+string AsmData::GetName() const
+{
+    return name;
+}
+
+string AsmData::GetValue() const
+{
+    return value;
+}
+
+AsmDataType AsmData::GetType() const
+{
+    return type;
+}
+
 void AsmData::Print(ostream& o) const
 {
     o << "    " << name << ": " << ASM_DATA_TYPE_TO_STR[type] << ' ';
@@ -186,6 +290,16 @@ AsmCmd1::AsmCmd1(AsmCmdName cmd, AsmOperand* oper_, CmdSize size):
 {
 }
 
+AsmCmdClass AsmCmd1::GetClassName() const
+{
+    return CMD_1;
+}
+
+AsmOperand* AsmCmd1::GetOperand() const
+{
+    return oper;
+}
+
 void AsmCmd1::Print(ostream& o) const
 {
     o << "    " << ASM_CMD_TO_STR[command] << SIZE_TO_STR[size] << '\t';
@@ -204,6 +318,21 @@ AsmCmd2::AsmCmd2(AsmCmdName cmd, AsmOperand* src_, AsmOperand* dest_, CmdSize si
 {
 }
 
+AsmCmdClass AsmCmd2::GetClassName() const
+{
+    return CMD_2;
+}
+
+AsmOperand* AsmCmd2::GetSrc() const
+{
+    return src;
+}
+
+AsmOperand* AsmCmd2::GetDest() const
+{
+    return dest;
+}
+
 void AsmCmd2::Print(ostream& o) const
 {
     o << "    " << ASM_CMD_TO_STR[command] << SIZE_TO_STR[size] << '\t';
@@ -214,6 +343,18 @@ void AsmCmd2::Print(ostream& o) const
 
 //---AsmOperand---
 
+AsmOperandClass AsmOperand::GetClassName() const
+{
+    return OPERAND_NONE;
+}
+
+string AsmOperand::ToString() const
+{
+    stringstream s;
+    Print(s);
+    return s.str();
+}
+
 void AsmOperand::Print(ostream& o) const
 {
 }
@@ -240,6 +381,16 @@ AsmRegister::AsmRegister(RegisterName reg_):
 {
 }
 
+AsmOperandClass AsmRegister::GetClassName() const
+{
+    return OPERAND_REGISTER;
+}
+
+RegisterName AsmRegister::GetRegister() const
+{
+    return reg;
+}
+
 void AsmRegister::Print(ostream& o) const
 {
     o << REG_TO_STR[reg];
@@ -282,6 +433,11 @@ AsmIntImmediate::AsmIntImmediate(const AsmIntImmediate& src):
 {
 }
 
+AsmOperandClass AsmIntImmediate::GetClassName() const
+{
+    return OPERAND_INT;
+}
+
 int AsmIntImmediate::GetIntValue() const
 {
     return value;
@@ -313,6 +469,11 @@ AsmStrImmediate::AsmStrImmediate(const AsmStrImmediate& src)
     value.assign(src.value);
 }
 
+AsmOperandClass AsmStrImmediate::GetClassName() const
+{
+    return OPERAND_STR;
+}
+
 void AsmStrImmediate::Print(ostream& o) const
 {
     o << '$' << value;
@@ -362,6 +523,27 @@ AsmMemory::AsmMemory(RegisterName reg, int disp_, int index_, unsigned scale_):
 {
 }
 
+AsmOperandClass AsmMemory::GetClassName() const
+{
+    return OPERAND_MEMORY;
+}
+
+AsmOperandBase* AsmMemory::GetBase() const
+{
+    return base;
+}
+
+int AsmMemory::GetDisp() const
+{
+    return disp;
+}
+
+AsmMemory* AsmMemory::Widen()
+{
+    if (base->GetClassName() != OPERAND_REGISTER) return this;
+    return new AsmMemory(WideRegister(((AsmRegister*)base)->GetRegister()), disp, index, scale);
+}
+
 void AsmMemory::Print(ostream& o) const
 {
     if (disp) o << disp;
@@ -380,8 +562,47 @@ AsmCode::AsmCode():
     was_real(false),
     was_int(false),
     was_str(false),
-    was_new_line(false)
+    was_new_line(false),
+    ir_enabled(false),
+    sse_enabled(false),
+    x64_enabled(false)
+{
+}
+
+void AsmCode::EnableIR()
+{
+    ir_enabled = true;
+}
+
+bool AsmCode::IsIREnabled() const
+{
+    return ir_enabled;
+}
+
+void AsmCode::EnableSSE()
 {
+    sse_enabled = true;
+}
+
+bool AsmCode::IsSSEEnabled() const
+{
+    return sse_enabled;
+}
+
+void AsmCode::EnableX64()
+{
+    x64_enabled = true;
+    sse_enabled = true;
+}
+
+bool AsmCode::IsX64Enabled() const
+{
+    return x64_enabled;
+}
+
+unsigned AsmCode::GetParamsOffset() const
+{
+    return x64_enabled ? 16 : 8;
 }
 
 string AsmCode::GenStrLabel()
@@ -609,6 +830,68 @@ void AsmCode::AddLabel(string label)
     commands.push_back(new AsmLabel(label));
 }
 
+void AsmCode::Optimize(Peephole& peephole)
+{
+    peephole.Run(commands);
+}
+
+void AsmCode::LowerToX64()
+{
+    list<AsmCmd*>::iterator it = commands.begin();
+    while (it != commands.end())
+    {
+        AsmCmdClass cmd_class = (*it)->GetClassName();
+        if (cmd_class == CMD_2)
+        {
+            AsmCmd2* cmd = (AsmCmd2*)*it;
+            *it++ = new AsmCmd2(cmd->GetCommand(), WidenAddress(cmd->GetSrc()), WidenAddress(cmd->GetDest()), cmd->GetSize());
+            continue;
+        }
+        if (cmd_class != CMD_0 && cmd_class != CMD_1)
+        {
+            ++it;
+            continue;
+        }
+        AsmCmd0* cmd = (AsmCmd0*)*it;
+        AsmOperand* oper = cmd_class == CMD_1 ? WidenAddress(((AsmCmd1*)cmd)->GetOperand()) : NULL;
+        AsmCmdName name = cmd->GetCommand();
+        CmdSize size = cmd->GetSize();
+        if (size == SIZE_LONG && (name == ASM_CALL || name == ASM_RET)) size = SIZE_QUARD;
+        if (size != SIZE_LONG || (name != ASM_PUSH && name != ASM_POP))
+        {
+            *it++ = oper == NULL ? new AsmCmd0(name, size) : new AsmCmd1(name, oper, size);
+            continue;
+        }
+        it = commands.erase(it);
+        AsmOperand* top = new AsmMemory(REG_RSP);
+        if (name == ASM_PUSH)
+        {
+            if (oper->GetClassName() == OPERAND_MEMORY)
+            {
+                commands.insert(it, new AsmCmd2(ASM_MOV, oper, new AsmRegister(REG_R11D)));
+                oper = new AsmRegister(REG_R11D);
+            }
+            commands.insert(it, new AsmCmd2(ASM_LEA, new AsmMemory(REG_RSP, -4), new AsmRegister(REG_RSP), SIZE_QUARD));
+            commands.insert(it, new AsmCmd2(ASM_MOV, oper, top));
+            continue;
+        }
+        AsmOperand* dest = oper->GetClassName() == OPERAND_MEMORY ? new AsmRegister(REG_R11D) : oper;
+        commands.insert(it, new AsmCmd2(ASM_MOV, top, dest));
+        commands.insert(it, new AsmCmd2(ASM_LEA, new AsmMemory(REG_RSP, 4), new AsmRegister(REG_RSP), SIZE_QUARD));
+        if (dest != oper) commands.insert(it, new AsmCmd2(ASM_MOV, dest, oper));
+    }
+}
+
+void AsmCode::Encode(AsmEncoder& encoder) const
+{
+    for (list<AsmData*>::const_iterator it = data.begin(); it != data.end(); ++it)
+        encoder.AddData((*it)->GetName(), (*it)->GetValue(), (*it)->GetType());
+    if (x64_enabled) encoder.AddBss(main_stack.GetStrValue(), MAIN_STACK_SIZE);
+    for (list<AsmCmd*>::const_iterator it = commands.begin(); it != commands.end(); ++it)
+        encoder.Encode(*it);
+    encoder.Finish();
+}
+
 void AsmCode::Print(ostream& o) const
 {
     o << ".data\n";
@@ -617,12 +900,26 @@ void AsmCode::Print(ostream& o) const
         (*it)->Print(o);
         o << '\n';
     }
+    if (x64_enabled) o << ".bss\n    " << main_stack.GetStrValue() << ": .space " << MAIN_STACK_SIZE << '\n';
     o << ".text\n";
     for (list<AsmCmd*>::const_iterator it = commands.begin(); it != commands.end(); ++it)
     {
         (*it)->Print(o);
         o << '\n';
     }
+    if (x64_enabled) o << ".section .note.GNU-stack,\"\",@progbits\n";
+}
+
+void AsmCode::GenCallPrintf(AsmStrImmediate format, int vector_regs)
+{
+    AddCmd(ASM_MOV, format, REG_EDI);
+    AddCmd(ASM_MOV, REG_RSP, REG_RAX, SIZE_QUARD);
+    AddCmd(ASM_AND, -16, REG_RSP, SIZE_QUARD);
+    AddCmd(ASM_SUB, 16, REG_RSP, SIZE_QUARD);
+    AddCmd(ASM_MOV, REG_RAX, AsmMemory(REG_RSP), SIZE_QUARD);
+    AddCmd(ASM_MOV, vector_regs, REG_EAX);
+    AddCmd(ASM_CALL, funct_write, SIZE_QUARD);
+    AddCmd(ASM_MOV, AsmMemory(REG_RSP), REG_RSP, SIZE_QUARD);
 }
 
 void AsmCode::GenCallWriteForInt()
@@ -632,6 +929,13 @@ void AsmCode::GenCallWriteForInt()
         format_str_int = AddData(ChangeName("format_str_d"), "%d", DATA_STR);
         was_int = true;
     }
+    if (x64_enabled)
+    {
+        AddCmd(ASM_MOV, AsmMemory(REG_RSP), REG_ESI);
+        GenCallPrintf(format_str_int, 0);
+        AddCmd(ASM_ADD, 4, REG_RSP, SIZE_QUARD);
+        return;
+    }
     AddCmd(ASM_PUSH, format_str_int);
     AddCmd(ASM_CALL, funct_write);
     AddCmd(ASM_ADD, 8, REG_ESP);
@@ -644,9 +948,25 @@ void AsmCode::GenCallWriteForReal()
         format_str_real = AddData(ChangeName("format_str_f"), "%f", DATA_STR);
         was_real = true;
     }
-    AddCmd(ASM_FLD, AsmMemory(REG_ESP), SIZE_SHORT);
-    AddCmd(ASM_SUB, 8, REG_ESP);
-    AddCmd(ASM_FSTP, AsmMemory(REG_ESP, 4));
+    if (x64_enabled)
+    {
+        AddCmd(ASM_CVTSS2SD, AsmMemory(REG_RSP), REG_XMM0, SIZE_NONE);
+        GenCallPrintf(format_str_real, 1);
+        AddCmd(ASM_ADD, 4, REG_RSP, SIZE_QUARD);
+        return;
+    }
+    if (sse_enabled)
+    {
+        AddCmd(ASM_CVTSS2SD, AsmMemory(REG_ESP), REG_XMM0, SIZE_NONE);
+        AddCmd(ASM_SUB, 8, REG_ESP);
+        AddCmd(ASM_MOVSD, REG_XMM0, AsmMemory(REG_ESP, 4), SIZE_NONE);
+    }
+    else
+    {
+        AddCmd(ASM_FLD, AsmMemory(REG_ESP), SIZE_SHORT);
+        AddCmd(ASM_SUB, 8, REG_ESP);
+        AddCmd(ASM_FSTP, AsmMemory(REG_ESP, 4));
+    }
     AddCmd(ASM_MOV, format_str_real, AsmMemory(REG_ESP));
     AddCmd(ASM_CALL, funct_write);
     AddCmd(ASM_ADD, 12, REG_ESP);
@@ -659,6 +979,13 @@ void AsmCode::GenCallWriteForStr()
         format_str_str = AddData(ChangeName("format_str_s"), "%s", DATA_STR);
         was_str = true;
     }
+    if (x64_enabled)
+    {
+        AddCmd(ASM_MOV, AsmMemory(REG_RSP), REG_ESI);
+        GenCallPrintf(format_str_str, 0);
+        AddCmd(ASM_ADD, 4, REG_RSP, SIZE_QUARD);
+        return;
+    }
     AddCmd(ASM_PUSH, format_str_str);
     AddCmd(ASM_CALL, funct_write);
     AddCmd(ASM_ADD, 8, REG_ESP);
@@ -671,6 +998,11 @@ void AsmCode::GenWriteNewLine()
         format_str_new_line = AddData(ChangeName("format_str_new_line"), "\\n", DATA_STR);
         was_new_line = true;
     }
+    if (x64_enabled)
+    {
+        GenCallPrintf(format_str_new_line, 0);
+        return;
+    }
     AddCmd(ASM_PUSH, format_str_new_line);
     AddCmd(ASM_CALL, funct_write);
     AddCmd(ASM_ADD, 4, REG_ESP);
@@ -708,7 +1040,54 @@ void AsmCode::MoveMemory(unsigned size)
     }
 }
 
+void AsmCode::GenFrameEnter()
+{
+    if (x64_enabled)
+    {
+        AddCmd(ASM_PUSH, REG_RBP, SIZE_QUARD);
+        AddCmd(ASM_MOV, REG_RSP, REG_RBP, SIZE_QUARD);
+        return;
+    }
+    AddCmd(ASM_PUSH, REG_EBP);
+    AddCmd(ASM_MOV, REG_ESP, REG_EBP);
+}
+
+void AsmCode::GenFrameLeave(unsigned params_size)
+{
+    if (x64_enabled)
+    {
+        AddCmd(ASM_MOV, REG_RBP, REG_RSP, SIZE_QUARD);
+        AddCmd(ASM_POP, REG_RBP, SIZE_QUARD);
+        AddCmd(ASM_RET, params_size, SIZE_QUARD);
+        return;
+    }
+    AddCmd(ASM_MOV, REG_EBP, REG_ESP);
+    AddCmd(ASM_POP, REG_EBP);
+    AddCmd(ASM_RET, params_size);
+}
+
 void AsmCode::AddMainFunctionLabel()
 {
     AddCmd(".globl main\nmain:\n");
+    if (!x64_enabled) return;
+    for (int i = 0; i < MAIN_SAVED_REGS_COUNT; ++i)
+        AddCmd(ASM_PUSH, MAIN_SAVED_REGS[i], SIZE_QUARD);
+    main_rsp = AddData(ChangeName("main_rsp"), 8);
+    main_stack = GenLabel("stack");
+    stringstream top;
+    top << main_stack.GetStrValue() << '+' << MAIN_STACK_SIZE;
+    AddCmd(ASM_MOV, REG_RSP, AsmMemory(main_rsp), SIZE_QUARD);
+    AddCmd(ASM_MOV, AsmStrImmediate(top.str()), REG_ESP);
+}
+
+void AsmCode::AddMainFunctionReturn()
+{
+    if (x64_enabled)
+    {
+        AddCmd(ASM_MOV, AsmMemory(main_rsp), REG_RSP, SIZE_QUARD);
+        for (int i = MAIN_SAVED_REGS_COUNT - 1; i >= 0; --i)
+            AddCmd(ASM_POP, MAIN_SAVED_REGS[i], SIZE_QUARD);
+    }
+    AddCmd(ASM_MOV, 0, REG_EAX);
+    AddCmd(ASM_RET, x64_enabled ? SIZE_QUARD : SIZE_LONG);
 }
@@ -2,6 +2,7 @@
 #define GENERATOR
 
 #include "asm_commands.h"
+#include "arena.h"
 #include <list>
 #include <iostream>
 #include <stdio.h>
@@ -10,11 +11,14 @@ using namespace std;
 
 class AsmOperand;
 class AsmStrImmediate;
+class Peephole;
+class AsmEncoder;
 
 extern const string ASM_DATA_TYPE_TO_STR[];
 
-class AsmCmd{
+class AsmCmd: public ArenaObject{
 public:
+    virtual AsmCmdClass GetClassName() const;
     virtual void Print(ostream& o) const;
 };
 
@@ -24,6 +28,8 @@ public:
     AsmLabel(AsmStrImmediate* label);
     AsmLabel(AsmStrImmediate label);
     AsmLabel(string label);
+    virtual AsmCmdClass GetClassName() const;
+    string GetName() const;
     virtual void Print(ostream& o) const;
 };
 
@@ -32,6 +38,7 @@ private:
     string str;
 public:
     AsmRawCmd(string cmd);
+    string GetText() const;
     virtual void Print(ostream& o) const;
 };
 
@@ -41,16 +48,22 @@ protected:
     CmdSize size;
 public:
     AsmCmd0(AsmCmdName cmd, CmdSize cmd_size = SIZE_LONG);
+    virtual AsmCmdClass GetClassName() const;
+    AsmCmdName GetCommand() const;
+    CmdSize GetSize() const;
     virtual void Print(ostream& o) const;
 };
 
-class AsmData{
+class AsmData: public ArenaObject{
 private:
     string name;
     string value;
     AsmDataType type;
 public:
     AsmData(string name_, string value, AsmDataType type = DATA_UNTYPED);
+    string GetName() const;
+    string GetValue() const;
+    AsmDataType GetType() const;
     virtual void Print(ostream& o) const;
 };
 
@@ -59,6 +72,8 @@ private:
     AsmOperand* oper;
 public:
     AsmCmd1(AsmCmdName cmd, AsmOperand* oper_, CmdSize size = SIZE_LONG);
+    virtual AsmCmdClass GetClassName() const;
+    AsmOperand* GetOperand() const;
     virtual void Print(ostream& o) const;
 };
 
@@ -68,11 +83,16 @@ private:
     AsmOperand* dest;
 public:
     AsmCmd2(AsmCmdName cmd, AsmOperand* src_, AsmOperand* dest_, CmdSize size = SIZE_LONG);
+    virtual AsmCmdClass GetClassName() const;
+    AsmOperand* GetSrc() const;
+    AsmOperand* GetDest() const;
     virtual void Print(ostream& o) const;
 };
 
-class AsmOperand{
+class AsmOperand: public ArenaObject{
 public:
+    virtual AsmOperandClass GetClassName() const;
+    string ToString() const;
     virtual void Print(ostream& o) const;
     virtual void PrintBase(ostream& o) const;
 };
@@ -88,6 +108,8 @@ private:
     RegisterName reg;
 public:
     AsmRegister(RegisterName reg_);
+    virtual AsmOperandClass GetClassName() const;
+    RegisterName GetRegister() const;
     virtual void Print(ostream& o) const;
     virtual void PrintBase(ostream& o) const;
 };
@@ -106,6 +128,7 @@ private:
 public:
     AsmIntImmediate(int value_);
     AsmIntImmediate(const AsmIntImmediate& src);
+    virtual AsmOperandClass GetClassName() const;
     virtual int GetIntValue() const;
     virtual void Print(ostream& o) const;
     virtual void PrintBase(ostream& o) const;
@@ -118,6 +141,7 @@ public:
     AsmStrImmediate();
     AsmStrImmediate(const string& value_);
     AsmStrImmediate(const AsmStrImmediate& src);
+    virtual AsmOperandClass GetClassName() const;
     virtual string GetStrValue() const;
     virtual void Print(ostream& o) const;
     virtual void PrintBase(ostream& o) const;
@@ -134,6 +158,10 @@ public:
     AsmMemory(AsmStrImmediate base, int disp_ = 0, int index_ = 0, unsigned scale_ = 0);
     AsmMemory(AsmIntImmediate base, int disp_ = 0, int index_ = 0, unsigned scale_ = 0);
     AsmMemory(RegisterName reg, int disp_ = 0, int index_ = 0, unsigned scale_ = 0);
+    virtual AsmOperandClass GetClassName() const;
+    AsmOperandBase* GetBase() const;
+    int GetDisp() const;
+    AsmMemory* Widen();
     virtual void Print(ostream& o) const;
 };
 
@@ -147,13 +175,26 @@ private:
     bool was_int;
     bool was_str;
     bool was_new_line;
+    bool ir_enabled;
+    bool sse_enabled;
+    bool x64_enabled;
     AsmMemory funct_write;
+    AsmStrImmediate main_rsp;
+    AsmStrImmediate main_stack;
     list<AsmCmd*> commands;
     list<AsmData*> data;
     string ChangeName(string str);
     unsigned label_counter;
+    void GenCallPrintf(AsmStrImmediate format, int vector_regs);
 public:
     AsmCode();
+    void EnableIR();
+    bool IsIREnabled() const;
+    void EnableSSE();
+    bool IsSSEEnabled() const;
+    void EnableX64();
+    bool IsX64Enabled() const;
+    unsigned GetParamsOffset() const;
     string GenStrLabel();
     AsmStrImmediate GenLabel(string prefix);
     string GenStrLabel(string prefix);
@@ -194,6 +235,9 @@ public:
     void AddLabel(AsmStrImmediate* label);
     void AddLabel(AsmStrImmediate label);
     void AddLabel(string label);
+    void Optimize(Peephole& peephole);
+    void LowerToX64();
+    void Encode(AsmEncoder& encoder) const;
     virtual void Print(ostream& o) const;
     void GenCallWriteForInt();
     void GenCallWriteForReal();
@@ -202,7 +246,10 @@ public:
     void PushMemory(unsigned size);
     void MoveToMemoryFromStack(unsigned size);
     void MoveMemory(unsigned size);
+    void GenFrameEnter();
+    void GenFrameLeave(unsigned params_size);
     void AddMainFunctionLabel();
+    void AddMainFunctionReturn();
 };
 
 #endif
@@ -0,0 +1,108 @@
+#include "hoister.h"
+#include "statement.h"
+#include "syntax_node.h"
+#include "sym_table.h"
+#include <sstream>
+
+//---Hoister---
+
+Hoister::Hoister(SymTable* sym_table_, const SymTable* globals):
+    sym_table(sym_table_),
+    global(sym_table_ == globals),
+    vars_count(0),
+    by_ref_written(false),
+    shared_written(false),
+    speculative(false)
+{
+    AddAliases(globals);
+    if (!global) AddAliases(sym_table);
+}
+
+void Hoister::AddAliases(const SymTable* table)
+{
+    const std::vector<Symbol*>& symbols = table->GetSymbols();
+    for (std::vector<Symbol*>::const_iterator it = symbols.begin(); it != symbols.end(); ++it)
+    {
+        if (!((*it)->GetClassName() & SYM_VAR)) continue;
+        SymVar* var = (SymVar*)*it;
+        if ((var->GetClassName() & SYM_VAR_PARAM) && ((SymVarParam*)var)->IsByRef())
+            by_ref.Insert(var);
+        else if ((var->GetClassName() & SYM_VAR_GLOBAL)
+            || (var->GetVarType()->GetActualType()->GetClassName() & SYM_TYPE_ARRAY))
+            shared.Insert(var);
+    }
+}
+
+//by-ref parameter may point to any global or array element, so reads through
+//it conflict with writes to those and vice versa
+bool Hoister::IsAliased(SyntaxNode* node)
+{
+    VarsContainer deps;
+    node->GetAllDependences(deps);
+    if (deps.IsIntersect(by_ref) && (by_ref_written || shared_written)) return true;
+    return deps.IsIntersect(shared) && by_ref_written;
+}
+
+SymVar* Hoister::NewVar(const SymType* type)
+{
+    stringstream s;
+    s << "licm." << ++vars_count;
+    Token name(s.str().c_str(), IDENTIFIER, TOK_UNRESERVED);
+    SymVar* res = global ? (SymVar*)new SymVarGlobal(name, type)
+        : (SymVar*)new SymVarLocal(name, type, sym_table->GetLocalsSize());
+    sym_table->Add(res);
+    return res;
+}
+
+bool Hoister::IsInvariant(SyntaxNode* node)
+{
+    if (node->GetCost() < HOIST_MIN_COST || !node->CanBeHoisted(speculative) || node->IsHaveSideEffect()) return false;
+    const SymType* type = node->GetSymType()->GetActualType();
+    if (type != top_type_int && type != top_type_real) return false;
+    ProcsContainer calls;
+    node->GetAllCalls(calls);
+    return calls.empty() && !node->IsDependOnVars(context) && !IsAliased(node);
+}
+
+void Hoister::SetContext(const VarsContainer& affected)
+{
+    context.Clear();
+    context.Insert(affected);
+    by_ref_written = affected.IsIntersect(by_ref);
+    shared_written = affected.IsIntersect(shared);
+}
+
+bool Hoister::IsSpeculative() const
+{
+    return speculative;
+}
+
+//code that may not run on every entry to the loop, loads from it would be
+//executed speculatively in front of the loop
+void Hoister::SetSpeculative(bool value)
+{
+    speculative = value;
+}
+
+void Hoister::Hoist(SyntaxNode*& link)
+{
+    if (!IsInvariant(link))
+    {
+        link->HoistExpressions(*this);
+        return;
+    }
+    SymVar* var = NewVar(link->GetSymType());
+    prefix.push_back(new StmtAssign(new NodeVar(var), link));
+    link = new NodeVar(var);
+}
+
+NodeStatement* Hoister::Flush(NodeStatement* loop)
+{
+    if (prefix.empty()) return loop;
+    StmtBlock* res = new StmtBlock();
+    for (std::vector<NodeStatement*>::iterator it = prefix.begin(); it != prefix.end(); ++it)
+        res->AddStatement(*it);
+    res->AddStatement(loop);
+    prefix.clear();
+    return res;
+}
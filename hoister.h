@@ -0,0 +1,37 @@
+#ifndef HOISTER
+#define HOISTER
+
+#include "syntax_node_base.h"
+#include "statement_base.h"
+#include <vector>
+
+class SymTable;
+
+const unsigned HOIST_MIN_COST = 3;
+
+class Hoister{
+private:
+    SymTable* sym_table;
+    bool global;
+    unsigned vars_count;
+    std::vector<NodeStatement*> prefix;
+    VarsContainer context;
+    VarsContainer by_ref;
+    VarsContainer shared;
+    bool by_ref_written;
+    bool shared_written;
+    bool speculative;
+    SymVar* NewVar(const SymType* type);
+    void AddAliases(const SymTable* table);
+    bool IsAliased(SyntaxNode* node);
+    bool IsInvariant(SyntaxNode* node);
+public:
+    Hoister(SymTable* sym_table_, const SymTable* globals);
+    void SetContext(const VarsContainer& affected);
+    bool IsSpeculative() const;
+    void SetSpeculative(bool value);
+    void Hoist(SyntaxNode*& link);
+    NodeStatement* Flush(NodeStatement* loop);
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "inliner.h"
+#include "statement.h"
+#include "syntax_node.h"
+#include "sym_table.h"
+#include "call_graph.h"
+#include <sstream>
+
+//---Inliner---
+
+Inliner::Inliner(SymTable* sym_table_, SymProc* caller_, const CallGraph& graph_, bool global_, unsigned threshold_):
+    sym_table(sym_table_),
+    caller(caller_),
+    graph(graph_),
+    global(global_),
+    threshold(threshold_),
+    vars_count(0),
+    new_vars_size(0),
+    fail(false)
+{
+}
+
+SymVar* Inliner::NewVar(const SymVar* var)
+{
+    stringstream s;
+    s << "inline." << ++vars_count << '.' << var->GetName();
+    Token name(s.str().c_str(), IDENTIFIER, TOK_UNRESERVED);
+    SymVar* res = global ? (SymVar*)new SymVarGlobal(name, var->GetVarType())
+        : (SymVar*)new SymVarLocal(name, var->GetVarType(), sym_table->GetLocalsSize() + new_vars_size);
+    new_vars_size += var->GetVarType()->GetSize();
+    new_vars.push_back(res);
+    return res;
+}
+
+bool Inliner::CanExpand(SymProc* proc)
+{
+    if (proc == caller || graph.IsRecursive(proc) || !proc->IsHaveBody()) return false;
+    if (proc->GetBody()->GetCost() > threshold) return false;
+    const std::vector<Symbol*>& symbols = proc->GetSymTable()->GetSymbols();
+    for (std::vector<Symbol*>::const_iterator it = symbols.begin(); it != symbols.end(); ++it)
+        if ((*it)->GetClassName() & SYM_PROC) return false;
+    return true;
+}
+
+bool Inliner::ExpandBody(NodeCall* call, SymProc* proc, const std::vector<SyntaxNode*>& args, SymVar*& result)
+{
+    if (!CanExpand(proc)) return false;
+    bool pure_args = true;
+    for (unsigned i = 0; i < args.size(); ++i)
+        pure_args &= !args[i]->IsHaveSideEffect();
+    VarsContainer affected;
+    call->GetAllAffectedVars(affected);
+    vars.clear();
+    loops.clear();
+    new_vars.clear();
+    new_vars_size = 0;
+    fail = false;
+    unsigned old_count = vars_count;
+    for (unsigned i = 0; i < args.size(); ++i)
+    {
+        if (!proc->GetArg(i)->IsByRef()) continue;
+        VarsContainer deps;
+        args[i]->GetAllDependences(deps, false);
+        if (!pure_args || deps.IsIntersect(affected)) return false;
+        vars[proc->GetArg(i)] = args[i];
+    }
+    std::vector<NodeStatement*> copies;
+    for (int i = args.size() - 1; 0 <= i; --i)
+    {
+        SymVar* param = (SymVar*)proc->GetArg(i);
+        if (proc->GetArg(i)->IsByRef()) continue;
+        VarsContainer deps;
+        args[i]->GetAllDependences(deps);
+        if (pure_args && args[i]->GetCost() == 1 && !proc->IsAffectToVar(param) && !deps.IsIntersect(affected))
+        {
+            vars[param] = args[i];
+            continue;
+        }
+        SymVar* var = NewVar(param);
+        vars[param] = new NodeVar(var);
+        copies.push_back(new StmtAssign(new NodeVar(var), args[i]));
+    }
+    result = NULL;
+    const std::vector<Symbol*>& symbols = proc->GetSymTable()->GetSymbols();
+    for (std::vector<Symbol*>::const_iterator it = symbols.begin(); it != symbols.end(); ++it)
+    {
+        SymbolClass name = (*it)->GetClassName();
+        if (!(name & (SYM_VAR_LOCAL | SYM_VAR_PARAM)) || vars.find((SymVar*)*it) != vars.end()) continue;
+        SymVar* var = NewVar((SymVar*)*it);
+        vars[(SymVar*)*it] = new NodeVar(var);
+        if (name & SYM_VAR_PARAM) result = var;
+    }
+    NodeStatement* body = proc->GetBody()->Clone(*this);
+    if (fail)
+    {
+        vars_count = old_count;
+        return false;
+    }
+    for (std::vector<SymVar*>::iterator it = new_vars.begin(); it != new_vars.end(); ++it)
+        sym_table->Add(*it);
+    prefix.insert(prefix.end(), copies.begin(), copies.end());
+    prefix.push_back(body);
+    return true;
+}
+
+bool Inliner::Expand(NodeCall* call, SymProc* proc, const std::vector<SyntaxNode*>& args, SyntaxNode* target)
+{
+    SymVar* result;
+    if (!ExpandBody(call, proc, args, result)) return false;
+    if (target != NULL) prefix.push_back(new StmtAssign(target, new NodeVar(result)));
+    return true;
+}
+
+SyntaxNode* Inliner::ExpandNested(NodeCall* call, SymProc* proc, const std::vector<SyntaxNode*>& args)
+{
+    if (!(proc->GetClassName() & SYM_FUNCT) || call->IsHaveSideEffect()) return NULL;
+    VarsContainer deps;
+    call->GetAllDependences(deps, true);
+    if (deps.IsIntersect(context)) return NULL;
+    SymVar* result;
+    if (!ExpandBody(call, proc, args, result)) return NULL;
+    return new NodeVar(result);
+}
+
+void Inliner::InlineNestedCalls(SyntaxNode*& expr)
+{
+    context.Clear();
+    expr->GetAllAffectedVars(context);
+    expr->InlineNestedCalls(*this, expr);
+}
+
+NodeStatement* Inliner::Flush(NodeStatement* stmt)
+{
+    if (prefix.empty()) return stmt;
+    StmtBlock* res = new StmtBlock();
+    for (std::vector<NodeStatement*>::iterator it = prefix.begin(); it != prefix.end(); ++it)
+        res->AddStatement(*it);
+    res->AddStatement(stmt);
+    prefix.clear();
+    return res;
+}
+
+SyntaxNode* Inliner::CloneVar(SymVar* var)
+{
+    std::map<const SymVar*, SyntaxNode*>::iterator it = vars.find(var);
+    if (it == vars.end()) return new NodeVar(var);
+    return it->second->Clone(*this);
+}
+
+SymVar* Inliner::MapIndex(SymVar* var)
+{
+    std::map<const SymVar*, SyntaxNode*>::iterator it = vars.find(var);
+    if (it == vars.end()) return var;
+    if (it->second->GetCost() != 1 || !it->second->IsLValue()) fail = true;
+    return it->second->GetAffectedVar();
+}
+
+StmtLoop* Inliner::MapLoop(StmtLoop* loop) const
+{
+    std::map<const StmtLoop*, StmtLoop*>::const_iterator it = loops.find(loop);
+    return it != loops.end() ? it->second : loop;
+}
+
+void Inliner::AddLoop(const StmtLoop* loop, StmtLoop* clone)
+{
+    loops[loop] = clone;
+}
+
+StmtBlock* Inliner::CloneSequence(const std::vector<NodeStatement*>& stmts)
+{
+    StmtBlock* res = new StmtBlock();
+    for (unsigned i = 0; i < stmts.size(); ++i)
+    {
+        if (!stmts[i]->ContainExit())
+        {
+            res->AddStatement(stmts[i]->Clone(*this));
+            continue;
+        }
+        std::vector<NodeStatement*> tail(stmts.begin() + i + 1, stmts.end());
+        switch (stmts[i]->GetClassName())
+        {
+            case STMT_BLOCK:
+                for (unsigned j = ((StmtBlock*)stmts[i])->GetSize(); 0 < j; --j)
+                    tail.insert(tail.begin(), ((StmtBlock*)stmts[i])->GetStmt(j - 1));
+                res->AddStatement(CloneSequence(tail));
+            break;
+            case STMT_IF:
+                res->AddStatement(((StmtIf*)stmts[i])->CloneWithTail(*this, tail));
+            break;
+            case STMT_EXIT:
+            break;
+            default:
+                fail = true;
+        }
+        return res;
+    }
+    return res;
+}
@@ -0,0 +1,50 @@
+#ifndef INLINER
+#define INLINER
+
+#include "syntax_node_base.h"
+#include "statement_base.h"
+#include <map>
+#include <vector>
+
+class SymTable;
+class SymProc;
+class StmtLoop;
+class StmtBlock;
+class NodeCall;
+class CallGraph;
+
+const unsigned INLINE_THRESHOLD = 20;
+const unsigned INLINE_CALL_COST = 4;
+
+class Inliner{
+private:
+    SymTable* sym_table;
+    SymProc* caller;
+    const CallGraph& graph;
+    bool global;
+    unsigned threshold;
+    unsigned vars_count;
+    unsigned new_vars_size;
+    bool fail;
+    std::vector<SymVar*> new_vars;
+    std::vector<NodeStatement*> prefix;
+    VarsContainer context;
+    std::map<const SymVar*, SyntaxNode*> vars;
+    std::map<const StmtLoop*, StmtLoop*> loops;
+    SymVar* NewVar(const SymVar* var);
+    bool CanExpand(SymProc* proc);
+    bool ExpandBody(NodeCall* call, SymProc* proc, const std::vector<SyntaxNode*>& args, SymVar*& result);
+public:
+    Inliner(SymTable* sym_table_, SymProc* caller_, const CallGraph& graph_, bool global_, unsigned threshold_);
+    bool Expand(NodeCall* call, SymProc* proc, const std::vector<SyntaxNode*>& args, SyntaxNode* target);
+    SyntaxNode* ExpandNested(NodeCall* call, SymProc* proc, const std::vector<SyntaxNode*>& args);
+    void InlineNestedCalls(SyntaxNode*& expr);
+    NodeStatement* Flush(NodeStatement* stmt);
+    SyntaxNode* CloneVar(SymVar* var);
+    SymVar* MapIndex(SymVar* var);
+    StmtLoop* MapLoop(StmtLoop* loop) const;
+    void AddLoop(const StmtLoop* loop, StmtLoop* clone);
+    StmtBlock* CloneSequence(const std::vector<NodeStatement*>& stmts);
+};
+
+#endif
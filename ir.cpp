@@ -0,0 +1,1139 @@
+#include "ir.h"
+#include "regalloc.h"
+#include "statement.h"
+#include "syntax_node.h"
+#include <algorithm>
+#include <map>
+#include <set>
+
+const string IR_OPCODE_TO_STR[] =
+{
+    "const",
+    "copy",
+    "add",
+    "sub",
+    "mul",
+    "div",
+    "mod",
+    "and",
+    "or",
+    "xor",
+    "shl",
+    "shr",
+    "eq",
+    "ne",
+    "lt",
+    "le",
+    "gt",
+    "ge",
+    "neg",
+    "not",
+    "itor",
+    "load_var",
+    "store_var",
+    "var_addr",
+    "load",
+    "store",
+    "stack_value",
+    "stack_arg",
+    "stack_stmt",
+    "reserve",
+    "arg",
+    "call",
+    "write",
+    "write_str",
+    "write_ln",
+    "jump",
+    "branch"
+};
+
+IRType IRTypeOf(const SymType* type)
+{
+    if (type == top_type_real) return IR_REAL;
+    return type->GetSize() ? IR_INT : IR_VOID;
+}
+
+//---IRInstr---
+
+IRInstr::IRInstr(IROpcode op_, IRType type_, int dst_, int a_, int b_, int imm_):
+    op(op_),
+    type(type_),
+    dst(dst_),
+    a(a_),
+    b(b_),
+    imm(imm_),
+    var(NULL),
+    proc(NULL),
+    node(NULL),
+    stmt(NULL)
+{
+}
+
+bool IRInstr::IsTerminator() const
+{
+    return op == IR_JUMP || op == IR_BRANCH;
+}
+
+bool IRInstr::IsPure() const
+{
+    switch (op)
+    {
+        case IR_DIV:
+        case IR_MOD:
+        case IR_STORE_VAR:
+        case IR_STORE:
+        case IR_STACK_VALUE:
+        case IR_STACK_ARG:
+        case IR_STACK_STMT:
+        case IR_RESERVE:
+        case IR_ARG:
+        case IR_CALL:
+        case IR_WRITE:
+        case IR_WRITE_STR:
+        case IR_WRITE_LN:
+        case IR_JUMP:
+        case IR_BRANCH:
+            return false;
+        default:
+            return true;
+    }
+}
+
+void IRInstr::Print(ostream& o) const
+{
+    o << "    ";
+    if (dst != IR_NO_TEMP) o << 't' << dst << " = ";
+    o << IR_OPCODE_TO_STR[op];
+    if (type == IR_REAL) o << ".r";
+    switch (op)
+    {
+        case IR_CONST:
+        case IR_RESERVE:
+            o << ' ' << imm;
+        break;
+        case IR_LOAD_VAR:
+        case IR_VAR_ADDR:
+            o << ' ' << var->GetName();
+        break;
+        case IR_STORE_VAR:
+            o << ' ' << var->GetName() << ", t" << a;
+        break;
+        case IR_CALL:
+            o << ' ' << proc->GetName();
+        break;
+        case IR_STACK_VALUE:
+        case IR_STACK_ARG:
+        case IR_STACK_STMT:
+        break;
+        default:
+            if (a != IR_NO_TEMP) o << " t" << a;
+            if (b != IR_NO_TEMP) o << ", t" << b;
+    }
+}
+
+//---IRBlock---
+
+IRBlock::IRBlock(unsigned index_):
+    index(index_)
+{
+}
+
+bool IRBlock::IsTerminated() const
+{
+    return !instrs.empty() && instrs.back().IsTerminator();
+}
+
+void IRBlock::Print(ostream& o) const
+{
+    o << "  bb" << index << ':';
+    if (!pred.empty())
+    {
+        o << "\t; preds:";
+        for (std::vector<IRBlock*>::const_iterator it = pred.begin(); it != pred.end(); ++it)
+            o << " bb" << (*it)->index;
+    }
+    o << '\n';
+    for (std::vector<IRInstr>::const_iterator it = instrs.begin(); it != instrs.end(); ++it)
+    {
+        it->Print(o);
+        if (it->op == IR_JUMP) o << " bb" << succ[0]->index;
+        else if (it->op == IR_BRANCH) o << ", bb" << succ[0]->index << ", bb" << succ[1]->index;
+        o << '\n';
+    }
+}
+
+//---IRFunction---
+
+IRFunction::IRFunction(unsigned locals_size_):
+    locals_size(locals_size_),
+    slots_count(0),
+    allocated(false)
+{
+    entry = NewBlock();
+    exit = NewBlock();
+    PlaceBlock(entry);
+}
+
+IRFunction::~IRFunction()
+{
+    for (std::vector<IRBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+        delete *it;
+}
+
+int IRFunction::NewTemp(IRType type)
+{
+    temps.push_back(type);
+    return temps.size() - 1;
+}
+
+IRType IRFunction::GetTempType(int temp) const
+{
+    return temps[temp];
+}
+
+unsigned IRFunction::GetTempsCount() const
+{
+    return temps.size();
+}
+
+IRBlock* IRFunction::NewBlock()
+{
+    blocks.push_back(new IRBlock(blocks.size()));
+    return blocks.back();
+}
+
+void IRFunction::PlaceBlock(IRBlock* block)
+{
+    layout.push_back(block);
+}
+
+IRBlock* IRFunction::GetEntry() const
+{
+    return entry;
+}
+
+IRBlock* IRFunction::GetExit() const
+{
+    return exit;
+}
+
+const std::vector<IRBlock*>& IRFunction::GetBlocks() const
+{
+    return blocks;
+}
+
+void IRFunction::Build(NodeStatement* body)
+{
+    IRBuilder builder(*this);
+    body->GenerateIR(builder);
+    builder.Finish();
+}
+
+void IRFunction::BuildCFG()
+{
+    for (std::vector<IRBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+        (*it)->pred.clear();
+    std::vector<bool> reachable(blocks.size(), false);
+    std::vector<IRBlock*> work(1, entry);
+    reachable[entry->index] = true;
+    while (!work.empty())
+    {
+        IRBlock* block = work.back();
+        work.pop_back();
+        for (std::vector<IRBlock*>::iterator it = block->succ.begin(); it != block->succ.end(); ++it)
+        {
+            (*it)->pred.push_back(block);
+            if (!reachable[(*it)->index])
+            {
+                reachable[(*it)->index] = true;
+                work.push_back(*it);
+            }
+        }
+    }
+    std::vector<bool> keep(blocks.size(), false);
+    std::vector<IRBlock*> placed;
+    for (std::vector<IRBlock*>::iterator it = layout.begin(); it != layout.end(); ++it)
+        if (*it != exit && reachable[(*it)->index] && !keep[(*it)->index])
+        {
+            keep[(*it)->index] = true;
+            placed.push_back(*it);
+        }
+    keep[exit->index] = true;
+    placed.push_back(exit);
+    for (std::vector<IRBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+        if (!keep[(*it)->index]) delete *it;
+    blocks.swap(placed);
+    layout = blocks;
+    for (unsigned i = 0; i < blocks.size(); ++i)
+        blocks[i]->index = i;
+}
+
+static bool IsPromotable(const SymVar* var)
+{
+    if (var->GetVarType()->GetSize() != 4 || var->GetVarType() == top_type_real) return false;
+    if (var->GetClassName() & SYM_VAR_LOCAL) return true;
+    return (var->GetClassName() & SYM_VAR_PARAM) && !((SymVarParam*)var)->IsByRef();
+}
+
+void IRFunction::PromoteVars()
+{
+    std::set<const SymVar*> pinned;
+    VarsContainer pinned_vars;
+    std::vector<const SymVar*> candidates;
+    std::map<const SymVar*, int> promoted;
+    for (std::vector<IRBlock*>::iterator block = blocks.begin(); block != blocks.end(); ++block)
+        for (std::vector<IRInstr>::iterator it = (*block)->instrs.begin(); it != (*block)->instrs.end(); ++it)
+        {
+            switch (it->op)
+            {
+                case IR_VAR_ADDR:
+                    pinned.insert(it->var);
+                break;
+                case IR_LOAD_VAR:
+                case IR_STORE_VAR:
+                    if (it->type != IR_INT || !IsPromotable(it->var)) pinned.insert(it->var);
+                    else if (promoted.insert(make_pair(it->var, IR_NO_TEMP)).second) candidates.push_back(it->var);
+                break;
+                case IR_STACK_VALUE:
+                case IR_STACK_ARG:
+                    const_cast<SyntaxNode*>(it->node)->GetAllDependences(pinned_vars);
+                    const_cast<SyntaxNode*>(it->node)->GetAllAffectedVars(pinned_vars);
+                break;
+                case IR_STACK_STMT:
+                    it->stmt->GetAllDependences(pinned_vars);
+                    it->stmt->GetAllAffectedVars(pinned_vars);
+                break;
+                default:
+                break;
+            }
+        }
+    std::vector<IRInstr> params_load;
+    std::set<const SymVar*> stored;
+    for (std::vector<const SymVar*>::iterator it = candidates.begin(); it != candidates.end(); ++it)
+    {
+        if (pinned.find(*it) != pinned.end() || pinned_vars.IsContain(*it))
+        {
+            promoted.erase(*it);
+            continue;
+        }
+        promoted[*it] = NewTemp(IR_INT);
+        temp_vars.resize(temps.size(), NULL);
+        temp_vars.back() = *it;
+        if (!((*it)->GetClassName() & SYM_VAR_PARAM)) continue;
+        IRInstr load(IR_LOAD_VAR, IR_INT, promoted[*it]);
+        load.var = *it;
+        params_load.push_back(load);
+    }
+    for (std::vector<IRBlock*>::iterator block = blocks.begin(); block != blocks.end(); ++block)
+        for (std::vector<IRInstr>::iterator it = (*block)->instrs.begin(); it != (*block)->instrs.end(); ++it)
+        {
+            if (it->op != IR_LOAD_VAR && it->op != IR_STORE_VAR) continue;
+            std::map<const SymVar*, int>::iterator var = promoted.find(it->var);
+            if (var == promoted.end()) continue;
+            if (it->op == IR_LOAD_VAR) it->a = var->second;
+            else
+            {
+                it->dst = var->second;
+                stored.insert(it->var);
+            }
+            it->op = IR_COPY;
+            it->var = NULL;
+        }
+    if (params_load.empty()) return;
+    if (!entry->pred.empty())
+    {
+        IRBlock* block = NewBlock();
+        block->instrs.push_back(IRInstr(IR_JUMP, IR_VOID));
+        block->succ.push_back(entry);
+        layout.insert(layout.begin(), block);
+        entry = block;
+        BuildCFG();
+    }
+    entry->instrs.insert(entry->instrs.begin(), params_load.begin(), params_load.end());
+    for (std::vector<IRInstr>::iterator it = params_load.begin(); it != params_load.end(); ++it)
+    {
+        if (stored.find(it->var) == stored.end()) continue;
+        IRInstr store(IR_STORE_VAR, IR_INT, IR_NO_TEMP, it->dst);
+        store.var = it->var;
+        exit->instrs.push_back(store);
+    }
+}
+
+void IRFunction::PropagateCopies()
+{
+    std::vector<int> copy_of(temps.size(), IR_NO_TEMP);
+    std::vector<std::vector<int> > copies(temps.size());
+    for (std::vector<IRBlock*>::iterator block = blocks.begin(); block != blocks.end(); ++block)
+    {
+        std::vector<int> touched;
+        for (std::vector<IRInstr>::iterator it = (*block)->instrs.begin(); it != (*block)->instrs.end(); ++it)
+        {
+            if (it->a != IR_NO_TEMP && copy_of[it->a] != IR_NO_TEMP) it->a = copy_of[it->a];
+            if (it->b != IR_NO_TEMP && copy_of[it->b] != IR_NO_TEMP) it->b = copy_of[it->b];
+            if (it->dst == IR_NO_TEMP) continue;
+            for (std::vector<int>::iterator copy = copies[it->dst].begin(); copy != copies[it->dst].end(); ++copy)
+                if (copy_of[*copy] == it->dst) copy_of[*copy] = IR_NO_TEMP;
+            copies[it->dst].clear();
+            copy_of[it->dst] = IR_NO_TEMP;
+            if (it->op != IR_COPY || it->a == it->dst) continue;
+            copy_of[it->dst] = it->a;
+            copies[it->a].push_back(it->dst);
+            touched.push_back(it->dst);
+            touched.push_back(it->a);
+        }
+        for (std::vector<int>::iterator it = touched.begin(); it != touched.end(); ++it)
+        {
+            copy_of[*it] = IR_NO_TEMP;
+            copies[*it].clear();
+        }
+    }
+    std::vector<unsigned> uses(temps.size(), 0);
+    for (std::vector<IRBlock*>::iterator block = blocks.begin(); block != blocks.end(); ++block)
+        for (std::vector<IRInstr>::iterator it = (*block)->instrs.begin(); it != (*block)->instrs.end(); ++it)
+        {
+            if (it->a != IR_NO_TEMP) ++uses[it->a];
+            if (it->b != IR_NO_TEMP) ++uses[it->b];
+        }
+    for (std::vector<IRBlock*>::iterator block = blocks.begin(); block != blocks.end(); ++block)
+    {
+        std::vector<IRInstr>& instrs = (*block)->instrs;
+        for (int j = 0; j < (int)instrs.size(); ++j)
+        {
+            IRInstr& copy = instrs[j];
+            if (copy.op != IR_COPY || copy.a == copy.dst || uses[copy.a] != 1 || temps[copy.a] != temps[copy.dst]) continue;
+            for (int i = j - 1; i >= 0; --i)
+            {
+                if (instrs[i].dst == copy.a)
+                {
+                    instrs[i].dst = copy.dst;
+                    copy.a = copy.dst;
+                    break;
+                }
+                if (instrs[i].dst == copy.dst || instrs[i].a == copy.dst || instrs[i].b == copy.dst) break;
+            }
+        }
+    }
+}
+
+void IRFunction::RemoveDeadCode()
+{
+    std::vector<unsigned> uses(temps.size(), 0);
+    for (std::vector<IRBlock*>::iterator block = blocks.begin(); block != blocks.end(); ++block)
+        for (std::vector<IRInstr>::iterator it = (*block)->instrs.begin(); it != (*block)->instrs.end(); ++it)
+        {
+            if (it->a != IR_NO_TEMP) ++uses[it->a];
+            if (it->b != IR_NO_TEMP) ++uses[it->b];
+        }
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (std::vector<IRBlock*>::reverse_iterator block = blocks.rbegin(); block != blocks.rend(); ++block)
+        {
+            std::vector<IRInstr>& instrs = (*block)->instrs;
+            std::vector<IRInstr> live;
+            for (std::vector<IRInstr>::reverse_iterator it = instrs.rbegin(); it != instrs.rend(); ++it)
+            {
+                bool self_copy = it->op == IR_COPY && it->a == it->dst;
+                if (!self_copy && !(it->IsPure() && it->dst != IR_NO_TEMP && !uses[it->dst]))
+                {
+                    live.push_back(*it);
+                    continue;
+                }
+                if (it->a != IR_NO_TEMP) --uses[it->a];
+                if (it->b != IR_NO_TEMP) --uses[it->b];
+                if (!self_copy) changed = true;
+            }
+            if (live.size() == instrs.size()) continue;
+            instrs.assign(live.rbegin(), live.rend());
+        }
+    }
+}
+
+void IRFunction::AssignRegister(int temp, RegisterName reg)
+{
+    temp_regs[temp] = reg;
+}
+
+void IRFunction::Spill(int temp)
+{
+    temp_regs[temp] = IR_NO_REG;
+    if (temp_vars[temp] == NULL) temp_slots[temp] = slots_count++;
+}
+
+int IRFunction::GetRegister(int temp) const
+{
+    return temp_regs[temp];
+}
+
+void IRFunction::Prepare(bool x64)
+{
+    if (allocated) return;
+    BuildCFG();
+    PromoteVars();
+    PropagateCopies();
+    RemoveDeadCode();
+    temp_regs.assign(temps.size(), IR_NO_REG);
+    temp_slots.assign(temps.size(), -1);
+    temp_vars.resize(temps.size(), NULL);
+    LinearScan(*this, x64).Run();
+    bool has_stack_code = false;
+    for (std::vector<IRBlock*>::iterator block = blocks.begin(); block != blocks.end(); ++block)
+        for (std::vector<IRInstr>::iterator it = (*block)->instrs.begin(); it != (*block)->instrs.end(); ++it)
+            has_stack_code |= it->op == IR_STACK_VALUE || it->op == IR_STACK_ARG || it->op == IR_STACK_STMT;
+    if (has_stack_code || IsRegisterUsed(REG_EBX)) saved_regs.push_back(REG_EBX);
+    if (IsRegisterUsed(REG_ESI)) saved_regs.push_back(REG_ESI);
+    if (IsRegisterUsed(REG_EDI)) saved_regs.push_back(REG_EDI);
+    for (int reg = REG_R12D; reg <= REG_R15D; ++reg)
+        if (IsRegisterUsed((RegisterName)reg)) saved_regs.push_back((RegisterName)reg);
+    allocated = true;
+}
+
+void IRFunction::Print(ostream& o) const
+{
+    for (std::vector<IRBlock*>::const_iterator it = blocks.begin(); it != blocks.end(); ++it)
+        (*it)->Print(o);
+    if (!allocated) return;
+    for (unsigned i = 0; i < temps.size(); ++i)
+    {
+        if (temp_regs[i] == IR_NO_REG && temp_slots[i] < 0 && temp_vars[i] == NULL) continue;
+        o << "  ; t" << i << " -> ";
+        if (InRegister(i)) AsmRegister((RegisterName)temp_regs[i]).Print(o);
+        else TempSlot(i).Print(o);
+        o << '\n';
+    }
+}
+
+void IRFunction::Print(ostream& o, const char* name, bool allocate)
+{
+    if (allocate) Prepare();
+    else BuildCFG();
+    o << name << ":\n";
+    Print(o);
+}
+
+bool IRFunction::IsRegisterUsed(RegisterName reg) const
+{
+    return std::find(temp_regs.begin(), temp_regs.end(), (int)reg) != temp_regs.end();
+}
+
+bool IRFunction::InRegister(int temp) const
+{
+    return temp_regs[temp] != IR_NO_REG;
+}
+
+AsmOperand* IRFunction::Location(int temp) const
+{
+    if (InRegister(temp)) return new AsmRegister((RegisterName)temp_regs[temp]);
+    return new AsmMemory(TempSlot(temp));
+}
+
+AsmMemory IRFunction::HomeSlot(const SymVar* var) const
+{
+    if (var->GetClassName() & SYM_VAR_LOCAL)
+        return AsmMemory(REG_EBP, -(int)((SymVarLocal*)var)->GetOffset() - 4);
+    return AsmMemory(REG_EBP, ((SymVarParam*)var)->GetOffset());
+}
+
+AsmMemory IRFunction::TempSlot(int temp) const
+{
+    if (temp_vars[temp] != NULL) return HomeSlot(temp_vars[temp]);
+    return AsmMemory(REG_EBP, -(int)locals_size - 4 * (temp_slots[temp] + 1));
+}
+
+AsmMemory IRFunction::SaveSlot(unsigned i) const
+{
+    return AsmMemory(REG_EBP, -(int)locals_size - 4 * (slots_count + i + 1));
+}
+
+AsmMemory IRFunction::VarMemory(const SymVar* var, AsmCode& asm_code, RegisterName tmp) const
+{
+    if (var->GetClassName() & SYM_VAR_GLOBAL)
+        return AsmMemory(((SymVarGlobal*)var)->GetLabel());
+    if (!(var->GetClassName() & SYM_VAR_PARAM) || !((SymVarParam*)var)->IsByRef()) return HomeSlot(var);
+    asm_code.AddCmd(ASM_MOV, AsmMemory(REG_EBP, ((SymVarParam*)var)->GetOffset()), tmp);
+    return AsmMemory(tmp);
+}
+
+RegisterName IRFunction::TargetReg(int temp, RegisterName scratch) const
+{
+    return InRegister(temp) ? (RegisterName)temp_regs[temp] : scratch;
+}
+
+RegisterName IRFunction::LoadTemp(AsmCode& asm_code, int temp, RegisterName scratch) const
+{
+    if (InRegister(temp)) return (RegisterName)temp_regs[temp];
+    asm_code.AddCmd(ASM_MOV, TempSlot(temp), scratch);
+    return scratch;
+}
+
+void IRFunction::MoveTemp(AsmCode& asm_code, int temp, RegisterName reg) const
+{
+    if (temp_regs[temp] != reg) asm_code.AddCmd(ASM_MOV, Location(temp), new AsmRegister(reg));
+}
+
+void IRFunction::StoreTemp(AsmCode& asm_code, RegisterName reg, int temp) const
+{
+    if (!InRegister(temp)) asm_code.AddCmd(ASM_MOV, reg, TempSlot(temp));
+    else if (temp_regs[temp] != reg) asm_code.AddCmd(ASM_MOV, reg, (RegisterName)temp_regs[temp]);
+}
+
+void IRFunction::LowerIntBinary(AsmCode& asm_code, const IRInstr& instr) const
+{
+    switch (instr.op)
+    {
+        case IR_DIV:
+        case IR_MOD:
+            MoveTemp(asm_code, instr.a, REG_EAX);
+            asm_code.AddCmd(ASM_XOR, REG_EDX, REG_EDX);
+            asm_code.AddCmd(ASM_IDIV, Location(instr.b));
+            StoreTemp(asm_code, instr.op == IR_MOD ? REG_EDX : REG_EAX, instr.dst);
+        break;
+        case IR_SHL:
+        case IR_SHR:
+        {
+            bool save_ecx = temp_regs[instr.b] != REG_ECX && IsRegisterUsed(REG_ECX);
+            MoveTemp(asm_code, instr.a, REG_EAX);
+            if (save_ecx) asm_code.AddCmd(ASM_PUSH, REG_ECX);
+            MoveTemp(asm_code, instr.b, REG_ECX);
+            asm_code.AddCmd(instr.op == IR_SHL ? ASM_SAL : ASM_SAR, REG_CL, REG_EAX);
+            if (save_ecx) asm_code.AddCmd(ASM_POP, REG_ECX);
+            StoreTemp(asm_code, REG_EAX, instr.dst);
+        }
+        break;
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_LE:
+        case IR_GT:
+        case IR_GE:
+        {
+            static const AsmCmdName SETCC[] = { ASM_SETE, ASM_SETNE, ASM_SETL, ASM_SETLE, ASM_SETG, ASM_SETGE };
+            RegisterName left = LoadTemp(asm_code, instr.a, REG_EAX);
+            asm_code.AddCmd(ASM_CMP, Location(instr.b), new AsmRegister(left));
+            asm_code.AddCmd(SETCC[instr.op - IR_EQ], REG_AL, SIZE_NONE);
+            RegisterName res = TargetReg(instr.dst, REG_EAX);
+            asm_code.AddCmd(ASM_MOVZB, REG_AL, res);
+            StoreTemp(asm_code, res, instr.dst);
+        }
+        break;
+        default:
+        {
+            AsmCmdName cmd = ASM_ADD;
+            switch (instr.op)
+            {
+                case IR_SUB:
+                    cmd = ASM_SUB;
+                break;
+                case IR_MUL:
+                    cmd = ASM_IMUL;
+                break;
+                case IR_AND:
+                    cmd = ASM_AND;
+                break;
+                case IR_OR:
+                    cmd = ASM_OR;
+                break;
+                case IR_XOR:
+                    cmd = ASM_XOR;
+                break;
+                default:
+                break;
+            }
+            int left = instr.a;
+            int right = instr.b;
+            RegisterName res = TargetReg(instr.dst, REG_EAX);
+            if (temp_regs[right] == res && temp_regs[left] != res)
+            {
+                if (instr.op == IR_SUB) res = REG_EAX;
+                else std::swap(left, right);
+            }
+            MoveTemp(asm_code, left, res);
+            asm_code.AddCmd(cmd, Location(right), new AsmRegister(res));
+            StoreTemp(asm_code, res, instr.dst);
+        }
+    }
+}
+
+void IRFunction::LowerRealBinarySSE(AsmCode& asm_code, const IRInstr& instr) const
+{
+    asm_code.AddCmd(ASM_MOVSS, TempSlot(instr.a), REG_XMM0, SIZE_NONE);
+    switch (instr.op)
+    {
+        case IR_ADD:
+            asm_code.AddCmd(ASM_ADDSS, TempSlot(instr.b), REG_XMM0, SIZE_NONE);
+        break;
+        case IR_SUB:
+            asm_code.AddCmd(ASM_SUBSS, TempSlot(instr.b), REG_XMM0, SIZE_NONE);
+        break;
+        case IR_MUL:
+            asm_code.AddCmd(ASM_MULSS, TempSlot(instr.b), REG_XMM0, SIZE_NONE);
+        break;
+        case IR_DIV:
+            asm_code.AddCmd(ASM_DIVSS, TempSlot(instr.b), REG_XMM0, SIZE_NONE);
+        break;
+        default:
+        {
+            static const AsmCmdName SETCC[] = { ASM_SETE, ASM_SETNE, ASM_SETB, ASM_SETBE, ASM_SETA, ASM_SETAE };
+            asm_code.AddCmd(ASM_UCOMISS, TempSlot(instr.b), REG_XMM0, SIZE_NONE);
+            asm_code.AddCmd(SETCC[instr.op - IR_EQ], REG_AL, SIZE_NONE);
+            RegisterName res = TargetReg(instr.dst, REG_EAX);
+            asm_code.AddCmd(ASM_MOVZB, REG_AL, res);
+            StoreTemp(asm_code, res, instr.dst);
+            return;
+        }
+    }
+    asm_code.AddCmd(ASM_MOVSS, REG_XMM0, TempSlot(instr.dst), SIZE_NONE);
+}
+
+void IRFunction::LowerRealBinary(AsmCode& asm_code, const IRInstr& instr) const
+{
+    if (asm_code.IsSSEEnabled())
+    {
+        LowerRealBinarySSE(asm_code, instr);
+        return;
+    }
+    asm_code.AddCmd(ASM_FLD, TempSlot(instr.a), SIZE_SHORT);
+    asm_code.AddCmd(ASM_FLD, TempSlot(instr.b), SIZE_SHORT);
+    switch (instr.op)
+    {
+        case IR_ADD:
+            asm_code.AddCmd(ASM_FADDP, REG_ST, REG_ST1, SIZE_NONE);
+        break;
+        case IR_SUB:
+            asm_code.AddCmd(ASM_FSUBRP, REG_ST, REG_ST1, SIZE_NONE);
+        break;
+        case IR_MUL:
+            asm_code.AddCmd(ASM_FMULP, REG_ST, REG_ST1, SIZE_NONE);
+        break;
+        case IR_DIV:
+            asm_code.AddCmd(ASM_FDIVRP, REG_ST, REG_ST1, SIZE_NONE);
+        break;
+        default:
+        {
+            static const AsmCmdName SETCC[] = { ASM_SETE, ASM_SETNE, ASM_SETB, ASM_SETBE, ASM_SETA, ASM_SETAE };
+            asm_code.AddCmd(ASM_FXCH, REG_ST1, SIZE_NONE);
+            asm_code.AddCmd(ASM_FCOMPP, SIZE_NONE);
+            asm_code.AddCmd(ASM_FNSTSW, REG_AX, SIZE_NONE);
+            asm_code.AddCmd(ASM_SAHF, SIZE_NONE);
+            asm_code.AddCmd(SETCC[instr.op - IR_EQ], REG_AL, SIZE_NONE);
+            RegisterName res = TargetReg(instr.dst, REG_EAX);
+            asm_code.AddCmd(ASM_MOVZB, REG_AL, res);
+            StoreTemp(asm_code, res, instr.dst);
+            return;
+        }
+    }
+    asm_code.AddCmd(ASM_FSTP, TempSlot(instr.dst), SIZE_SHORT);
+}
+
+void IRFunction::LowerInstr(AsmCode& asm_code, const IRInstr& instr) const
+{
+    switch (instr.op)
+    {
+        case IR_CONST:
+            asm_code.AddCmd(ASM_MOV, new AsmIntImmediate(instr.imm), Location(instr.dst));
+        break;
+        case IR_COPY:
+            if (InRegister(instr.dst))
+            {
+                MoveTemp(asm_code, instr.a, (RegisterName)temp_regs[instr.dst]);
+                break;
+            }
+            asm_code.AddCmd(ASM_MOV, LoadTemp(asm_code, instr.a, REG_EAX), TempSlot(instr.dst));
+        break;
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_DIV:
+        case IR_MOD:
+        case IR_AND:
+        case IR_OR:
+        case IR_XOR:
+        case IR_SHL:
+        case IR_SHR:
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_LE:
+        case IR_GT:
+        case IR_GE:
+            if (instr.type == IR_REAL) LowerRealBinary(asm_code, instr);
+            else LowerIntBinary(asm_code, instr);
+        break;
+        case IR_NEG:
+        {
+            if (instr.type == IR_REAL && asm_code.IsSSEEnabled())
+            {
+                asm_code.AddCmd(ASM_MOV, TempSlot(instr.a), REG_EAX);
+                asm_code.AddCmd(ASM_XOR, AsmIntImmediate(0x80000000), REG_EAX);
+                asm_code.AddCmd(ASM_MOV, REG_EAX, TempSlot(instr.dst));
+                break;
+            }
+            if (instr.type == IR_REAL)
+            {
+                asm_code.AddCmd(ASM_FLD, TempSlot(instr.a), SIZE_SHORT);
+                asm_code.AddCmd(ASM_FCH, SIZE_SHORT);
+                asm_code.AddCmd(ASM_FSTP, TempSlot(instr.dst), SIZE_SHORT);
+                break;
+            }
+            RegisterName res = TargetReg(instr.dst, REG_EAX);
+            MoveTemp(asm_code, instr.a, res);
+            asm_code.AddCmd(ASM_NEG, res);
+            StoreTemp(asm_code, res, instr.dst);
+        }
+        break;
+        case IR_NOT:
+        {
+            RegisterName value = LoadTemp(asm_code, instr.a, REG_EAX);
+            asm_code.AddCmd(ASM_TEST, value, value);
+            asm_code.AddCmd(ASM_SETE, REG_AL, SIZE_NONE);
+            RegisterName res = TargetReg(instr.dst, REG_EAX);
+            asm_code.AddCmd(ASM_MOVZB, REG_AL, res);
+            StoreTemp(asm_code, res, instr.dst);
+        }
+        break;
+        case IR_INT_TO_REAL:
+            if (asm_code.IsSSEEnabled())
+            {
+                asm_code.AddCmd(ASM_CVTSI2SS, Location(instr.a), new AsmRegister(REG_XMM0));
+                asm_code.AddCmd(ASM_MOVSS, REG_XMM0, TempSlot(instr.dst), SIZE_NONE);
+                break;
+            }
+            if (InRegister(instr.a))
+            {
+                asm_code.AddCmd(ASM_PUSH, (RegisterName)temp_regs[instr.a]);
+                asm_code.AddCmd(ASM_FILD, AsmMemory(REG_ESP));
+                asm_code.AddCmd(ASM_ADD, 4, REG_ESP);
+            }
+            else
+                asm_code.AddCmd(ASM_FILD, TempSlot(instr.a));
+            asm_code.AddCmd(ASM_FSTP, TempSlot(instr.dst), SIZE_SHORT);
+        break;
+        case IR_LOAD_VAR:
+        {
+            if (!InRegister(instr.dst) && temp_vars[instr.dst] == instr.var) break;
+            RegisterName res = TargetReg(instr.dst, REG_EAX);
+            asm_code.AddCmd(ASM_MOV, VarMemory(instr.var, asm_code, REG_EDX), res);
+            StoreTemp(asm_code, res, instr.dst);
+        }
+        break;
+        case IR_STORE_VAR:
+        {
+            if (!InRegister(instr.a) && temp_vars[instr.a] == instr.var) break;
+            RegisterName value = LoadTemp(asm_code, instr.a, REG_EAX);
+            asm_code.AddCmd(ASM_MOV, value, VarMemory(instr.var, asm_code, REG_EDX));
+        }
+        break;
+        case IR_VAR_ADDR:
+        {
+            RegisterName res = TargetReg(instr.dst, REG_EAX);
+            if (instr.var->GetClassName() & SYM_VAR_GLOBAL)
+                asm_code.AddCmd(ASM_MOV, ((SymVarGlobal*)instr.var)->GetLabel(), res);
+            else if ((instr.var->GetClassName() & SYM_VAR_PARAM) && ((SymVarParam*)instr.var)->IsByRef())
+                asm_code.AddCmd(ASM_MOV, AsmMemory(REG_EBP, ((SymVarParam*)instr.var)->GetOffset()), res);
+            else
+                asm_code.AddCmd(ASM_LEA, VarMemory(instr.var, asm_code, REG_EDX), res);
+            StoreTemp(asm_code, res, instr.dst);
+        }
+        break;
+        case IR_LOAD:
+        {
+            RegisterName base = LoadTemp(asm_code, instr.a, REG_EDX);
+            RegisterName res = TargetReg(instr.dst, REG_EAX);
+            asm_code.AddCmd(ASM_MOV, AsmMemory(base), res);
+            StoreTemp(asm_code, res, instr.dst);
+        }
+        break;
+        case IR_STORE:
+        {
+            RegisterName base = LoadTemp(asm_code, instr.a, REG_EDX);
+            RegisterName value = LoadTemp(asm_code, instr.b, REG_EAX);
+            asm_code.AddCmd(ASM_MOV, value, AsmMemory(base));
+        }
+        break;
+        case IR_STACK_VALUE:
+        {
+            instr.node->GenerateValue(asm_code);
+            RegisterName res = TargetReg(instr.dst, REG_EAX);
+            asm_code.AddCmd(ASM_POP, res);
+            StoreTemp(asm_code, res, instr.dst);
+        }
+        break;
+        case IR_STACK_ARG:
+            instr.node->GenerateValue(asm_code);
+        break;
+        case IR_STACK_STMT:
+            instr.stmt->Generate(asm_code);
+        break;
+        case IR_RESERVE:
+            asm_code.AddCmd(ASM_SUB, instr.imm, REG_ESP);
+        break;
+        case IR_ARG:
+            asm_code.AddCmd(ASM_PUSH, Location(instr.a));
+        break;
+        case IR_CALL:
+        {
+            asm_code.AddCmd(ASM_CALL, AsmMemory(instr.proc->GetLabel()));
+            if (instr.dst == IR_NO_TEMP) break;
+            RegisterName res = TargetReg(instr.dst, REG_EAX);
+            asm_code.AddCmd(ASM_POP, res);
+            StoreTemp(asm_code, res, instr.dst);
+        }
+        break;
+        case IR_WRITE:
+            asm_code.AddCmd(ASM_PUSH, Location(instr.a));
+            if (instr.type == IR_REAL) asm_code.GenCallWriteForReal();
+            else asm_code.GenCallWriteForInt();
+        break;
+        case IR_WRITE_STR:
+            asm_code.AddCmd(ASM_PUSH, Location(instr.a));
+            asm_code.GenCallWriteForStr();
+        break;
+        case IR_WRITE_LN:
+            asm_code.GenWriteNewLine();
+        break;
+        case IR_JUMP:
+        break;
+        case IR_BRANCH:
+            if (InRegister(instr.a))
+                asm_code.AddCmd(ASM_TEST, (RegisterName)temp_regs[instr.a], (RegisterName)temp_regs[instr.a]);
+            else
+                asm_code.AddCmd(ASM_CMP, AsmIntImmediate(0), TempSlot(instr.a));
+        break;
+    }
+}
+
+void IRFunction::Lower(AsmCode& asm_code)
+{
+    Prepare(asm_code.IsX64Enabled());
+    for (std::vector<IRBlock*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+        (*it)->label = asm_code.GenLabel("bb");
+    unsigned frame_size = locals_size + 4 * (slots_count + saved_regs.size());
+    if (frame_size) asm_code.AddCmd(ASM_SUB, frame_size, REG_ESP);
+    for (unsigned i = 0; i < saved_regs.size(); ++i)
+        asm_code.AddCmd(ASM_MOV, saved_regs[i], SaveSlot(i));
+    for (unsigned i = 0; i < blocks.size(); ++i)
+    {
+        IRBlock* block = blocks[i];
+        IRBlock* next = i + 1 < blocks.size() ? blocks[i + 1] : NULL;
+        if (!block->pred.empty()) asm_code.AddLabel(block->label);
+        for (std::vector<IRInstr>::const_iterator it = block->instrs.begin(); it != block->instrs.end(); ++it)
+            LowerInstr(asm_code, *it);
+        if (block == exit)
+            for (unsigned j = 0; j < saved_regs.size(); ++j)
+                asm_code.AddCmd(ASM_MOV, SaveSlot(j), saved_regs[j]);
+        if (block->succ.empty()) continue;
+        if (block->succ.size() == 2)
+        {
+            if (block->succ[1] == next)
+            {
+                asm_code.AddCmd(ASM_JNZ, block->succ[0]->label, SIZE_NONE);
+                continue;
+            }
+            asm_code.AddCmd(ASM_JZ, block->succ[1]->label, SIZE_NONE);
+        }
+        if (block->succ[0] != next) asm_code.AddCmd(ASM_JMP, block->succ[0]->label, SIZE_NONE);
+    }
+}
+
+//---IRBuilder---
+
+IRBuilder::IRBuilder(IRFunction& func_):
+    func(func_),
+    current(func_.GetEntry())
+{
+}
+
+IRFunction& IRBuilder::GetFunction()
+{
+    return func;
+}
+
+IRBlock* IRBuilder::NewBlock()
+{
+    return func.NewBlock();
+}
+
+void IRBuilder::SetBlock(IRBlock* block)
+{
+    if (!current->IsTerminated()) Jump(block);
+    func.PlaceBlock(block);
+    current = block;
+}
+
+void IRBuilder::Emit(const IRInstr& instr)
+{
+    if (current->IsTerminated()) SetBlock(NewBlock());
+    current->instrs.push_back(instr);
+}
+
+int IRBuilder::Const(int value, IRType type)
+{
+    int dst = func.NewTemp(type);
+    Emit(IRInstr(IR_CONST, type, dst, IR_NO_TEMP, IR_NO_TEMP, value));
+    return dst;
+}
+
+int IRBuilder::Binary(IROpcode op, IRType type, int a, int b)
+{
+    int dst = func.NewTemp(op >= IR_EQ && op <= IR_GE ? IR_INT : type);
+    Emit(IRInstr(op, type, dst, a, b));
+    return dst;
+}
+
+int IRBuilder::Unary(IROpcode op, IRType type, int a)
+{
+    int dst = func.NewTemp(op == IR_INT_TO_REAL ? IR_REAL : type);
+    Emit(IRInstr(op, type, dst, a));
+    return dst;
+}
+
+int IRBuilder::LoadVar(const SymVar* var, IRType type)
+{
+    IRInstr instr(IR_LOAD_VAR, type, func.NewTemp(type));
+    instr.var = var;
+    Emit(instr);
+    return instr.dst;
+}
+
+void IRBuilder::StoreVar(const SymVar* var, int value)
+{
+    IRInstr instr(IR_STORE_VAR, func.GetTempType(value), IR_NO_TEMP, value);
+    instr.var = var;
+    Emit(instr);
+}
+
+int IRBuilder::VarAddr(const SymVar* var)
+{
+    IRInstr instr(IR_VAR_ADDR, IR_INT, func.NewTemp(IR_INT));
+    instr.var = var;
+    Emit(instr);
+    return instr.dst;
+}
+
+int IRBuilder::AddOffset(int addr, int offset)
+{
+    if (!offset) return addr;
+    return Binary(IR_ADD, IR_INT, addr, Const(offset));
+}
+
+int IRBuilder::Load(int addr, IRType type)
+{
+    int dst = func.NewTemp(type);
+    Emit(IRInstr(IR_LOAD, type, dst, addr));
+    return dst;
+}
+
+void IRBuilder::Store(int addr, int value)
+{
+    Emit(IRInstr(IR_STORE, func.GetTempType(value), IR_NO_TEMP, addr, value));
+}
+
+int IRBuilder::StackValue(const SyntaxNode* node, IRType type)
+{
+    IRInstr instr(IR_STACK_VALUE, type, func.NewTemp(type));
+    instr.node = node;
+    Emit(instr);
+    return instr.dst;
+}
+
+void IRBuilder::StackArg(const SyntaxNode* node)
+{
+    IRInstr instr(IR_STACK_ARG, IR_VOID);
+    instr.node = node;
+    Emit(instr);
+}
+
+void IRBuilder::StackStmt(NodeStatement* stmt)
+{
+    IRInstr instr(IR_STACK_STMT, IR_VOID);
+    instr.stmt = stmt;
+    Emit(instr);
+}
+
+void IRBuilder::Reserve(unsigned size)
+{
+    Emit(IRInstr(IR_RESERVE, IR_VOID, IR_NO_TEMP, IR_NO_TEMP, IR_NO_TEMP, size));
+}
+
+void IRBuilder::Arg(int value)
+{
+    Emit(IRInstr(IR_ARG, func.GetTempType(value), IR_NO_TEMP, value));
+}
+
+int IRBuilder::Call(SymProc* proc, IRType result_type)
+{
+    int dst = result_type == IR_VOID ? IR_NO_TEMP : func.NewTemp(result_type);
+    IRInstr instr(IR_CALL, result_type, dst);
+    instr.proc = proc;
+    Emit(instr);
+    return dst;
+}
+
+void IRBuilder::Write(int value, IRType type)
+{
+    Emit(IRInstr(IR_WRITE, type, IR_NO_TEMP, value));
+}
+
+void IRBuilder::WriteStr(int value)
+{
+    Emit(IRInstr(IR_WRITE_STR, IR_INT, IR_NO_TEMP, value));
+}
+
+void IRBuilder::WriteLn()
+{
+    Emit(IRInstr(IR_WRITE_LN, IR_VOID));
+}
+
+void IRBuilder::Jump(IRBlock* target)
+{
+    Emit(IRInstr(IR_JUMP, IR_VOID));
+    current->succ.push_back(target);
+}
+
+void IRBuilder::Branch(int cond, IRBlock* on_true, IRBlock* on_false)
+{
+    Emit(IRInstr(IR_BRANCH, IR_INT, IR_NO_TEMP, cond));
+    current->succ.push_back(on_true);
+    current->succ.push_back(on_false);
+}
+
+void IRBuilder::PushLoop(const StmtLoop* loop, IRBlock* break_block, IRBlock* continue_block)
+{
+    LoopBlocks blocks = { loop, break_block, continue_block };
+    loops.push_back(blocks);
+}
+
+void IRBuilder::PopLoop()
+{
+    loops.pop_back();
+}
+
+const IRBuilder::LoopBlocks* IRBuilder::FindLoop(const StmtLoop* loop) const
+{
+    for (std::vector<LoopBlocks>::const_reverse_iterator it = loops.rbegin(); it != loops.rend(); ++it)
+        if (it->loop == loop) return &*it;
+    return NULL;
+}
+
+IRBlock* IRBuilder::GetBreakBlock(const StmtLoop* loop) const
+{
+    const LoopBlocks* blocks = FindLoop(loop);
+    return blocks != NULL ? blocks->break_block : GetExitBlock();
+}
+
+IRBlock* IRBuilder::GetContinueBlock(const StmtLoop* loop) const
+{
+    const LoopBlocks* blocks = FindLoop(loop);
+    return blocks != NULL ? blocks->continue_block : GetExitBlock();
+}
+
+IRBlock* IRBuilder::GetExitBlock() const
+{
+    return func.GetExit();
+}
+
+void IRBuilder::Finish()
+{
+    if (!current->IsTerminated()) Jump(func.GetExit());
+}
@@ -0,0 +1,197 @@
+#ifndef IR
+#define IR
+
+#include "generator.h"
+#include <vector>
+#include <ostream>
+
+class SymType;
+class SymVar;
+class SymProc;
+class SyntaxNode;
+class NodeStatement;
+class StmtLoop;
+
+enum IRType{
+    IR_VOID,
+    IR_INT,
+    IR_REAL
+};
+
+enum IROpcode{
+    IR_CONST,
+    IR_COPY,
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_MOD,
+    IR_AND,
+    IR_OR,
+    IR_XOR,
+    IR_SHL,
+    IR_SHR,
+    IR_EQ,
+    IR_NE,
+    IR_LT,
+    IR_LE,
+    IR_GT,
+    IR_GE,
+    IR_NEG,
+    IR_NOT,
+    IR_INT_TO_REAL,
+    IR_LOAD_VAR,
+    IR_STORE_VAR,
+    IR_VAR_ADDR,
+    IR_LOAD,
+    IR_STORE,
+    IR_STACK_VALUE,
+    IR_STACK_ARG,
+    IR_STACK_STMT,
+    IR_RESERVE,
+    IR_ARG,
+    IR_CALL,
+    IR_WRITE,
+    IR_WRITE_STR,
+    IR_WRITE_LN,
+    IR_JUMP,
+    IR_BRANCH
+};
+
+extern const string IR_OPCODE_TO_STR[];
+
+IRType IRTypeOf(const SymType* type);
+
+const int IR_NO_TEMP = -1;
+const int IR_NO_REG = -1;
+
+struct IRInstr{
+    IROpcode op;
+    IRType type;
+    int dst;
+    int a;
+    int b;
+    int imm;
+    const SymVar* var;
+    SymProc* proc;
+    const SyntaxNode* node;
+    NodeStatement* stmt;
+    IRInstr(IROpcode op_, IRType type_ = IR_INT, int dst_ = IR_NO_TEMP,
+            int a_ = IR_NO_TEMP, int b_ = IR_NO_TEMP, int imm_ = 0);
+    bool IsTerminator() const;
+    bool IsPure() const;
+    void Print(ostream& o) const;
+};
+
+class IRBlock{
+public:
+    unsigned index;
+    std::vector<IRInstr> instrs;
+    std::vector<IRBlock*> succ;
+    std::vector<IRBlock*> pred;
+    AsmStrImmediate label;
+    IRBlock(unsigned index_);
+    bool IsTerminated() const;
+    void Print(ostream& o) const;
+};
+
+class IRFunction{
+private:
+    std::vector<IRBlock*> blocks;
+    std::vector<IRBlock*> layout;
+    std::vector<IRType> temps;
+    std::vector<int> temp_regs;
+    std::vector<int> temp_slots;
+    std::vector<const SymVar*> temp_vars;
+    std::vector<RegisterName> saved_regs;
+    IRBlock* entry;
+    IRBlock* exit;
+    unsigned locals_size;
+    unsigned slots_count;
+    bool allocated;
+    bool IsRegisterUsed(RegisterName reg) const;
+    bool InRegister(int temp) const;
+    AsmOperand* Location(int temp) const;
+    AsmMemory HomeSlot(const SymVar* var) const;
+    AsmMemory TempSlot(int temp) const;
+    AsmMemory SaveSlot(unsigned i) const;
+    AsmMemory VarMemory(const SymVar* var, AsmCode& asm_code, RegisterName tmp) const;
+    RegisterName TargetReg(int temp, RegisterName scratch) const;
+    RegisterName LoadTemp(AsmCode& asm_code, int temp, RegisterName scratch) const;
+    void MoveTemp(AsmCode& asm_code, int temp, RegisterName reg) const;
+    void StoreTemp(AsmCode& asm_code, RegisterName reg, int temp) const;
+    void LowerIntBinary(AsmCode& asm_code, const IRInstr& instr) const;
+    void LowerRealBinarySSE(AsmCode& asm_code, const IRInstr& instr) const;
+    void LowerRealBinary(AsmCode& asm_code, const IRInstr& instr) const;
+    void LowerInstr(AsmCode& asm_code, const IRInstr& instr) const;
+public:
+    IRFunction(unsigned locals_size_);
+    ~IRFunction();
+    int NewTemp(IRType type);
+    IRType GetTempType(int temp) const;
+    unsigned GetTempsCount() const;
+    IRBlock* NewBlock();
+    void PlaceBlock(IRBlock* block);
+    IRBlock* GetEntry() const;
+    IRBlock* GetExit() const;
+    const std::vector<IRBlock*>& GetBlocks() const;
+    void Build(NodeStatement* body);
+    void BuildCFG();
+    void PromoteVars();
+    void PropagateCopies();
+    void RemoveDeadCode();
+    void AssignRegister(int temp, RegisterName reg);
+    void Spill(int temp);
+    int GetRegister(int temp) const;
+    void Prepare(bool x64 = false);
+    void Print(ostream& o) const;
+    void Print(ostream& o, const char* name, bool allocate);
+    void Lower(AsmCode& asm_code);
+};
+
+class IRBuilder{
+private:
+    struct LoopBlocks{
+        const StmtLoop* loop;
+        IRBlock* break_block;
+        IRBlock* continue_block;
+    };
+    IRFunction& func;
+    IRBlock* current;
+    std::vector<LoopBlocks> loops;
+    const LoopBlocks* FindLoop(const StmtLoop* loop) const;
+public:
+    IRBuilder(IRFunction& func_);
+    IRFunction& GetFunction();
+    IRBlock* NewBlock();
+    void SetBlock(IRBlock* block);
+    void Emit(const IRInstr& instr);
+    int Const(int value, IRType type = IR_INT);
+    int Binary(IROpcode op, IRType type, int a, int b);
+    int Unary(IROpcode op, IRType type, int a);
+    int LoadVar(const SymVar* var, IRType type);
+    void StoreVar(const SymVar* var, int value);
+    int VarAddr(const SymVar* var);
+    int AddOffset(int addr, int offset);
+    int Load(int addr, IRType type);
+    void Store(int addr, int value);
+    int StackValue(const SyntaxNode* node, IRType type);
+    void StackArg(const SyntaxNode* node);
+    void StackStmt(NodeStatement* stmt);
+    void Reserve(unsigned size);
+    void Arg(int value);
+    int Call(SymProc* proc, IRType result_type);
+    void Write(int value, IRType type);
+    void WriteStr(int value);
+    void WriteLn();
+    void Jump(IRBlock* target);
+    void Branch(int cond, IRBlock* on_true, IRBlock* on_false);
+    void PushLoop(const StmtLoop* loop, IRBlock* break_block, IRBlock* continue_block);
+    void PopLoop();
+    IRBlock* GetBreakBlock(const StmtLoop* loop) const;
+    IRBlock* GetContinueBlock(const StmtLoop* loop) const;
+    IRBlock* GetExitBlock() const;
+    void Finish();
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "jit.h"
+#include "exception.h"
+#include <stdio.h>
+#include <string.h>
+#if defined(__linux__) && defined(__x86_64__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define JIT_SUPPORTED
+#endif
+
+struct JitExternal{
+    const char* name;
+    void* address;
+};
+
+static const JitExternal JIT_EXTERNALS[] = {
+    { "printf", (void*)&printf }
+};
+
+static const unsigned JIT_STUB_SIZE = 16;
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+//---JitRunner---
+
+JitRunner::JitRunner(const AsmEncoder& encoder_):
+    encoder(encoder_),
+    memory(NULL),
+    memory_size(0),
+    text(NULL),
+    stubs(NULL),
+    data(NULL),
+    bss(NULL)
+{
+}
+
+JitRunner::~JitRunner()
+{
+#ifdef JIT_SUPPORTED
+    if (memory != NULL) munmap(memory, memory_size);
+#endif
+}
+
+unsigned char* JitRunner::BindExternal(const string& name)
+{
+    std::map<string, unsigned char*>::iterator it = externals.find(name);
+    if (it != externals.end()) return it->second;
+    void* address = NULL;
+    for (unsigned i = 0; i < sizeof(JIT_EXTERNALS) / sizeof(JIT_EXTERNALS[0]); ++i)
+        if (name == JIT_EXTERNALS[i].name) address = JIT_EXTERNALS[i].address;
+    if (address == NULL) throw CompilerException("jit: unresolved symbol " + name);
+    unsigned char* stub = stubs + JIT_STUB_SIZE * externals.size();
+    unsigned long long value = (unsigned long long)address;
+    stub[0] = 0x49;
+    stub[1] = 0xBB;
+    memcpy(stub + 2, &value, 8);
+    stub[10] = 0x41;
+    stub[11] = 0xFF;
+    stub[12] = 0xE3;
+    externals[name] = stub;
+    return stub;
+}
+
+unsigned char* JitRunner::Resolve(const string& name)
+{
+    const std::map<string, EncSymbol>& symbols = encoder.GetSymbols();
+    std::map<string, EncSymbol>::const_iterator it = symbols.find(name);
+    if (it == symbols.end() || it->second.section == SECTION_UNDEF) return BindExternal(name);
+    switch (it->second.section)
+    {
+        case SECTION_TEXT:
+            return text + it->second.offset;
+        case SECTION_DATA:
+            return data + it->second.offset;
+        default:
+            return bss + it->second.offset;
+    }
+}
+
+void JitRunner::Relocate(const EncReloc& reloc)
+{
+    unsigned char* place = text + reloc.offset;
+    long long value = (long long)Resolve(reloc.symbol) + reloc.addend;
+    if (reloc.kind == RELOC_PC32) value -= (long long)place;
+    if (value != (int)value && (reloc.kind != RELOC_ABS32 || value != (unsigned)value))
+        throw CompilerException("jit: relocation out of range for " + reloc.symbol);
+    unsigned field = (unsigned)value;
+    memcpy(place, &field, 4);
+}
+
+void JitRunner::Load()
+{
+#ifdef JIT_SUPPORTED
+    const std::vector<unsigned char>& code = encoder.GetText();
+    const std::vector<unsigned char>& init = encoder.GetData();
+    const std::vector<EncReloc>& relocs = encoder.GetRelocs();
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t stubs_offset = AlignUp(code.size(), JIT_STUB_SIZE);
+    size_t code_size = AlignUp(stubs_offset + JIT_STUB_SIZE * (sizeof(JIT_EXTERNALS) / sizeof(JIT_EXTERNALS[0])), page);
+    size_t bss_offset = AlignUp(init.size(), 16);
+    memory_size = code_size + AlignUp(bss_offset + encoder.GetBssSize(), page);
+    void* p = mmap(NULL, memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (p == MAP_FAILED)
+    {
+        memory_size = 0;
+        throw CompilerException("jit: can't allocate memory");
+    }
+    memory = (unsigned char*)p;
+    text = memory;
+    stubs = memory + stubs_offset;
+    data = memory + code_size;
+    bss = data + bss_offset;
+    if (!code.empty()) memcpy(text, &code[0], code.size());
+    if (!init.empty()) memcpy(data, &init[0], init.size());
+    for (std::vector<EncReloc>::const_iterator it = relocs.begin(); it != relocs.end(); ++it)
+        Relocate(*it);
+    if (mprotect(memory, code_size, PROT_READ | PROT_EXEC))
+        throw CompilerException("jit: can't make code executable");
+#else
+    throw CompilerException("jit is not supported on this platform");
+#endif
+}
+
+int JitRunner::Run()
+{
+    Load();
+    int (*entry)() = (int (*)())Resolve("main");
+    fflush(stdout);
+    int result = entry();
+    fflush(stdout);
+    return result;
+}
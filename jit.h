@@ -0,0 +1,27 @@
+#ifndef JIT
+#define JIT
+
+#include "encoder.h"
+#include <stddef.h>
+
+class JitRunner{
+private:
+    const AsmEncoder& encoder;
+    unsigned char* memory;
+    size_t memory_size;
+    unsigned char* text;
+    unsigned char* stubs;
+    unsigned char* data;
+    unsigned char* bss;
+    std::map<string, unsigned char*> externals;
+    void Load();
+    unsigned char* BindExternal(const string& name);
+    unsigned char* Resolve(const string& name);
+    void Relocate(const EncReloc& reloc);
+public:
+    JitRunner(const AsmEncoder& encoder_);
+    ~JitRunner();
+    int Run();
+};
+
+#endif
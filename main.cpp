@@ -12,21 +12,37 @@ void PrintHelp()
     cout << "Simplyfied Pascal Compiler\n\
 \n\
 Usage: compiler [option] filename\n\
+(filename \"-\" reads program from standard input)\n\
 Avaible options are:\n\
 \n\
 optimization off\n\
 \t-b\tprint Both syntax tree and symtable\n\
+\t-e\temit Elf64 object file\n\
+\t-f\tgenerate code with sse Floating point\n\
 \t-h\tshow this message\n\
 \t-g\tGenerate code for x86_32 GNU assembler\n\
+\t-i\tprint Intermediate representation\n\
+\t-j\tJit compile and run\n\
 \t-l\tshow Lexems stream\n\
 \t-s\tprint Syntax tree\n\
 \t-t\tprint symTable\n\
+\t-v\trun in bytecode Virtual machine\n\
+\t-x\tgenerate code for X86_64 GNU assembler\n\
 \n\
 optimization on\n\
 \t-B\tprint Both syntax tree and symtable\n\
+\t-E\temit Elf64 object file\n\
+\t-F\tgenerate code with sse Floating point\n\
 \t-G\tGenerate code for x86_32 GNU assembler\n\
+\t-I\tprint Intermediate representation with register allocation\n\
+\t-J\tJit compile and run\n\
 \t-S\tprint Syntax tree\n\
-\t-T\tprint symTable\n";
+\t-T\tprint symTable\n\
+\t-V\trun in bytecode Virtual machine\n\
+\t-X\tgenerate code for X86_64 GNU assembler\n\
+\n\
+optimizing options take an optional inlining threshold, e.g. -G40\n\
+(0 disables procedure inlining)\n";
 }
 
 string my_argv[] = {"compiler.exe", "-l", "test/16.in" };
@@ -53,49 +69,86 @@ int main(int argc, char* argv[])
             else
                 throw CompilerException("uncknown option");
         }
-        ifstream in;
-        in.open(argv[2], ios::in);
-        if (!in.good()) throw CompilerException("can't open file");
         if (argv[1][0] != '-')
             throw CompilerException("invalid option");
         else
             {
-                if (!argv[1][1] || argv[1][2]) throw CompilerException("invalid option");
+                if (!argv[1][1]) throw CompilerException("invalid option");
                 bool optimize = isupper(argv[1][1]);
+                unsigned threshold = INLINE_THRESHOLD;
+                if (argv[1][2])
+                {
+                    if (!optimize || strspn(argv[1] + 2, "0123456789") != strlen(argv[1] + 2))
+                        throw CompilerException("invalid option");
+                    threshold = atoi(argv[1] + 2);
+                }
+                if (!strchr("bstgfxejvil", tolower(argv[1][1]))) throw CompilerException("invalid option");
+                Scanner scan(argv[2]);
                 switch (tolower(argv[1][1]))
                 {
                     case 'b':
                     {
-                        Scanner scan(in);
-                        Parser parser(scan, optimize);
+                        Parser parser(scan, optimize, false, threshold);
                         parser.PrintSymTable(std::cout);
                         parser.PrintSyntaxTree(std::cout);
                     }
                     break;
                     case 's':
                     {
-                        Scanner scan(in);
-                        Parser parser(scan, optimize);
+                        Parser parser(scan, optimize, false, threshold);
                         parser.PrintSyntaxTree(std::cout);
                     }
                     break;
                     case 't':
                     {
-                        Scanner scan(in);
-                        Parser parser(scan, optimize);
+                        Parser parser(scan, optimize, false, threshold);
                         parser.PrintSymTable(std::cout);
                     }
                     break;
                     case 'g':
                     {
-                        Scanner scan(in);
-                        Parser parser(scan, optimize);
+                        Parser parser(scan, optimize, false, threshold);
+                        parser.Generate(std::cout);
+                    }
+                    break;
+                    case 'f':
+                    {
+                        Parser parser(scan, optimize, false, threshold);
+                        parser.EnableSSE();
+                        parser.Generate(std::cout);
+                    }
+                    break;
+                    case 'x':
+                    {
+                        Parser parser(scan, optimize, true, threshold);
                         parser.Generate(std::cout);
                     }
                     break;
+                    case 'e':
+                    {
+                        Parser parser(scan, optimize, true, threshold);
+                        parser.GenerateObject(std::cout);
+                    }
+                    break;
+                    case 'j':
+                    {
+                        Parser parser(scan, optimize, true, threshold);
+                        return parser.Run();
+                    }
+                    case 'v':
+                    {
+                        Parser parser(scan, optimize, false, threshold);
+                        parser.Interpret();
+                    }
+                    break;
+                    case 'i':
+                    {
+                        Parser parser(scan, optimize, false, threshold);
+                        parser.PrintIR(std::cout);
+                    }
+                    break;
                     case 'l':
                     {
-                        Scanner scan(in);
                         for (Token t; t.GetType() != END_OF_FILE;)
                         {
                            cout << ( t = scan.NextToken() );
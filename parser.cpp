@@ -1,4 +1,38 @@
 #include "parser.h"
+#include "peephole.h"
+#include "elf.h"
+#include "jit.h"
+#include "vm.h"
+#include "call_graph.h"
+#include "hoister.h"
+
+enum OperationPriority{
+    PRIOR_NONE,
+    PRIOR_RELATIONAL,
+    PRIOR_ADDING,
+    PRIOR_MULTIPLYING
+};
+
+class OperationPriorityTable{
+private:
+    unsigned char priority[TOK_WRITELN + 1];
+public:
+    OperationPriorityTable()
+    {
+        memset(priority, PRIOR_NONE, sizeof(priority));
+        priority[TOK_LESS] = priority[TOK_GREATER] = priority[TOK_EQUAL] = PRIOR_RELATIONAL;
+        priority[TOK_LESS_OR_EQUAL] = priority[TOK_GREATER_OR_EQUAL] = priority[TOK_NOT_EQUAL] = PRIOR_RELATIONAL;
+        priority[TOK_PLUS] = priority[TOK_MINUS] = priority[TOK_OR] = priority[TOK_XOR] = PRIOR_ADDING;
+        priority[TOK_MULT] = priority[TOK_DIVISION] = priority[TOK_DIV] = priority[TOK_MOD] = PRIOR_MULTIPLYING;
+        priority[TOK_AND] = priority[TOK_SHL] = priority[TOK_SHR] = PRIOR_MULTIPLYING;
+    }
+    int Get(TokenValue value) const
+    {
+        return priority[value];
+    }
+};
+
+static const OperationPriorityTable OPERATION_PRIORITY;
 
 //---Parser---
 
@@ -88,30 +122,90 @@ void Parser::PrintSymTable(ostream& o)
     if (body != NULL) sym_table_stack.back()->Print(o, 0);
 }
 
-void Parser::Generate(ostream& o)
+void Parser::PrintIR(ostream& o)
+{
+    sym_table_stack.back()->PrintIR(o, optimization);
+    IRFunction ir(0);
+    ir.Build(body);
+    ir.Print(o, "main", optimization);
+}
+
+void Parser::EnableSSE()
+{
+    asm_code.EnableSSE();
+}
+
+void Parser::BuildCode(Peephole& peephole)
 {
+    if (optimization) asm_code.EnableIR();
     sym_table_stack.back()->GenerateDeclarations(asm_code);
     asm_code.AddMainFunctionLabel();
     asm_code.AddCmd(ASM_MOV, REG_ESP, REG_EBP);
-    body->Generate(asm_code);
+    if (asm_code.IsIREnabled())
+    {
+        IRFunction ir(0);
+        ir.Build(body);
+        ir.Lower(asm_code);
+    }
+    else
+        body->Generate(asm_code);
     asm_code.AddLabel(exit_label);
     asm_code.AddCmd(ASM_MOV, REG_EBP, REG_ESP);
-    asm_code.AddCmd(ASM_MOV, 0, REG_EAX);
-    asm_code.AddCmd(ASM_RET);
+    asm_code.AddMainFunctionReturn();
+    if (optimization) asm_code.Optimize(peephole);
+    if (asm_code.IsX64Enabled()) asm_code.LowerToX64();
+}
+
+void Parser::Generate(ostream& o)
+{
+    Peephole peephole;
+    BuildCode(peephole);
     asm_code.Print(o);
+    if (optimization) peephole.PrintStats(o);
+}
+
+void Parser::GenerateObject(ostream& o)
+{
+    Peephole peephole;
+    BuildCode(peephole);
+    AsmEncoder encoder;
+    asm_code.Encode(encoder);
+    ElfWriter(encoder).Write(o);
 }
 
-Parser::Parser(Scanner& scanner, bool optimize):
+int Parser::Run()
+{
+    Peephole peephole;
+    BuildCode(peephole);
+    AsmEncoder encoder;
+    asm_code.Encode(encoder);
+    return JitRunner(encoder).Run();
+}
+
+void Parser::Interpret()
+{
+    BCProgram program;
+    BCBuilder builder(program, asm_code.GetParamsOffset());
+    const std::vector<Symbol*>& symbols = sym_table_stack.back()->GetSymbols();
+    for (std::vector<Symbol*>::const_iterator it = symbols.begin(); it != symbols.end(); ++it)
+        if ((*it)->GetClassName() & SYM_VAR_GLOBAL) builder.AddGlobal((SymVar*)*it);
+    builder.Build(body);
+    VirtualMachine(program).Run();
+}
+
+Parser::Parser(Scanner& scanner, bool optimize, bool x64, unsigned inline_threshold_):
     optimization(optimize),
+    inline_threshold(inline_threshold_),
     body(NULL),
     scan(scanner),
     current_proc(NULL)
 {
+    if (x64) asm_code.EnableX64();
     scan.NextToken();
     top_sym_table.Add(top_type_int);
     top_sym_table.Add(top_type_real);
-    sym_table_stack.push_back(&top_sym_table);
-    sym_table_stack.push_back(new SymTable());
+    PushScope(&top_sym_table);
+    PushScope(&global_sym_table);
     exit_label = asm_code.GenLabel("exit");
     Parse();
 }
@@ -142,10 +236,10 @@ SymType* Parser::ParseArrayType()
 SymType* Parser::ParseRecordType()
 {
     CheckTokOrDie(TOK_RECORD);
-    sym_table_stack.push_back(new SymTable);
+    PushScope(new SymTable);
     ParseVarDeclarations(false);
     SymType* res = new SymTypeRecord(sym_table_stack.back());
-    sym_table_stack.pop_back();
+    PopScope();
     CheckTokOrDie(TOK_END);
     return res;
 }
@@ -189,7 +283,7 @@ void Parser::ParseConstDeclarations()
         if (FindSymbol(name) != NULL) Error("duplicate declaration");
         CheckNextTokOrDie(TOK_EQUAL);
         SymVarConst* sym = ParseConstExprOrDie(name);// ParseConstant(name);
-        sym_table_stack.back()->Add(sym);
+        AddSymbol(sym);
         CheckTokOrDie(TOK_SEMICOLON);
     }
 }
@@ -225,10 +319,10 @@ void Parser::ParseVarDeclarationFactory(SymbolClass var_class_name)
                 //TODO
             break;
             case SYM_VAR_GLOBAL:
-                sym_table_stack.back()->Add(new SymVarGlobal(*it, type));
+                AddSymbol(new SymVarGlobal(*it, type));
             break;
             case SYM_VAR_LOCAL:
-                sym_table_stack.back()->Add(new SymVarLocal(*it, type, sym_table_stack.back()->GetLocalsSize()));
+                AddSymbol(new SymVarLocal(*it, type, sym_table_stack.back()->GetLocalsSize()));
             break;
         }
     }
@@ -242,7 +336,7 @@ void Parser::ParseTypeDeclarations()
         if (FindSymbol(name) != NULL) Error("duplicate declaration");
         CheckNextTokOrDie(TOK_EQUAL);
         SymType* type = ParseType();
-        sym_table_stack.back()->Add(new SymTypeAlias(name, type));
+        AddSymbol(new SymTypeAlias(name, type));
         CheckTokOrDie(TOK_SEMICOLON);
     }
 }
@@ -298,8 +392,8 @@ void Parser::ParseFunctionParameters(SymProc* funct)
         const SymType* type = (SymType*)FindSymbolOrDie(scan.GetToken(), SYM_TYPE, "type identifier expected");
         for (vector<Token>::iterator it = v.begin(); it != v.end(); ++it)
         {
-            SymVarParam* param = new SymVarParam(*it, type, by_ref, sym_table_stack.back()->GetParamsSize() + 8);
-            sym_table_stack.back()->Add(param);
+            SymVarParam* param = new SymVarParam(*it, type, by_ref, sym_table_stack.back()->GetParamsSize() + asm_code.GetParamsOffset());
+            AddSymbol(param);
             funct->AddParam(param);
         }
         if (was_semicolon = (scan.NextToken().GetValue() == TOK_SEMICOLON)) scan.NextToken();
@@ -331,8 +425,8 @@ void Parser::ParseFunctionDefinition()
             Error("duplicate identifier");
     }
     res = (op == TOK_PROCEDURE) ? new SymProc(name) : new SymFunct(name);
-    if (prototype == NULL) sym_table_stack.back()->Add(res);
-    sym_table_stack.push_back(new SymTable);
+    if (prototype == NULL) AddSymbol(res);
+    PushScope(new SymTable);
     res->AddSymTable(sym_table_stack.back());
     scan.NextToken();
     if (scan.GetToken().GetValue() == TOK_BRACKETS_LEFT) ParseFunctionParameters(res);
@@ -341,7 +435,8 @@ void Parser::ParseFunctionDefinition()
         CheckTokOrDie(TOK_COLON);
         const SymType* type = (SymType*)FindSymbolOrDie(scan.GetToken(), SYM_TYPE, "type identifier expected");
         scan.NextToken();
-        ((SymFunct*)res)->AddResultType(type);
+        ((SymFunct*)res)->AddResultType(type, asm_code.GetParamsOffset());
+        SyncScope();
     }
     CheckTokOrDie(TOK_SEMICOLON);
     if (prototype != NULL)
@@ -349,8 +444,8 @@ void Parser::ParseFunctionDefinition()
         if (!prototype->ValidateParams(res)) Error("function prototype differs from preveous declaration", name);
         delete res;
         res = prototype;
-        sym_table_stack.pop_back();
-        sym_table_stack.push_back(res->GetSymTable());
+        PopScope();
+        PushScope(res->GetSymTable());
     }
     if (scan.GetToken().GetValue() == TOK_FORWARD)
     {
@@ -364,7 +459,7 @@ void Parser::ParseFunctionDefinition()
         ParseFunctionBody(res);
         CheckTokOrDie(TOK_SEMICOLON);
     }
-    sym_table_stack.pop_back();
+    PopScope();
 }
 
 NodeStatement* Parser::ParseStatement()
@@ -502,13 +597,13 @@ NodeStatement* Parser::ParseIfStatement()
 
 NodeStatement* Parser::ParseAssignStatement()
 {
-    SyntaxNode* left = ParseRelationalExpr();
+    SyntaxNode* left = ParseExpr();
     if (left == NULL) return NULL;
     if (scan.GetToken().GetValue() != TOK_ASSIGN)
         return new StmtExpression(left);
     Token op = scan.GetToken();
     scan.NextToken();
-    SyntaxNode* right = ParseRelationalExpr();
+    SyntaxNode* right = ParseExpr();
     if (right == NULL) Error("expression expected");
     ConvertTypeOrDie(right, left->GetSymType(), op);
     if (!(left->IsLValue())) Error("l-value expected", op);
@@ -537,35 +632,101 @@ NodeStatement* Parser::ParseExitStatement()
     return new StmtExit(label);
 }
 
-const Symbol* Parser::FindSymbol(Symbol* sym)
+void Parser::PushScope(SymTable* table)
+{
+    sym_table_stack.push_back(table);
+    scope_starts.push_back(scope_bindings.size());
+    SyncScope();
+}
+
+void Parser::PopScope()
 {
-    const Symbol* res = NULL;
-    for (std::vector<SymTable*>::reverse_iterator it = sym_table_stack.rbegin();
-         it != sym_table_stack.rend() && res == NULL; ++it)
+    for (unsigned i = scope_bindings.size(); i > scope_starts.back(); --i)
     {
-        res = (*it)->Find(sym);
+        ScopeBinding& binding = scope_bindings[i - 1];
+        visible_symbols[binding.id] = binding.shadowed;
     }
-    return res;
+    scope_bindings.resize(scope_starts.back());
+    scope_starts.pop_back();
+    sym_table_stack.pop_back();
+}
+
+void Parser::SyncScope()
+{
+    const std::vector<Symbol*>& symbols = sym_table_stack.back()->GetSymbols();
+    for (unsigned i = scope_bindings.size() - scope_starts.back(); i < symbols.size(); ++i)
+    {
+        unsigned id = symbols[i]->GetId();
+        if (id >= visible_symbols.size()) visible_symbols.resize(id + 1, NULL);
+        ScopeBinding binding = {id, visible_symbols[id]};
+        scope_bindings.push_back(binding);
+        visible_symbols[id] = symbols[i];
+    }
+}
+
+void Parser::AddSymbol(Symbol* sym)
+{
+    sym_table_stack.back()->Add(sym);
+    SyncScope();
+}
+
+const Symbol* Parser::FindSymbol(unsigned id)
+{
+    return id < visible_symbols.size() ? visible_symbols[id] : NULL;
+}
+
+const Symbol* Parser::FindSymbol(Symbol* sym)
+{
+    return FindSymbol(sym->GetId());
 }
 
 const Symbol* Parser::FindSymbolOrDie(Symbol* sym, SymbolClass type, string msg)
 {
-    const Symbol* res = FindSymbol(sym);
+    return FindSymbolOrDie(sym->GetToken(), type, msg);
+}
+
+const Symbol* Parser::FindSymbolOrDie(Token tok, SymbolClass type, string msg)
+{
+    const Symbol* res = FindSymbol(tok.GetId());
     if (res == NULL) Error("identifier not found");
     if (!(res->GetClassName() & type)) Error(msg);
     return res;
 }
 
-const Symbol* Parser::FindSymbolOrDie(Token tok, SymbolClass type, string msg)
+const Symbol* Parser::FindSymbol(const Token& tok)
 {
-    Symbol sym(tok);
-    return FindSymbolOrDie(&sym, type, msg);
+    return FindSymbol(tok.GetId());
 }
 
-const Symbol* Parser::FindSymbol(const Token& tok)
+void Parser::InlineCalls()
 {
-    Symbol sym(tok);
-    return FindSymbol(&sym);
+    if (!inline_threshold) return;
+    CallGraph graph(sym_table_stack.back());
+    std::vector<Symbol*> symbols = sym_table_stack.back()->GetSymbols();
+    for (std::vector<Symbol*>::iterator it = symbols.begin(); it != symbols.end(); ++it)
+        if (((*it)->GetClassName() & SYM_PROC) && ((SymProc*)*it)->IsHaveBody())
+        {
+            SymProc* proc = (SymProc*)*it;
+            Inliner inliner(proc->GetSymTable(), proc, graph, false, inline_threshold);
+            proc->AddBody(proc->GetBody()->Inline(inliner));
+        }
+    Inliner inliner(sym_table_stack.back(), NULL, graph, true, inline_threshold);
+    body->Inline(inliner);
+    CallGraph(sym_table_stack.back()).ComputeSummaries();
+}
+
+void Parser::HoistInvariants()
+{
+    std::vector<Symbol*> symbols = sym_table_stack.back()->GetSymbols();
+    for (std::vector<Symbol*>::iterator it = symbols.begin(); it != symbols.end(); ++it)
+        if (((*it)->GetClassName() & SYM_PROC) && ((SymProc*)*it)->IsHaveBody())
+        {
+            SymProc* proc = (SymProc*)*it;
+            Hoister hoister(proc->GetSymTable(), sym_table_stack.back());
+            proc->AddBody(proc->GetBody()->HoistInvariants(hoister));
+        }
+    Hoister hoister(sym_table_stack.back(), sym_table_stack.back());
+    body->HoistInvariants(hoister);
 }
 
 void Parser::Parse()
@@ -574,10 +735,13 @@ void Parser::Parse()
     if (scan.GetToken().GetValue() != TOK_BEGIN) Error("'begin' expected");
     body = (StmtBlock*)ParseStatement();
     if (scan.GetToken().GetValue() != TOK_DOT) Error("'.' expected");
+    CallGraph(sym_table_stack.back()).ComputeSummaries();
     if (optimization)
     {
+        InlineCalls();
         sym_table_stack.back()->Optimize();
         body->Optimize();
+        HoistInvariants();
     }
 }
 
@@ -601,7 +765,7 @@ void Parser::CheckNextTokOrDie(TokenValue tok_val)
 SyntaxNode* Parser::GetIntExprOrDie()
 {
     Token err_tok = scan.GetToken();
-    SyntaxNode* res = ParseRelationalExpr();
+    SyntaxNode* res = ParseExpr();
     if (res == NULL) Error("expression expected");
     if (res->GetSymType() != top_type_int) Error("integer expression expected", err_tok);
     return res;
@@ -644,7 +808,7 @@ SyntaxNode* Parser::ParseFunctionCall(SymProc* funct_name)
         while (scan.GetToken().GetValue() != TOK_BRACKETS_RIGHT)
         {
             Token err_pos_tok = scan.GetToken();
-            SyntaxNode* arg = ParseRelationalExpr();
+            SyntaxNode* arg = ParseExpr();
             if (arg == NULL) Error("illegal expression");
             if (scan.GetToken().GetValue() == TOK_COMMA)
                 scan.NextToken();
@@ -673,7 +837,7 @@ SyntaxNode* Parser::ParseWriteFunctCall()
         while (scan.GetToken().GetValue() != TOK_BRACKETS_RIGHT)
         {
             Token err_tok = scan.GetToken();
-            SyntaxNode* arg = ParseRelationalExpr();
+            SyntaxNode* arg = ParseExpr();
             if (arg == NULL) Error("illegal expression");
             if (scan.GetToken().GetValue() == TOK_COMMA)
                 scan.NextToken();
@@ -691,7 +855,7 @@ SyntaxNode* Parser::ParseWriteFunctCall()
 
 SymVarConst* Parser::ParseConstExprOrDie(Token const_name)
 {
-    SyntaxNode* expr = ParseRelationalExpr();
+    SyntaxNode* expr = ParseExpr();
     if (!expr->IsConst()) Error("constant expression expected");
     Token val = expr->ComputeConstExpr();
     SymVarConst* res = new SymVarConst(const_name, val, expr->GetSymType());
@@ -754,7 +918,7 @@ SyntaxNode* Parser::ParseFactor()
     else if (tok_val == TOK_BRACKETS_LEFT)
     {
         scan.NextToken();
-        left = ParseRelationalExpr();
+        left = ParseExpr();
         if (left == NULL) Error("illegal expression");
         CheckTokOrDie(TOK_BRACKETS_RIGHT);
     }
@@ -786,6 +950,7 @@ SyntaxNode* Parser::ParseFactor()
 
 SyntaxNode* Parser::ParseUnaryExpr()
 {
+    if (!scan.GetToken().IsUnaryOp()) return ParseFactor();
     std::vector<Token> un;
     while (scan.GetToken().IsUnaryOp())
     {
@@ -806,16 +971,18 @@ SyntaxNode* Parser::ParseUnaryExpr()
     return res;
 }
 
-SyntaxNode* Parser::ParseMultiplyingExpr()
+SyntaxNode* Parser::ParseExpr(int min_priority)
 {
     SyntaxNode* left = ParseUnaryExpr();
     if (left == NULL) return NULL;
     Token op = scan.GetToken();
-    while (op.IsMultOp())
+    int priority = OPERATION_PRIORITY.Get(op.GetValue());
+    while (priority >= min_priority)
     {
+        bool short_circuit = scan.IsShortCircuit();
         scan.NextToken();
-        SyntaxNode* right = ParseUnaryExpr();
-        if (right == NULL) Error("illegal expression");
+        SyntaxNode* right = ParseExpr(priority + 1);
+        if (right == NULL) Error(priority == PRIOR_MULTIPLYING ? "illegal expression" : "expression expected");
         if (op.GetValue() == TOK_DIVISION)
         {
             ConvertTypeOrDie(left, top_type_real, op);
@@ -828,48 +995,9 @@ SyntaxNode* Parser::ParseMultiplyingExpr()
         }
         else
             ConvertToBaseTypeOrDie(left, right, op);
-        left = new NodeBinaryOp(op, left, right);
-        op = scan.GetToken();
-    }
-    return left;
-}
-
-SyntaxNode* Parser::ParseAddingExpr()
-{
-    SyntaxNode* left = ParseMultiplyingExpr();
-    if (left == NULL) return NULL;
-    Token op = scan.GetToken();
-    while (op.IsAddingOp())
-    {
-        scan.NextToken();
-        SyntaxNode* right = ParseMultiplyingExpr();
-        if (right == NULL) Error("expression expected");
-        if (op.IsBitwiseOp())
-        {
-            ConvertTypeOrDie(left, top_type_int, op);
-            ConvertTypeOrDie(right, top_type_int, op);
-        }
-        else
-            ConvertToBaseTypeOrDie(left, right, op);
-        left = new NodeBinaryOp(op, left, right);
-        op = scan.GetToken();
-    }
-    return left;
-}
-
-SyntaxNode* Parser::ParseRelationalExpr()
-{
-    SyntaxNode* left = ParseAddingExpr();
-    if (left == NULL) return NULL;
-    Token op = scan.GetToken();
-    while (op.IsRelationalOp())
-    {
-        scan.NextToken();
-        SyntaxNode* right = ParseAddingExpr();
-        if (right == NULL) Error("expression expected");
-        ConvertToBaseTypeOrDie(left, right, op);
-        left = new NodeBinaryOp(op, left, right);
+        left = new NodeBinaryOp(op, left, right, short_circuit);
         op = scan.GetToken();
+        priority = OPERATION_PRIORITY.Get(op.GetValue());
     }
     return left;
 }
@@ -7,6 +7,7 @@
 #include "syntax_node.h"
 #include "statement.h"
 #include "generator.h"
+#include "inliner.h"
 #include "exception.h"
 #include <string.h>
 #include <vector>
@@ -16,12 +17,22 @@
 
 class Parser{
 private:
+    struct ScopeBinding{
+        unsigned id;
+        const Symbol* shadowed;
+    };
+    Arena arena;
     bool optimization;
+    unsigned inline_threshold;
     StmtBlock* body;
-    Scanner& scan;
+    TokenStream scan;
     SymTable top_sym_table;
+    SymTable global_sym_table;
     SymType* top_type_bool;
     std::vector<SymTable*> sym_table_stack;
+    std::vector<const Symbol*> visible_symbols;
+    std::vector<ScopeBinding> scope_bindings;
+    std::vector<unsigned> scope_starts;
     std::vector<StmtLoop*> loop_stack;
     SymProc* current_proc;
     AsmStrImmediate exit_label;
@@ -45,10 +56,8 @@ private:
     SyntaxNode* ParseRecordAccess(SyntaxNode* record);
     SyntaxNode* ParseArrayAccess(SyntaxNode* array);
     SyntaxNode* ParseFactor();
-    SyntaxNode* ParseAddingExpr();
-    SyntaxNode* ParseMultiplyingExpr();
     SyntaxNode* ParseUnaryExpr();
-    SyntaxNode* ParseRelationalExpr();
+    SyntaxNode* ParseExpr(int min_priority = 1);
     void Error(string msg, Token err_pos_tok);
     void Error(string msg);
     SymType* ParseArrayType();
@@ -74,16 +83,29 @@ private:
     NodeStatement* ParseAssignStatement();
     NodeStatement* ParseJumpStatement();
     NodeStatement* ParseExitStatement();
+    void PushScope(SymTable* table);
+    void PopScope();
+    void SyncScope();
+    void AddSymbol(Symbol* sym);
+    const Symbol* FindSymbol(unsigned id);
     const Symbol* FindSymbol(Symbol* sym);
     const Symbol* FindSymbolOrDie(Symbol* sym, SymbolClass type, string msg);
     const Symbol* FindSymbolOrDie(Token tok, SymbolClass type, string msg);
     const Symbol* FindSymbol(const Token& tok);
+    void InlineCalls();
+    void HoistInvariants();
     void Parse();
+    void BuildCode(Peephole& peephole);
 public:
-    Parser(Scanner& scanner, bool optimize = false);
+    Parser(Scanner& scanner, bool optimize = false, bool x64 = false, unsigned inline_threshold_ = INLINE_THRESHOLD);
     void PrintSyntaxTree(ostream& o);
     void PrintSymTable(ostream& o);
+    void PrintIR(ostream& o);
+    void EnableSSE();
     void Generate(ostream& o);
+    void GenerateObject(ostream& o);
+    int Run();
+    void Interpret();
 };
 
 #endif
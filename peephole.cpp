@@ -0,0 +1,146 @@
+#include "peephole.h"
+
+const string PEEPHOLE_PATTERN_TO_STR[] =
+{
+    "push/pop to mov",
+    "push/pop same register",
+    "mov to self",
+    "add/sub zero",
+    "jump to next label"
+};
+
+static bool IsCmd(AsmCmd* cmd, AsmCmdName name)
+{
+    AsmCmdClass cmd_class = cmd->GetClassName();
+    return (cmd_class == CMD_0 || cmd_class == CMD_1 || cmd_class == CMD_2) && ((AsmCmd0*)cmd)->GetCommand() == name;
+}
+
+static bool IsJump(AsmCmd* cmd)
+{
+    if (cmd->GetClassName() != CMD_1) return false;
+    switch (((AsmCmd1*)cmd)->GetCommand())
+    {
+        case ASM_JA:
+        case ASM_JAE:
+        case ASM_JB:
+        case ASM_JBE:
+        case ASM_JG:
+        case ASM_JL:
+        case ASM_JMP:
+        case ASM_JNE:
+        case ASM_JNG:
+        case ASM_JNL:
+        case ASM_JNZ:
+        case ASM_JZ:
+            return ((AsmCmd1*)cmd)->GetOperand()->GetClassName() == OPERAND_STR;
+        default:
+            return false;
+    }
+}
+
+static bool UsesStack(AsmOperand* oper)
+{
+    return oper->ToString().find(REG_TO_STR[REG_ESP]) != string::npos;
+}
+
+static bool IsFrameRegister(AsmOperand* oper)
+{
+    if (oper->GetClassName() != OPERAND_REGISTER) return false;
+    RegisterName reg = ((AsmRegister*)oper)->GetRegister();
+    return reg == REG_ESP || reg == REG_EBP;
+}
+
+//---Peephole---
+
+Peephole::Peephole(unsigned patterns_):
+    patterns(patterns_)
+{
+    for (unsigned i = 0; i < PEEP_COUNT; ++i)
+        removed[i] = 0;
+}
+
+bool Peephole::IsEnabled(PeepholePattern pattern) const
+{
+    return patterns & (1 << pattern);
+}
+
+bool Peephole::RewritePushPop(list<AsmCmd*>& commands, list<AsmCmd*>::iterator& it)
+{
+    list<AsmCmd*>::iterator next = it;
+    ++next;
+    if (next == commands.end() || !IsCmd(*it, ASM_PUSH) || !IsCmd(*next, ASM_POP)) return false;
+    AsmCmd1* push = (AsmCmd1*)*it;
+    AsmCmd1* pop = (AsmCmd1*)*next;
+    if (push->GetSize() != SIZE_LONG || pop->GetSize() != SIZE_LONG) return false;
+    AsmOperand* src = push->GetOperand();
+    AsmOperand* dest = pop->GetOperand();
+    if (UsesStack(src) || UsesStack(dest)) return false;
+    if (dest->GetClassName() == OPERAND_REGISTER && src->ToString() == dest->ToString())
+    {
+        if (!IsEnabled(PEEP_PUSH_POP_SAME)) return false;
+        it = commands.erase(it, ++next);
+        removed[PEEP_PUSH_POP_SAME] += 2;
+        return true;
+    }
+    if (!IsEnabled(PEEP_PUSH_POP)) return false;
+    if (src->GetClassName() == OPERAND_MEMORY && dest->GetClassName() == OPERAND_MEMORY) return false;
+    *it = new AsmCmd2(ASM_MOV, src, dest);
+    commands.erase(next);
+    ++removed[PEEP_PUSH_POP];
+    return true;
+}
+
+bool Peephole::RewriteSingle(list<AsmCmd*>& commands, list<AsmCmd*>::iterator& it)
+{
+    PeepholePattern pattern = PEEP_COUNT;
+    if (IsCmd(*it, ASM_MOV) && (*it)->GetClassName() == CMD_2)
+    {
+        AsmOperand* src = ((AsmCmd2*)*it)->GetSrc();
+        AsmOperand* dest = ((AsmCmd2*)*it)->GetDest();
+        if (src->GetClassName() == OPERAND_REGISTER && src->ToString() == dest->ToString()) pattern = PEEP_MOV_SELF;
+    }
+    else if ((IsCmd(*it, ASM_ADD) || IsCmd(*it, ASM_SUB)) && (*it)->GetClassName() == CMD_2)
+    {
+        AsmOperand* src = ((AsmCmd2*)*it)->GetSrc();
+        AsmOperand* dest = ((AsmCmd2*)*it)->GetDest();
+        if (src->GetClassName() == OPERAND_INT && !((AsmIntImmediate*)src)->GetIntValue() && IsFrameRegister(dest))
+            pattern = PEEP_ADD_ZERO;
+    }
+    else if (IsJump(*it))
+    {
+        string target = ((AsmStrImmediate*)((AsmCmd1*)*it)->GetOperand())->GetStrValue();
+        list<AsmCmd*>::iterator next = it;
+        for (++next; next != commands.end() && (*next)->GetClassName() == CMD_LABEL; ++next)
+            if (((AsmLabel*)*next)->GetName() == target) pattern = PEEP_JUMP_NEXT;
+    }
+    if (pattern == PEEP_COUNT || !IsEnabled(pattern)) return false;
+    it = commands.erase(it);
+    ++removed[pattern];
+    return true;
+}
+
+void Peephole::Run(list<AsmCmd*>& commands)
+{
+    list<AsmCmd*>::iterator it = commands.begin();
+    while (it != commands.end())
+    {
+        if (!RewritePushPop(commands, it) && !RewriteSingle(commands, it))
+        {
+            ++it;
+            continue;
+        }
+        if (it != commands.begin()) --it;
+    }
+}
+
+unsigned Peephole::GetRemoved(PeepholePattern pattern) const
+{
+    return removed[pattern];
+}
+
+void Peephole::PrintStats(ostream& o) const
+{
+    for (unsigned i = 0; i < PEEP_COUNT; ++i)
+        if (IsEnabled((PeepholePattern)i))
+            o << "# peephole: " << PEEPHOLE_PATTERN_TO_STR[i] << ": " << removed[i] << " removed\n";
+}
@@ -0,0 +1,35 @@
+#ifndef PEEPHOLE
+#define PEEPHOLE
+
+#include "generator.h"
+#include <list>
+#include <ostream>
+
+enum PeepholePattern{
+    PEEP_PUSH_POP,
+    PEEP_PUSH_POP_SAME,
+    PEEP_MOV_SELF,
+    PEEP_ADD_ZERO,
+    PEEP_JUMP_NEXT,
+    PEEP_COUNT
+};
+
+extern const string PEEPHOLE_PATTERN_TO_STR[];
+
+const unsigned PEEP_ALL = (1 << PEEP_COUNT) - 1;
+
+class Peephole{
+private:
+    unsigned patterns;
+    unsigned removed[PEEP_COUNT];
+    bool IsEnabled(PeepholePattern pattern) const;
+    bool RewritePushPop(list<AsmCmd*>& commands, list<AsmCmd*>::iterator& it);
+    bool RewriteSingle(list<AsmCmd*>& commands, list<AsmCmd*>::iterator& it);
+public:
+    Peephole(unsigned patterns_ = PEEP_ALL);
+    void Run(list<AsmCmd*>& commands);
+    unsigned GetRemoved(PeepholePattern pattern) const;
+    void PrintStats(ostream& o) const;
+};
+
+#endif
@@ -0,0 +1,217 @@
+#include "regalloc.h"
+#include <algorithm>
+
+static const RegisterName ALLOC_REGS[] = { REG_ECX, REG_EBX, REG_ESI, REG_EDI, REG_R12D, REG_R13D, REG_R14D, REG_R15D };
+static const unsigned ALLOC_REGS_COUNT = sizeof(ALLOC_REGS) / sizeof(ALLOC_REGS[0]);
+static const unsigned ALLOC_REGS_COUNT_X86 = 4;
+
+typedef std::vector<unsigned> TempSet;
+
+static void AddTemp(TempSet& set, int temp)
+{
+    set[temp / 32] |= 1u << (temp % 32);
+}
+
+static bool HasTemp(const TempSet& set, int temp)
+{
+    return set[temp / 32] & (1u << (temp % 32));
+}
+
+//---LinearScan---
+
+LinearScan::LinearScan(IRFunction& func_, bool x64_):
+    func(func_),
+    x64(x64_),
+    clobbers(REG_R15 + 1),
+    free_regs(REG_R15 + 1, true)
+{
+}
+
+void LinearScan::Extend(int temp, int pos)
+{
+    if (starts[temp] < 0 || pos < starts[temp]) starts[temp] = pos;
+    if (pos > ends[temp]) ends[temp] = pos;
+}
+
+void LinearScan::AddClobbers(const IRInstr& instr, int pos)
+{
+    switch (instr.op)
+    {
+        case IR_STACK_VALUE:
+        case IR_STACK_ARG:
+        case IR_STACK_STMT:
+            clobbers[REG_EBX].push_back(pos);
+            clobbers[REG_ECX].push_back(pos);
+            if (!x64) break;
+            clobbers[REG_ESI].push_back(pos);
+            clobbers[REG_EDI].push_back(pos);
+        break;
+        case IR_CALL:
+        case IR_WRITE:
+        case IR_WRITE_STR:
+        case IR_WRITE_LN:
+            clobbers[REG_ECX].push_back(pos);
+            if (!x64) break;
+            clobbers[REG_ESI].push_back(pos);
+            clobbers[REG_EDI].push_back(pos);
+        break;
+        default:
+        break;
+    }
+}
+
+void LinearScan::ComputeIntervals()
+{
+    const std::vector<IRBlock*>& blocks = func.GetBlocks();
+    unsigned temps_count = func.GetTempsCount();
+    unsigned words = (temps_count + 31) / 32;
+    std::vector<TempSet> gen(blocks.size(), TempSet(words, 0));
+    std::vector<TempSet> kill(blocks.size(), TempSet(words, 0));
+    std::vector<TempSet> live_in(blocks.size(), TempSet(words, 0));
+    std::vector<TempSet> live_out(blocks.size(), TempSet(words, 0));
+    std::vector<int> from(blocks.size());
+    std::vector<int> to(blocks.size());
+    hints.assign(temps_count, IR_NO_TEMP);
+    in_memory.assign(temps_count, false);
+    int pos = 0;
+    for (unsigned i = 0; i < blocks.size(); ++i)
+    {
+        from[i] = pos++;
+        for (std::vector<IRInstr>::const_iterator it = blocks[i]->instrs.begin(); it != blocks[i]->instrs.end(); ++it)
+        {
+            if (it->a != IR_NO_TEMP && !HasTemp(kill[i], it->a)) AddTemp(gen[i], it->a);
+            if (it->b != IR_NO_TEMP && !HasTemp(kill[i], it->b)) AddTemp(gen[i], it->b);
+            if (it->dst != IR_NO_TEMP)
+            {
+                AddTemp(kill[i], it->dst);
+                if (it->a != IR_NO_TEMP) hints[it->dst] = it->a;
+            }
+            if (it->type == IR_REAL && it->op >= IR_ADD && it->op <= IR_NEG)
+            {
+                in_memory[it->a] = true;
+                if (it->b != IR_NO_TEMP) in_memory[it->b] = true;
+            }
+            AddClobbers(*it, pos++);
+        }
+        to[i] = pos - 1;
+    }
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = blocks.size() - 1; i >= 0; --i)
+        {
+            TempSet out(words, 0);
+            for (std::vector<IRBlock*>::const_iterator it = blocks[i]->succ.begin(); it != blocks[i]->succ.end(); ++it)
+                for (unsigned w = 0; w < words; ++w)
+                    out[w] |= live_in[(*it)->index][w];
+            TempSet in(words);
+            for (unsigned w = 0; w < words; ++w)
+                in[w] = gen[i][w] | (out[w] & ~kill[i][w]);
+            if (in == live_in[i] && out == live_out[i]) continue;
+            live_in[i].swap(in);
+            live_out[i].swap(out);
+            changed = true;
+        }
+    }
+    starts.assign(temps_count, -1);
+    ends.assign(temps_count, -1);
+    for (unsigned i = 0; i < blocks.size(); ++i)
+    {
+        for (unsigned w = 0; w < words; ++w)
+            for (unsigned bit = 0; bit < 32; ++bit)
+            {
+                if (live_in[i][w] & (1u << bit)) Extend(w * 32 + bit, from[i]);
+                if (live_out[i][w] & (1u << bit)) Extend(w * 32 + bit, to[i]);
+            }
+        pos = from[i] + 1;
+        for (std::vector<IRInstr>::const_iterator it = blocks[i]->instrs.begin(); it != blocks[i]->instrs.end(); ++it, ++pos)
+        {
+            if (it->a != IR_NO_TEMP) Extend(it->a, pos);
+            if (it->b != IR_NO_TEMP) Extend(it->b, pos);
+            if (it->dst != IR_NO_TEMP) Extend(it->dst, pos);
+        }
+    }
+}
+
+bool LinearScan::IsClobbered(RegisterName reg, const Interval& interval) const
+{
+    const std::vector<int>& positions = clobbers[reg];
+    std::vector<int>::const_iterator it = std::upper_bound(positions.begin(), positions.end(), interval.start);
+    return it != positions.end() && *it < interval.end;
+}
+
+bool LinearScan::CanUse(RegisterName reg, const Interval& interval) const
+{
+    return free_regs[reg] && !IsClobbered(reg, interval);
+}
+
+void LinearScan::Expire(int pos)
+{
+    for (unsigned i = 0; i < active.size(); )
+    {
+        if (active[i].end > pos)
+        {
+            ++i;
+            continue;
+        }
+        free_regs[func.GetRegister(active[i].temp)] = true;
+        active.erase(active.begin() + i);
+    }
+}
+
+void LinearScan::Activate(const Interval& interval, RegisterName reg)
+{
+    func.AssignRegister(interval.temp, reg);
+    free_regs[reg] = false;
+    active.push_back(interval);
+}
+
+void LinearScan::Allocate(const Interval& interval)
+{
+    int hint = hints[interval.temp];
+    if (hint != IR_NO_TEMP && func.GetRegister(hint) != IR_NO_REG && CanUse((RegisterName)func.GetRegister(hint), interval))
+    {
+        Activate(interval, (RegisterName)func.GetRegister(hint));
+        return;
+    }
+    unsigned count = x64 ? ALLOC_REGS_COUNT : ALLOC_REGS_COUNT_X86;
+    for (unsigned i = 0; i < count; ++i)
+        if (CanUse(ALLOC_REGS[i], interval))
+        {
+            Activate(interval, ALLOC_REGS[i]);
+            return;
+        }
+    std::vector<Interval>::iterator victim = active.end();
+    for (std::vector<Interval>::iterator it = active.begin(); it != active.end(); ++it)
+        if (!IsClobbered((RegisterName)func.GetRegister(it->temp), interval) && (victim == active.end() || it->end > victim->end))
+            victim = it;
+    if (victim == active.end() || victim->end <= interval.end)
+    {
+        func.Spill(interval.temp);
+        return;
+    }
+    RegisterName reg = (RegisterName)func.GetRegister(victim->temp);
+    func.Spill(victim->temp);
+    active.erase(victim);
+    Activate(interval, reg);
+}
+
+void LinearScan::Run()
+{
+    ComputeIntervals();
+    std::vector<std::pair<int, int> > order;
+    for (unsigned i = 0; i < starts.size(); ++i)
+    {
+        if (starts[i] < 0) continue;
+        if (func.GetTempType(i) == IR_INT && !in_memory[i]) order.push_back(std::make_pair(starts[i], i));
+        else func.Spill(i);
+    }
+    std::sort(order.begin(), order.end());
+    for (std::vector<std::pair<int, int> >::iterator it = order.begin(); it != order.end(); ++it)
+    {
+        Interval interval = { it->second, starts[it->second], ends[it->second] };
+        Expire(interval.start);
+        Allocate(interval);
+    }
+}
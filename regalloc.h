@@ -0,0 +1,36 @@
+#ifndef REGALLOC
+#define REGALLOC
+
+#include "ir.h"
+#include <vector>
+
+class LinearScan{
+private:
+    struct Interval{
+        int temp;
+        int start;
+        int end;
+    };
+    IRFunction& func;
+    bool x64;
+    std::vector<int> starts;
+    std::vector<int> ends;
+    std::vector<int> hints;
+    std::vector<bool> in_memory;
+    std::vector<std::vector<int> > clobbers;
+    std::vector<bool> free_regs;
+    std::vector<Interval> active;
+    void Extend(int temp, int pos);
+    void AddClobbers(const IRInstr& instr, int pos);
+    void ComputeIntervals();
+    bool IsClobbered(RegisterName reg, const Interval& interval) const;
+    bool CanUse(RegisterName reg, const Interval& interval) const;
+    void Expire(int pos);
+    void Activate(const Interval& interval, RegisterName reg);
+    void Allocate(const Interval& interval);
+public:
+    LinearScan(IRFunction& func_, bool x64_ = false);
+    void Run();
+};
+
+#endif
@@ -1,11 +1,53 @@
 #include "scanner.h"
+#include <fstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 bool ishexnum(char c)
 {
     return isdigit(c) || ('a' <= tolower(c)  && tolower(c) <= 'f');
 }
 
-int hex_str_to_i(char* str)
+const char* find_either(const char* cur, const char* end, char a, char b)
+{
+#ifdef __SSE2__
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    for (; end - cur >= 16; cur += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)cur);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)));
+        if (mask) return cur + __builtin_ctz(mask);
+    }
+#endif
+    while (cur < end && *cur != a && *cur != b) ++cur;
+    return cur;
+}
+
+const char* skip_blanks(const char* cur, const char* end)
+{
+#ifdef __SSE2__
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    for (; end - cur >= 16; cur += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)cur);
+        int mask = ~_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab))) & 0xFFFF;
+        if (mask) return cur + __builtin_ctz(mask);
+    }
+#endif
+    while (cur < end && (*cur == ' ' || *cur == '\t')) ++cur;
+    return cur;
+}
+
+int hex_str_to_i(const char* str)
 {
     int res = 0;
     sscanf(str, "%x", &res);
@@ -174,89 +216,253 @@ const string TOKEN_TO_STR[] =
 
 //---Reserved words--
 
-void ReservedWords::Add(string name, TokenType type, TokenValue value)
-{
-    words.insert(pair<string, pair<TokenType, TokenValue> >(name, pair<TokenType, TokenValue>(type, value)));
-}
-
-ReservedWords::ReservedWords()
-{
-    Add("integer", IDENTIFIER, TOK_INTEGER);
-    Add("real", IDENTIFIER, TOK_REAL);
-    Add("and", OPERATION, TOK_AND);
-    Add("array", RESERVED_WORD, TOK_ARRAY);
-    Add("begin", RESERVED_WORD, TOK_BEGIN);
-    Add("break", RESERVED_WORD, TOK_BREAK);
-    Add("case", RESERVED_WORD, TOK_CASE);
-    Add("continue", RESERVED_WORD, TOK_CONTINUE);
-    Add("const", RESERVED_WORD, TOK_CONST);
-    Add("div", OPERATION, TOK_DIV);
-    Add("do", RESERVED_WORD, TOK_DO);
-    Add("downto", RESERVED_WORD, TOK_DOWNTO);
-    Add("else", RESERVED_WORD, TOK_ELSE);
-    Add("end", RESERVED_WORD, TOK_END);
-    Add("exit", RESERVED_WORD, TOK_EXIT);
-    Add("file", RESERVED_WORD, TOK_FILE);
-    Add("for", RESERVED_WORD, TOK_FOR);
-    Add("forward", RESERVED_WORD, TOK_FORWARD);
-    Add("function", RESERVED_WORD, TOK_FUNCTION);
-    Add("if", RESERVED_WORD, TOK_IF);
-    Add("in", RESERVED_WORD, TOK_IN);
-    Add("mod", OPERATION, TOK_MOD);
-    Add("nil", RESERVED_WORD, TOK_NIL);
-    Add("not", OPERATION, TOK_NOT);
-    Add("of", RESERVED_WORD, TOK_OF);
-    Add("or", OPERATION, TOK_OR);
-    Add("procedure", RESERVED_WORD, TOK_PROCEDURE);
-    Add("record", RESERVED_WORD, TOK_RECORD);
-    Add("repeat", RESERVED_WORD, TOK_REPEAT);
-    Add("set", RESERVED_WORD, TOK_SET);
-    Add("shl", OPERATION, TOK_SHL);
-    Add("shr", OPERATION, TOK_SHR);
-    Add("string", RESERVED_WORD, TOK_STRING);
-    Add("then", RESERVED_WORD, TOK_THEN);
-    Add("to", RESERVED_WORD, TOK_TO);
-    Add("type", RESERVED_WORD, TOK_TYPE);
-    Add("until", RESERVED_WORD, TOK_UNTIL);
-    Add("var", RESERVED_WORD, TOK_VAR);
-    Add("while", RESERVED_WORD, TOK_WHILE);
-    Add("with", RESERVED_WORD, TOK_WITH);
-    Add("xor", OPERATION, TOK_XOR);
-    Add("..", RESERVED_WORD, TOK_DOUBLE_DOT);
-    Add(":=", OPERATION, TOK_ASSIGN);
-    Add("-", OPERATION, TOK_MINUS);
-    Add("+", OPERATION, TOK_PLUS);
-    Add("*", OPERATION, TOK_MULT);
-    Add("/", OPERATION, TOK_DIVISION);
-    Add("[", OPERATION, TOK_BRACKETS_SQUARE_LEFT);
-    Add("]", OPERATION, TOK_BRACKETS_SQUARE_RIGHT);
-    Add(";", DELIMITER, TOK_SEMICOLON);
-    Add(":", DELIMITER, TOK_COLON);
-    Add(",", DELIMITER, TOK_COMMA);
-    Add(".", OPERATION, TOK_DOT);
-    Add("^", OPERATION, TOK_CAP);
-    Add("@", OPERATION, TOK_DOG);
-    Add("(", OPERATION, TOK_BRACKETS_LEFT);
-    Add(")", OPERATION, TOK_BRACKETS_RIGHT);
-    Add(">", OPERATION, TOK_GREATER);
-    Add("<", OPERATION, TOK_LESS);
-    Add("=", OPERATION, TOK_EQUAL);
-    Add(">=", OPERATION, TOK_GREATER_OR_EQUAL);
-    Add("<=", OPERATION, TOK_LESS_OR_EQUAL);
-    Add("<>", OPERATION, TOK_NOT_EQUAL);
-    Add("write", IDENTIFIER, TOK_WRITE);
-    Add("writeln", IDENTIFIER, TOK_WRITELN);    
-}
-
-bool ReservedWords::Identify(string& str, TokenType& returned_type, TokenValue& returned_value)
-{
-    map<string, pair<TokenType, TokenValue> >::iterator i  = words.find(str);
-    if (i == words.end()) return false;
-    returned_type = i->second.first;
-    returned_value = i->second.second;
+// Perfect hash over the fixed set of reserved words: length plus associated
+// values of the first, second and last letters, taken modulo WORD_HASH_SIZE.
+// The associated values were chosen so that no two words share a slot.
+
+const int WORD_HASH_SIZE = 64;
+const int MIN_WORD_LENGTH = 2;
+const int MAX_WORD_LENGTH = 9;
+
+static const unsigned char WORD_HASH_ASSO[26] =
+{
+    4, 59, 62, 17, 3, 13, 4, 5, 27, 0, 20, 25, 49,
+    30, 2, 24, 0, 2, 31, 7, 30, 53, 57, 54, 26, 0
+};
+
+static const ReservedWord WORD_HASH_TABLE[WORD_HASH_SIZE] =
+{
+    {"shl", 3, OPERATION, TOK_SHL},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"integer", 7, IDENTIFIER, TOK_INTEGER},
+    {"write", 5, IDENTIFIER, TOK_WRITE},
+    {"exit", 4, RESERVED_WORD, TOK_EXIT},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"while", 5, RESERVED_WORD, TOK_WHILE},
+    {"mod", 3, OPERATION, TOK_MOD},
+    {"or", 2, OPERATION, TOK_OR},
+    {"case", 4, RESERVED_WORD, TOK_CASE},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"continue", 8, RESERVED_WORD, TOK_CONTINUE},
+    {"const", 5, RESERVED_WORD, TOK_CONST},
+    {"to", 2, RESERVED_WORD, TOK_TO},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"function", 8, RESERVED_WORD, TOK_FUNCTION},
+    {"repeat", 6, RESERVED_WORD, TOK_REPEAT},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"for", 3, RESERVED_WORD, TOK_FOR},
+    {"nil", 3, RESERVED_WORD, TOK_NIL},
+    {"break", 5, RESERVED_WORD, TOK_BREAK},
+    {"do", 2, RESERVED_WORD, TOK_DO},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"in", 2, RESERVED_WORD, TOK_IN},
+    {"until", 5, RESERVED_WORD, TOK_UNTIL},
+    {"downto", 6, RESERVED_WORD, TOK_DOWNTO},
+    {"record", 6, RESERVED_WORD, TOK_RECORD},
+    {"with", 4, RESERVED_WORD, TOK_WITH},
+    {"of", 2, RESERVED_WORD, TOK_OF},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"writeln", 7, IDENTIFIER, TOK_WRITELN},
+    {"begin", 5, RESERVED_WORD, TOK_BEGIN},
+    {"real", 4, IDENTIFIER, TOK_REAL},
+    {"else", 4, RESERVED_WORD, TOK_ELSE},
+    {"div", 3, OPERATION, TOK_DIV},
+    {"array", 5, RESERVED_WORD, TOK_ARRAY},
+    {"procedure", 9, RESERVED_WORD, TOK_PROCEDURE},
+    {"forward", 7, RESERVED_WORD, TOK_FORWARD},
+    {"type", 4, RESERVED_WORD, TOK_TYPE},
+    {"shr", 3, OPERATION, TOK_SHR},
+    {"not", 3, OPERATION, TOK_NOT},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"set", 3, RESERVED_WORD, TOK_SET},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"then", 4, RESERVED_WORD, TOK_THEN},
+    {"file", 4, RESERVED_WORD, TOK_FILE},
+    {"string", 6, RESERVED_WORD, TOK_STRING},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"end", 3, RESERVED_WORD, TOK_END},
+    {"and", 3, OPERATION, TOK_AND},
+    {"if", 2, RESERVED_WORD, TOK_IF},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"", 0, UNDEFINED, TOK_UNRESERVED},
+    {"xor", 3, OPERATION, TOK_XOR},
+    {"var", 3, RESERVED_WORD, TOK_VAR},
+    {"", 0, UNDEFINED, TOK_UNRESERVED}
+};
+
+unsigned ReservedWords::Hash(const char* str, int length)
+{
+    unsigned res = length;
+    char c = tolower(str[0]);
+    if ('a' <= c && c <= 'z') res += WORD_HASH_ASSO[c - 'a'];
+    c = tolower(str[1]);
+    if ('a' <= c && c <= 'z') res += WORD_HASH_ASSO[c - 'a'];
+    c = tolower(str[length - 1]);
+    if ('a' <= c && c <= 'z') res += WORD_HASH_ASSO[c - 'a'];
+    return res & (WORD_HASH_SIZE - 1);
+}
+
+bool ReservedWords::IdentifyOperation(const char* str, int length, TokenType& returned_type, TokenValue& returned_value)
+{
+    TokenType type = OPERATION;
+    TokenValue value = TOK_UNRESERVED;
+    if (length == 1)
+    {
+        switch (str[0])
+        {
+            case '-': value = TOK_MINUS; break;
+            case '+': value = TOK_PLUS; break;
+            case '*': value = TOK_MULT; break;
+            case '/': value = TOK_DIVISION; break;
+            case '[': value = TOK_BRACKETS_SQUARE_LEFT; break;
+            case ']': value = TOK_BRACKETS_SQUARE_RIGHT; break;
+            case '.': value = TOK_DOT; break;
+            case '^': value = TOK_CAP; break;
+            case '@': value = TOK_DOG; break;
+            case '(': value = TOK_BRACKETS_LEFT; break;
+            case ')': value = TOK_BRACKETS_RIGHT; break;
+            case '>': value = TOK_GREATER; break;
+            case '<': value = TOK_LESS; break;
+            case '=': value = TOK_EQUAL; break;
+            case ';': type = DELIMITER; value = TOK_SEMICOLON; break;
+            case ':': type = DELIMITER; value = TOK_COLON; break;
+            case ',': type = DELIMITER; value = TOK_COMMA; break;
+        }
+    }
+    else if (length == 2)
+    {
+        switch (str[1])
+        {
+            case '.':
+                if (str[0] == '.')
+                {
+                    type = RESERVED_WORD;
+                    value = TOK_DOUBLE_DOT;
+                }
+            break;
+            case '=':
+                if (str[0] == ':') value = TOK_ASSIGN;
+                else if (str[0] == '>') value = TOK_GREATER_OR_EQUAL;
+                else if (str[0] == '<') value = TOK_LESS_OR_EQUAL;
+            break;
+            case '>':
+                if (str[0] == '<') value = TOK_NOT_EQUAL;
+            break;
+        }
+    }
+    if (value == TOK_UNRESERVED) return false;
+    returned_type = type;
+    returned_value = value;
+    return true;
+}
+
+bool ReservedWords::Identify(const char* str, int length, TokenType& returned_type, TokenValue& returned_value)
+{
+    if (length == 0) return false;
+    if (!isalpha(str[0])) return IdentifyOperation(str, length, returned_type, returned_value);
+    if (length < MIN_WORD_LENGTH || MAX_WORD_LENGTH < length) return false;
+    const ReservedWord& word = WORD_HASH_TABLE[Hash(str, length)];
+    if (word.length != length) return false;
+    for (int i = 0; i < length; ++i)
+        if (tolower(str[i]) != word.name[i]) return false;
+    returned_type = word.type;
+    returned_value = word.value;
     return true;
 }
 
+//---NamePool---
+
+const size_t NAME_POOL_BLOCK_SIZE = 65536;
+
+NamePool::NamePool():
+    table(256),
+    block_cur(NULL),
+    block_left(0)
+{
+}
+
+NamePool::~NamePool()
+{
+    for (std::vector<char*>::iterator it = blocks.begin(); it != blocks.end(); ++it)
+        delete[] *it;
+}
+
+NamePool& NamePool::Instance()
+{
+    static NamePool pool;
+    return pool;
+}
+
+unsigned NamePool::Hash(const char* str, unsigned length)
+{
+    unsigned res = 2166136261u;
+    for (unsigned i = 0; i < length; ++i)
+        res = (res ^ (unsigned char)str[i]) * 16777619u;
+    return res;
+}
+
+const char* NamePool::Store(const char* str, unsigned length)
+{
+    if (block_left < length + 1)
+    {
+        size_t size = std::max(NAME_POOL_BLOCK_SIZE, (size_t)length + 1);
+        blocks.push_back(new char[size]);
+        block_cur = blocks.back();
+        block_left = size;
+    }
+    char* res = block_cur;
+    memcpy(res, str, length);
+    res[length] = 0;
+    block_cur += length + 1;
+    block_left -= length + 1;
+    return res;
+}
+
+void NamePool::Grow()
+{
+    std::vector<Entry> old(table.size() * 2);
+    old.swap(table);
+    unsigned mask = table.size() - 1;
+    for (std::vector<Entry>::iterator it = old.begin(); it != old.end(); ++it)
+    {
+        if (it->str == NULL) continue;
+        unsigned i = it->hash & mask;
+        while (table[i].str != NULL) i = (i + 1) & mask;
+        table[i] = *it;
+    }
+}
+
+unsigned NamePool::GetId(const char* str, unsigned length)
+{
+    unsigned hash = Hash(str, length);
+    unsigned mask = table.size() - 1;
+    unsigned i = hash & mask;
+    for (; table[i].str != NULL; i = (i + 1) & mask)
+        if (table[i].hash == hash && table[i].length == length && !memcmp(table[i].str, str, length))
+            return table[i].id;
+    Entry& entry = table[i];
+    entry.str = Store(str, length);
+    entry.length = length;
+    entry.hash = hash;
+    entry.id = names.size();
+    names.push_back(entry.str);
+    if (names.size() * 2 > table.size()) Grow();
+    return names.size() - 1;
+}
+
+const char* NamePool::GetName(unsigned id) const
+{
+    return names[id];
+}
+
 //---Token---
 
 bool Token::IsRelationalOp() const
@@ -313,60 +519,58 @@ bool Token::IsConstVar() const
 ostream& operator<<(ostream& out, const Token & token)
 {
     out << token.GetLine() << ':' << token.GetPos() << '\t'<< TOKEN_DESCRIPTION[token.GetType()]
-        << '\t' << TOKEN_VALUE_DESCRIPTION[token.GetValue()] << '\t' << token.GetName() << endl;
+        << '\t' << TOKEN_VALUE_DESCRIPTION[token.GetValue()] << '\t' << token.GetName() << '\n';
     return out;
 }
 
+void Token::SetName(const char* name_, unsigned length)
+{
+    NamePool& pool = NamePool::Instance();
+    id = pool.GetId(name_, length);
+    name = pool.GetName(id);
+    if (type == STR_CONST) return;
+    unsigned i = 0;
+    while (i < length && name[i] == tolower(name[i])) ++i;
+    if (i == length) return;
+    string low(name, length);
+    for (; i < length; ++i) low[i] = tolower(low[i]);
+    id = pool.GetId(low.data(), length);
+}
+
 Token::Token():
-    name(strcpy(new char[1], "")),
     type(UNDEFINED),
     value(TOK_UNRESERVED),
     line(0),
     pos(0)
 {
+    SetName("", 0);
 }
 
 Token::Token(const char* name_, TokenType type_, TokenValue value_, int line_, int pos_):
-    name(strcpy(new char[strlen(name_)+1], name_)),
     type(type_),
     value(value_),
     line(line_),
     pos(pos_)
 {
+    SetName(name_, strlen(name_));
 }
 
-Token::Token(const Token& token):
-    name(strcpy(new char[strlen(token.name) + 1], token.name)),
-    type(token.type),
-    value(token.value),
-    line(token.line),
-    pos(token.pos)
+Token::Token(const char* name_, unsigned length, TokenType type_, TokenValue value_, int line_, int pos_):
+    type(type_),
+    value(value_),
+    line(line_),
+    pos(pos_)
 {
+    SetName(name_, length);
 }
 
 Token::Token(TokenValue val):
-    name(strcpy(new char[1], "")),
     type(UNDEFINED),
     value(val),
     line(0),
     pos(0)
 {
-}
-
-Token& Token::operator=(const Token& token)
-{
-    if (name != NULL) delete(name);
-    name = strcpy(new char[strlen(token.name)+1], token.name);
-    type = token.type;
-    value = token.value;
-    line = token.line;
-    pos = token.pos;
-    return *this;
-}
-
-Token::~Token()
-{
-    if (name != NULL) delete(name);
+    SetName("", 0);
 }
 
 TokenType Token::GetType() const
@@ -384,6 +588,11 @@ const char* Token::GetName() const
     return name;
 }
 
+unsigned Token::GetId() const
+{
+    return id;
+}
+
 int Token::GetPos() const
 {
     return pos;
@@ -396,8 +605,7 @@ int Token::GetLine() const
 
 void Token::NameToLowerCase()
 {
-    int i = -1;
-    while (name[++i]) name[i] = tolower(name[i]);
+    name = NamePool::Instance().GetName(id);
 }
 
 int Token::GetIntValue() const
@@ -417,32 +625,33 @@ float Token::GetRealValue() const
 
 void Token::ChangeSign()
 {
-    if (name[0] == '+') name[0] = '-';
-    else if (name[0] == '-') name[0] = '+';
-    else
-    {
-        char* tmp = new char[strlen(name) + 2];
-        strcpy(tmp + 1, name);
-        tmp[0] = '-';        
-        delete name;
-        name = tmp;
-    }
+    string res(name);
+    if (name[0] == '+') res[0] = '-';
+    else if (name[0] == '-') res[0] = '+';
+    else res.insert(0, 1, '-');
+    SetName(res.data(), res.size());
 }
 
-Token::Token(int value)
+Token::Token(int value_):
+    type(INT_CONST),
+    value(TOK_UNRESERVED),
+    line(0),
+    pos(0)
 {
-    type = INT_CONST;
     stringstream s;
-    s << value;
-    name = strcpy(new char[s.str().size() + 1], s.str().c_str());
+    s << value_;
+    SetName(s.str().data(), s.str().size());
 }
 
-Token::Token(float value)
+Token::Token(float value_):
+    type(REAL_CONST),
+    value(TOK_UNRESERVED),
+    line(0),
+    pos(0)
 {
-    type = REAL_CONST;
     stringstream s;
-    s << value;
-    name = strcpy(new char[s.str().size() + 1], s.str().c_str());
+    s << value_;
+    SetName(s.str().data(), s.str().size());
 }
 
 //---Scanner---
@@ -450,20 +659,17 @@ Token::Token(float value)
 void Scanner::AddToBuffer(char c)
 {
     buffer.push_back(c);
-    buffer_low.push_back(tolower(c));
 }
 
 void Scanner::ReduceBuffer()
 {
     buffer.resize(buffer.size() - 1);
-    buffer_low.resize(buffer.size());
 }
 
 void Scanner::MakeToken(TokenType type, TokenValue value)
 {
-    token = Token(buffer.c_str(), type, value, first_line, first_pos);
+    token = Token(buffer.data(), buffer.size(), type, value, first_line, first_pos);
     buffer.clear();
-    buffer_low.clear();
     state = NONE_ST;
 }
 
@@ -471,7 +677,7 @@ void Scanner::IdentifyAndMake()
 {
     TokenType t;
     TokenValue v;
-    if (!reserved_words.Identify(buffer_low, t, v))
+    if (!ReservedWords::Identify(buffer.data(), buffer.size(), t, v))
     {
         t = IDENTIFIER;
         v = TOK_UNRESERVED;
@@ -483,7 +689,7 @@ bool Scanner::TryToIdentify()
 {
     TokenType t;
     TokenValue v;
-    if (reserved_words.Identify(buffer_low, t, v))
+    if (ReservedWords::Identify(buffer.data(), buffer.size(), t, v))
     {
         MakeToken(t, v);
         return true;
@@ -498,27 +704,103 @@ void Scanner::Error(const char* msg) const
     throw( CompilerException( s.str().c_str() ) ) ;
 }
 
+void Scanner::InitSource(const char* begin, size_t size)
+{
+    src_cur = begin;
+    src_end = begin + size;
+}
+
+void Scanner::ReadAll(istream& input)
+{
+    char chunk[65536];
+    while (input.read(chunk, sizeof(chunk)) || input.gcount())
+        src_storage.append(chunk, input.gcount());
+    InitSource(src_storage.data(), src_storage.size());
+}
+
 Scanner::Scanner(istream& input):
-    in(input),
+    src_map(NULL),
+    src_map_size(0),
+    eof(false),
+    short_circuit(false),
+    line(1),
+    pos(0),
+    state(NONE_ST),
+    c(0)
+{
+    ReadAll(input);
+}
+
+Scanner::Scanner(const char* file_name):
+    src_map(NULL),
+    src_map_size(0),
+    eof(false),
+    short_circuit(false),
     line(1),
     pos(0),
     state(NONE_ST),
     c(0)
 {
+    if (!strcmp(file_name, "-"))
+    {
+        ReadAll(cin);
+        return;
+    }
+#ifndef _WIN32
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0) throw CompilerException("can't open file");
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            src_map = p;
+            src_map_size = st.st_size;
+            InitSource((const char*)p, src_map_size);
+        }
+    }
+    if (src_map == NULL)
+    {
+        char chunk[65536];
+        ssize_t n;
+        while ((n = read(fd, chunk, sizeof(chunk))) > 0)
+            src_storage.append(chunk, n);
+        InitSource(src_storage.data(), src_storage.size());
+    }
+    close(fd);
+#else
+    ifstream in(file_name, ios::in | ios::binary);
+    if (!in.good()) throw CompilerException("can't open file");
+    ReadAll(in);
+#endif
 }
 
-Token Scanner::GetToken()
+Scanner::~Scanner()
+{
+#ifndef _WIN32
+    if (src_map != NULL) munmap(src_map, src_map_size);
+#endif
+}
+
+const Token& Scanner::GetToken() const
 {
     return token;
 }
 
+bool Scanner::IsShortCircuit() const
+{
+    return short_circuit;
+}
+
 void Scanner::EatLineComment()
 {
-    if (c =='/' && in.peek() == '/')
+    if (c =='/' && PeekChar() == '/')
     {
-        do {
-            ExtractChar();
-        } while (c != '\n' && !in.eof());
+        const char* stop = find_either(src_cur, src_end, '\n', '\n');
+        pos += stop - src_cur;
+        src_cur = stop;
+        ExtractChar();
     }
 }
 
@@ -526,14 +808,19 @@ void Scanner::EatBlockComment()
 {
     if (c == '{')
     {
+        if (src_end - src_cur >= 3 && src_cur[0] == '$' && toupper(src_cur[1]) == 'B' && (src_cur[2] == '-' || src_cur[2] == '+'))
+            short_circuit = src_cur[2] == '-';
         do {
+            const char* stop = find_either(src_cur, src_end, '}', '\n');
+            pos += stop - src_cur;
+            src_cur = stop;
             ExtractChar();
             if (c == '\n')
             {
                 ++line;
                 pos = 0;
             }
-            if (in.eof()) Error("end of file in comment");
+            if (eof) Error("end of file in comment");
         } while (c != '}');
         ExtractChar();
     }
@@ -594,7 +881,6 @@ void Scanner::EatStrConst()
 {
     bool isNum = (buffer[0] =='#');
     buffer.clear();
-    buffer_low.clear();
     if (isNum)
     {
         EatStrNum();
@@ -611,7 +897,7 @@ void Scanner::EatStrConst()
     {
         while (!end_of_str)
         {
-            if (in.eof())
+            if (eof)
                 Error("end of file in string");
             if (c == '\n') Error("end of line in string");
             if (c != '\'')
@@ -622,7 +908,7 @@ void Scanner::EatStrConst()
             while (c == '\'' && !end_of_str)
             {
                 int count;
-                for (count = 0; c == '\'' && !in.eof(); ++count, ExtractChar())
+                for (count = 0; c == '\'' && !eof; ++count, ExtractChar())
                     if (count % 2) AddToBuffer(c);
                 if (count % 2) end_of_str = true;
             }
@@ -664,7 +950,7 @@ void Scanner::EatInteger()
         AddToBuffer(c);
         ExtractChar();
     }
-    if (tolower(c) == 'e' || (c == '.' && in.peek() != '.'))
+    if (tolower(c) == 'e' || (c == '.' && PeekChar() != '.'))
     {
         AddToBuffer(c);
         ExtractChar();
@@ -689,7 +975,7 @@ void Scanner::EatIdentifier()
 void Scanner::EatOperation()
 {
     bool matched = false;
-    if (!in.eof() && !isalnum(c) && c != '_' && !isspace(c))
+    if (!eof && !isalnum(c) && c != '_' && !isspace(c))
     {
         AddToBuffer(c);
         if (TryToIdentify())
@@ -706,13 +992,24 @@ void Scanner::EatOperation()
         Error("illegal expression");
 }
 
+int Scanner::PeekChar() const
+{
+    return (src_cur < src_end) ? *src_cur : EOF;
+}
+
 void Scanner::ExtractChar()
 {
-    c = in.get();
+    if (src_cur < src_end)
+        c = *src_cur++;
+    else
+    {
+        c = EOF;
+        eof = true;
+    }
     ++pos;
 }
 
-Token Scanner::NextToken()
+const Token& Scanner::NextToken()
 {
     bool matched = false;
     do
@@ -758,10 +1055,16 @@ Token Scanner::NextToken()
             {
                 first_pos = pos;
                 first_line = line;
-                if (in.eof())
+                if (eof)
                 {
                     state = EOF_ST;
                 }
+                else if (c == ' ' || c == '\t')
+                {
+                    const char* stop = skip_blanks(src_cur, src_end);
+                    pos += stop - src_cur;
+                    src_cur = stop;
+                }
                 else if (!isspace(c))
                 {
                     if (isalpha(c) || c == '_')
@@ -788,3 +1091,74 @@ Token Scanner::NextToken()
     return token;
 }
 
+
+//---TokenStream---
+
+TokenStream::TokenStream(Scanner& scan):
+    index(-1)
+{
+    try
+    {
+        while (scan.NextToken().GetType() != END_OF_FILE) Push(scan.GetToken(), scan.IsShortCircuit());
+        Push(scan.GetToken(), scan.IsShortCircuit());
+    }
+    catch (CompilerException& e)
+    {
+        error = e.what();
+    }
+}
+
+void TokenStream::Push(const Token& tok, bool short_circuit_)
+{
+    types.push_back(tok.type);
+    values.push_back(tok.value);
+    ids.push_back(tok.id);
+    names.push_back(tok.name);
+    lines.push_back(tok.line);
+    positions.push_back(tok.pos);
+    short_circuit.push_back(short_circuit_);
+}
+
+void TokenStream::Load(unsigned i, Token& tok) const
+{
+    tok.type = (TokenType)types[i];
+    tok.value = (TokenValue)values[i];
+    tok.id = ids[i];
+    tok.name = names[i];
+    tok.line = lines[i];
+    tok.pos = positions[i];
+}
+
+unsigned TokenStream::GetSize() const
+{
+    return types.size();
+}
+
+unsigned TokenStream::GetIndex() const
+{
+    return index;
+}
+
+Token TokenStream::GetToken(unsigned i) const
+{
+    Token res;
+    if (!types.empty()) Load(i < types.size() ? i : types.size() - 1, res);
+    return res;
+}
+
+const Token& TokenStream::GetToken() const
+{
+    return token;
+}
+
+const Token& TokenStream::NextToken()
+{
+    if (index + 1 < (int)types.size()) Load(++index, token);
+    else if (!error.empty()) throw CompilerException(error);
+    return token;
+}
+
+bool TokenStream::IsShortCircuit() const
+{
+    return 0 <= index && index < (int)short_circuit.size() && short_circuit[index];
+}
@@ -6,6 +6,8 @@
 #include <stdlib.h>
 #include <iostream>
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <string.h>
 #include <sstream>
 #include "exception.h"
@@ -100,13 +102,45 @@ class Token;
 
 ostream& operator<<(ostream& out, const Token& token);
 
+struct ReservedWord{
+    const char* name;
+    int length;
+    TokenType type;
+    TokenValue value;
+};
+
 class ReservedWords{
 private:
-    map<string, pair<TokenType, TokenValue> > words;
-    void Add(string name, TokenType type, TokenValue value);
+    static unsigned Hash(const char* str, int length);
+    static bool IdentifyOperation(const char* str, int length, TokenType& returned_type, TokenValue& returned_value);
+public:
+    static bool Identify(const char* str, int length, TokenType& returned_type, TokenValue& returned_value);
+};
+
+class NamePool{
+private:
+    struct Entry{
+        const char* str;
+        unsigned length;
+        unsigned hash;
+        unsigned id;
+    };
+    std::vector<Entry> table;
+    std::vector<const char*> names;
+    std::vector<char*> blocks;
+    char* block_cur;
+    size_t block_left;
+    static unsigned Hash(const char* str, unsigned length);
+    const char* Store(const char* str, unsigned length);
+    void Grow();
+    NamePool(const NamePool&);
+    NamePool& operator=(const NamePool&);
 public:
-    ReservedWords();
-    bool Identify(string& str, TokenType& returned_type, TokenValue& returned_value);
+    NamePool();
+    ~NamePool();
+    unsigned GetId(const char* str, unsigned length);
+    const char* GetName(unsigned id) const;
+    static NamePool& Instance();
 };
 
 class Token{
@@ -115,7 +149,10 @@ protected:
     TokenValue value;
     int line;
     int pos;
-    char* name;
+    const char* name;
+    unsigned id;
+    void SetName(const char* name_, unsigned length);
+    friend class TokenStream;
 public:
     bool IsRelationalOp() const;
     bool IsAddingOp() const;
@@ -128,20 +165,19 @@ public:
     bool IsBitwiseOp() const;
     Token();
     Token(const char* name_, TokenType type_, TokenValue value_, int line_ = -1, int pos_ = -1);
-    Token(const Token& token);
+    Token(const char* name_, unsigned length, TokenType type_, TokenValue value_, int line_, int pos_);
     Token(TokenValue val);
     Token(int value_);
     Token(float value_);
-    Token& operator=(const Token& token);
-    ~Token();
     TokenType GetType() const;
     TokenValue GetValue() const;
     int GetPos() const;
     int GetLine() const;
     void NameToLowerCase();
-    virtual const char* GetName() const;
-    virtual int GetIntValue() const;
-    virtual float GetRealValue() const;
+    const char* GetName() const;
+    unsigned GetId() const;
+    int GetIntValue() const;
+    float GetRealValue() const;
     void ChangeSign();
 };
 
@@ -156,11 +192,15 @@ public:
         NONE_ST
     };
 private:
-    ReservedWords reserved_words;
     Token* currentToken;
-    istream& in;
+    string src_storage;
+    void* src_map;
+    size_t src_map_size;
+    const char* src_cur;
+    const char* src_end;
+    bool eof;
+    bool short_circuit;
     string buffer;
-    string buffer_low;
     int first_pos;
     int first_line;
     Token token;
@@ -174,6 +214,9 @@ private:
     void IdentifyAndMake();
     bool TryToIdentify();
     void Error(const char* msg) const;
+    void InitSource(const char* begin, size_t size);
+    void ReadAll(istream& input);
+    int PeekChar() const;
     void ExtractChar();
     void EatLineComment();
     void EatBlockComment();
@@ -184,10 +227,39 @@ private:
     void EatInteger();
     void EatIdentifier();
     void EatOperation();
+    Scanner(const Scanner&);
+    Scanner& operator=(const Scanner&);
 public:
     Scanner(istream& input);
-    Token GetToken();
-    Token NextToken();
+    Scanner(const char* file_name);
+    ~Scanner();
+    const Token& GetToken() const;
+    const Token& NextToken();
+    bool IsShortCircuit() const;
+};
+
+class TokenStream{
+private:
+    std::vector<unsigned char> types;
+    std::vector<unsigned char> values;
+    std::vector<unsigned> ids;
+    std::vector<const char*> names;
+    std::vector<int> lines;
+    std::vector<int> positions;
+    std::vector<bool> short_circuit;
+    string error;
+    int index;
+    Token token;
+    void Push(const Token& tok, bool short_circuit_);
+    void Load(unsigned i, Token& tok) const;
+public:
+    TokenStream(Scanner& scan);
+    unsigned GetSize() const;
+    unsigned GetIndex() const;
+    Token GetToken(unsigned i) const;
+    const Token& GetToken() const;
+    const Token& NextToken();
+    bool IsShortCircuit() const;
 };
 
 #endif
@@ -1,10 +1,13 @@
 #include "statement.h"
+#include "inliner.h"
+#include "hoister.h"
 
 void StmtAssign::Optimize()
 {
     right->TryToBecomeConst(right);
     left->Optimize();
     right->Optimize();
+    ResetCache();
 }
 
 StmtAssign::StmtAssign(SyntaxNode* left_, SyntaxNode* right_):
@@ -37,35 +40,83 @@ void StmtAssign::Generate(AsmCode& asm_code)
     asm_code.MoveToMemoryFromStack(left->GetSymType()->GetSize());
 }
 
+void StmtAssign::GenerateIR(IRBuilder& ir)
+{
+    if (left->GetSymType()->GetSize() != 4)
+    {
+        NodeStatement::GenerateIR(ir);
+        return;
+    }
+    left->GenerateIRStore(ir, right->GenerateIRValue(ir));
+}
+
+void StmtAssign::GenerateBC(BCBuilder& bc)
+{
+    int value = right->GenerateBCValue(bc);
+    if (!bc.IsTemp(value) && left->IsHaveSideEffect())
+        value = bc.Snapshot(value, left->GetSymType()->GetSize());
+    left->GenerateBCStore(bc, value);
+}
+
 bool StmtAssign::IsHaveSideEffect()
 {
     return (left->IsHaveSideEffect()) || (left->GetAffectedVar()->GetClassName() & SYM_VAR_GLOBAL)
         || right->IsHaveSideEffect();
 }
 
-void StmtAssign::GetAllAffectedVars(VarsContainer& res_cont)
+void StmtAssign::ComputeAffectedVars(VarsContainer& res_cont)
 {
     right->GetAllAffectedVars(res_cont);
     left->GetAllAffectedVars(res_cont);
-    res_cont.insert(left->GetAffectedVar());
+    res_cont.Insert(left->GetAffectedVar());
 }
 
-void StmtAssign::GetAllDependences(VarsContainer& res_cont, bool with_self)
+void StmtAssign::ComputeDependences(VarsContainer& res_cont, bool with_self)
 {
     right->GetAllDependences(res_cont);
     left->GetAllDependences(res_cont, false);
 }
 
+void StmtAssign::GetAllCalls(ProcsContainer& res_cont)
+{
+    right->GetAllCalls(res_cont);
+    left->GetAllCalls(res_cont);
+}
+
 StmtClassName StmtAssign::GetClassName() const
 {
     return STMT_ASSIGN;
 } 
 
-bool StmtAssign::CanBeReplaced()
+bool StmtAssign::ComputeCanBeReplaced()
 {
     return left->CanBeReplaced() && right->CanBeReplaced();
 }
 
+unsigned StmtAssign::GetCost()
+{
+    return left->GetCost() + right->GetCost();
+}
+
+NodeStatement* StmtAssign::Clone(Inliner& inliner) const
+{
+    return new StmtAssign(left->Clone(inliner), right->Clone(inliner));
+}
+
+NodeStatement* StmtAssign::Inline(Inliner& inliner)
+{
+    if (right->InlineCall(inliner, left)) return inliner.Flush(NULL);
+    inliner.InlineNestedCalls(right);
+    return inliner.Flush(this);
+}
+
+void StmtAssign::HoistExpressions(Hoister& hoister)
+{
+    left->HoistExpressions(hoister);
+    hoister.Hoist(right);
+    ResetCache();
+}
+
 //---StmtBlock---
 
 void StmtBlock::Optimize()
@@ -73,6 +124,7 @@ void StmtBlock::Optimize()
     OptimizeLoops();
     for (std::vector<NodeStatement*>::iterator it= statements.begin(); it != statements.end(); ++it)
         (*it)->Optimize();
+    ResetCache();
 }
 
 void StmtBlock::OptimizeLoops()
@@ -101,6 +153,7 @@ void StmtBlock::OptimizeLoops()
             optimized_body.push_back(*it);
         }
     statements.assign(optimized_body.begin(), optimized_body.end());
+    ResetCache();
 }
 
 NodeStatement* StmtBlock::GetStmt(unsigned i)
@@ -125,6 +178,7 @@ void StmtBlock::AddStatement(NodeStatement* new_stmt)
         CopyContent((StmtBlock*)new_stmt);
     else
         statements.push_back(new_stmt);
+    ResetCache();
 }
 
 void StmtBlock::CopyContent(StmtBlock* src)
@@ -179,6 +233,22 @@ void StmtBlock::Generate(AsmCode& asm_code)
         (*it)->Generate(asm_code);
 }
 
+void StmtBlock::GenerateIR(IRBuilder& ir)
+{
+    for (vector<NodeStatement*>::const_iterator it = statements.begin(); it != statements.end(); ++it)
+        (*it)->GenerateIR(ir);
+}
+
+void StmtBlock::GenerateBC(BCBuilder& bc)
+{
+    for (vector<NodeStatement*>::const_iterator it = statements.begin(); it != statements.end(); ++it)
+    {
+        unsigned mark = bc.GetTempsMark();
+        (*it)->GenerateBC(bc);
+        bc.ReleaseTemps(mark);
+    }
+}
+
 bool StmtBlock::IsHaveSideEffect()
 {
     for (std::vector<NodeStatement*>::iterator it = statements.begin(); it != statements.end(); ++it)
@@ -186,36 +256,97 @@ bool StmtBlock::IsHaveSideEffect()
     return false;
 }
 
-void StmtBlock::GetAllAffectedVars(VarsContainer& res_cont)
+void StmtBlock::ComputeAffectedVars(VarsContainer& res_cont)
 {
     for (std::vector<NodeStatement*>::iterator it = statements.begin(); it != statements.end(); ++it)
         ((*it)->GetAllAffectedVars(res_cont));
 }
 
-void StmtBlock::GetAllDependences(VarsContainer& res_cont, bool with_self)
+void StmtBlock::ComputeDependences(VarsContainer& res_cont, bool with_self)
 {
     for (std::vector<NodeStatement*>::iterator it = statements.begin(); it != statements.end(); ++it)
         (*it)->GetAllDependences(res_cont);
 }
 
+void StmtBlock::GetAllCalls(ProcsContainer& res_cont)
+{
+    for (std::vector<NodeStatement*>::iterator it = statements.begin(); it != statements.end(); ++it)
+        (*it)->GetAllCalls(res_cont);
+}
+
 StmtClassName StmtBlock::GetClassName() const
 {
     return STMT_BLOCK;
 } 
 
-bool StmtBlock::CanBeReplaced()
+bool StmtBlock::ComputeCanBeReplaced()
 {
     for (std::vector<NodeStatement*>::iterator it = statements.begin(); it != statements.end(); ++it)
         if (!(*it)->CanBeReplaced()) return false;
     return true;
 }
 
+bool StmtBlock::ContainExit()
+{
+    for (std::vector<NodeStatement*>::iterator it = statements.begin(); it != statements.end(); ++it)
+        if ((*it)->ContainExit()) return true;
+    return false;
+}
+
+unsigned StmtBlock::GetCost()
+{
+    unsigned res = 0;
+    for (std::vector<NodeStatement*>::iterator it = statements.begin(); it != statements.end(); ++it)
+        res += (*it)->GetCost();
+    return res;
+}
+
+NodeStatement* StmtBlock::Clone(Inliner& inliner) const
+{
+    return inliner.CloneSequence(statements);
+}
+
+NodeStatement* StmtBlock::Inline(Inliner& inliner)
+{
+    std::vector<NodeStatement*> inlined;
+    for (std::vector<NodeStatement*>::iterator it = statements.begin(); it != statements.end(); ++it)
+        inlined.push_back((*it)->Inline(inliner));
+    statements.clear();
+    for (std::vector<NodeStatement*>::iterator it = inlined.begin(); it != inlined.end(); ++it)
+        AddStatement(*it);
+    return this;
+}
+
+void StmtBlock::HoistExpressions(Hoister& hoister)
+{
+    for (std::vector<NodeStatement*>::iterator it = statements.begin(); it != statements.end(); ++it)
+    {
+        (*it)->HoistExpressions(hoister);
+        StmtClassName name = (*it)->GetClassName();
+        if (name != STMT_ASSIGN && name != STMT_EXPRESSION && name != STMT_BLOCK) hoister.SetSpeculative(true);
+    }
+    ResetCache();
+}
+
+NodeStatement* StmtBlock::HoistInvariants(Hoister& hoister)
+{
+    std::vector<NodeStatement*> hoisted;
+    for (std::vector<NodeStatement*>::iterator it = statements.begin(); it != statements.end(); ++it)
+        hoisted.push_back((*it)->HoistInvariants(hoister));
+    statements.clear();
+    for (std::vector<NodeStatement*>::iterator it = hoisted.begin(); it != hoisted.end(); ++it)
+        AddStatement(*it);
+    ResetCache();
+    return this;
+}
+
 //---StmtExpression---
 
 void StmtExpression::Optimize()
 {
     expr->TryToBecomeConst(expr);
     expr->Optimize();
+    ResetCache();
 }
 
 StmtExpression::StmtExpression(SyntaxNode* expression):
@@ -234,31 +365,70 @@ void StmtExpression::Generate(AsmCode& asm_code)
     asm_code.AddCmd(ASM_ADD, expr->GetSymType()->GetSize(), REG_ESP);
 }
 
+void StmtExpression::GenerateIR(IRBuilder& ir)
+{
+    if (expr->GetSymType()->GetSize() > 4) NodeStatement::GenerateIR(ir);
+    else expr->GenerateIRValue(ir);
+}
+
+void StmtExpression::GenerateBC(BCBuilder& bc)
+{
+    expr->GenerateBCValue(bc);
+}
+
 bool StmtExpression::IsHaveSideEffect()
 {
     return expr->IsHaveSideEffect();
 }
 
-void StmtExpression::GetAllAffectedVars(VarsContainer& res_cont)
+void StmtExpression::ComputeAffectedVars(VarsContainer& res_cont)
 {
     expr->GetAllAffectedVars(res_cont);
 }
 
-void StmtExpression::GetAllDependences(VarsContainer& res_cont, bool with_self)
+void StmtExpression::ComputeDependences(VarsContainer& res_cont, bool with_self)
 {
     expr->GetAllDependences(res_cont);
 }
 
+void StmtExpression::GetAllCalls(ProcsContainer& res_cont)
+{
+    expr->GetAllCalls(res_cont);
+}
+
 StmtClassName StmtExpression::GetClassName() const
 {
     return STMT_EXPRESSION;
 } 
 
-bool StmtExpression::CanBeReplaced()
+bool StmtExpression::ComputeCanBeReplaced()
 {
     return expr->CanBeReplaced();
 }
 
+unsigned StmtExpression::GetCost()
+{
+    return expr->GetCost();
+}
+
+NodeStatement* StmtExpression::Clone(Inliner& inliner) const
+{
+    return new StmtExpression(expr->Clone(inliner));
+}
+
+NodeStatement* StmtExpression::Inline(Inliner& inliner)
+{
+    if (expr->InlineCall(inliner, NULL)) return inliner.Flush(NULL);
+    inliner.InlineNestedCalls(expr);
+    return inliner.Flush(this);
+}
+
+void StmtExpression::HoistExpressions(Hoister& hoister)
+{
+    expr->HoistExpressions(hoister);
+    ResetCache();
+}
+
 //---StmtLoop---
 
 bool StmtLoop::IsConditionAffectToVars()
@@ -277,16 +447,17 @@ void StmtLoop::ObtainLabels(AsmCode& asm_code)
     continue_label = asm_code.GenLabel("continue");;
 }
 
-void StmtLoop::CalculateDependences(set<SymVar*>& affected_cont, set<SymVar*>& deps)
+void StmtLoop::CalculateDependences(VarsContainer& affected_cont, VarsContainer& deps)
 {
 }
 
 void StmtLoop::TakeOutVars(std::vector<NodeStatement*>& before_loop)
 {
     body->OptimizeLoops();
+    ResetCache();
     StmtBlock* new_body = new StmtBlock();
-    set<SymVar*> affected_vars;
-    set<SymVar*> dependences;
+    VarsContainer affected_vars;
+    VarsContainer dependences;
     CalculateDependences(affected_vars, dependences);
     GetAllAffectedVars(affected_vars);
     GetAllDependences(dependences);
@@ -301,7 +472,8 @@ void StmtLoop::TakeOutVars(std::vector<NodeStatement*>& before_loop)
         else before_loop.push_back(stmt);
     }
     delete body;
-    body = new_body;    
+    body = new_body;
+    ResetCache();
 }
 
 StmtLoop::StmtLoop(NodeStatement* body_)
@@ -338,6 +510,7 @@ void StmtLoop::AddBody(NodeStatement* body_)
         body = new StmtBlock();
         body->AddStatement(body_);
     }
+    ResetCache();
 }
 
 StmtClassName StmtLoop::GetClassName() const
@@ -345,23 +518,55 @@ StmtClassName StmtLoop::GetClassName() const
     return STMT_LOOP;
 } 
 
+bool StmtLoop::ContainExit()
+{
+    return body->ContainExit();
+}
+
+NodeStatement* StmtLoop::Inline(Inliner& inliner)
+{
+    body->Inline(inliner);
+    return this;
+}
+
+void StmtLoop::HoistLoopExpressions(Hoister& hoister)
+{
+    hoister.SetSpeculative(true);
+    body->HoistExpressions(hoister);
+}
+
+NodeStatement* StmtLoop::HoistInvariants(Hoister& hoister)
+{
+    VarsContainer affected_vars;
+    VarsContainer dependences;
+    CalculateDependences(affected_vars, dependences);
+    GetAllAffectedVars(affected_vars);
+    hoister.SetContext(affected_vars);
+    hoister.SetSpeculative(false);
+    HoistLoopExpressions(hoister);
+    NodeStatement* res = hoister.Flush(this);
+    body->HoistInvariants(hoister);
+    ResetCache();
+    return res;
+}
+
 //---StmtFor---
 
-void StmtFor::CalculateDependences(set<SymVar*>& affected_cont, set<SymVar*>& deps)
+void StmtFor::CalculateDependences(VarsContainer& affected_cont, VarsContainer& deps)
 {
     init_val->GetAllAffectedVars(affected_cont);
     last_val->GetAllAffectedVars(affected_cont);
     init_val->GetAllDependences(deps);
     last_val->GetAllDependences(deps);    
-    affected_cont.insert(index);
+    affected_cont.Insert(index);
 }
 
 bool StmtFor::IsConditionAffectToVars()
 {
-    set<SymVar* > t;
+    VarsContainer t;
     init_val->GetAllAffectedVars(t);
     last_val->GetAllAffectedVars(t);
-    return !t.empty();
+    return !t.IsEmpty();
 }
 
 StmtFor::StmtFor(SymVar* index_, SyntaxNode* init_value, SyntaxNode* last_value, bool is_inc, NodeStatement* body_):
@@ -409,29 +614,79 @@ void StmtFor::Generate(AsmCode& asm_code)
     asm_code.AddCmd(ASM_ADD, 4, REG_ESP);
 }
 
+void StmtFor::GenerateIR(IRBuilder& ir)
+{
+    ir.StoreVar(index, init_val->GenerateIRValue(ir));
+    int last = last_val->GenerateIRValue(ir);
+    IRBlock* body_block = ir.NewBlock();
+    IRBlock* check_block = ir.NewBlock();
+    IRBlock* break_block = ir.NewBlock();
+    ir.Jump(check_block);
+    ir.SetBlock(body_block);
+    ir.PushLoop(this, break_block, check_block);
+    body->GenerateIR(ir);
+    ir.PopLoop();
+    int value = ir.LoadVar(index, IR_INT);
+    ir.StoreVar(index, ir.Binary(inc ? IR_ADD : IR_SUB, IR_INT, value, ir.Const(1)));
+    ir.SetBlock(check_block);
+    value = ir.LoadVar(index, IR_INT);
+    ir.Branch(ir.Binary(inc ? IR_LE : IR_GE, IR_INT, value, last), body_block, break_block);
+    ir.SetBlock(break_block);
+}
+
+void StmtFor::GenerateBC(BCBuilder& bc)
+{
+    bc.StoreVar(index, init_val->GenerateBCValue(bc));
+    int last = last_val->GenerateBCValue(bc);
+    if (!bc.IsTemp(last)) last = bc.Snapshot(last);
+    int start_label = bc.NewLabel();
+    int check_label = bc.NewLabel();
+    int break_label = bc.NewLabel();
+    bc.Jump(check_label);
+    bc.BindLabel(start_label);
+    bc.PushLoop(this, break_label, check_label);
+    body->GenerateBC(bc);
+    bc.PopLoop();
+    int cell = bc.VarCell(index);
+    if (cell != BC_NO_REG)
+        bc.Emit(BC_ADDI, cell, cell, inc ? 1 : -1);
+    else
+        bc.StoreVar(index, bc.BinaryImm(BC_ADDI, bc.LoadVar(index), inc ? 1 : -1));
+    bc.BindLabel(check_label);
+    bc.Branch(inc ? BC_JLE : BC_JGE, bc.LoadVar(index), last, start_label);
+    bc.BindLabel(break_label);
+}
+
 bool StmtFor::IsHaveSideEffect()
 {
     return (index->GetClassName() & SYM_VAR_GLOBAL) || body->IsHaveSideEffect()
         || init_val->IsHaveSideEffect() || last_val->IsHaveSideEffect();
 }
 
-void StmtFor::GetAllAffectedVars(VarsContainer& res_cont)
+void StmtFor::ComputeAffectedVars(VarsContainer& res_cont)
 {
-    res_cont.insert(index);
+    res_cont.Insert(index);
     body->GetAllAffectedVars(res_cont);
     init_val->GetAllAffectedVars(res_cont);
     last_val->GetAllAffectedVars(res_cont);
 }
 
-void StmtFor::GetAllDependences(VarsContainer& res_cont, bool with_self)
+void StmtFor::ComputeDependences(VarsContainer& res_cont, bool with_self)
 {
-    res_cont.insert(index);
+    res_cont.Insert(index);
     body->GetAllDependences(res_cont);
     init_val->GetAllDependences(res_cont);
     last_val->GetAllDependences(res_cont);
 }
 
-bool StmtFor::CanBeReplaced()
+void StmtFor::GetAllCalls(ProcsContainer& res_cont)
+{
+    body->GetAllCalls(res_cont);
+    init_val->GetAllCalls(res_cont);
+    last_val->GetAllCalls(res_cont);
+}
+
+bool StmtFor::ComputeCanBeReplaced()
 {
     return init_val->CanBeReplaced() && last_val->CanBeReplaced() && body->CanBeReplaced();
 }
@@ -441,23 +696,61 @@ void StmtFor::Optimize()
     init_val->Optimize();
     last_val->Optimize();
     body->Optimize();
+    ResetCache();
+}
+
+unsigned StmtFor::GetCost()
+{
+    return 2 + init_val->GetCost() + last_val->GetCost() + body->GetCost();
+}
+
+NodeStatement* StmtFor::Clone(Inliner& inliner) const
+{
+    StmtFor* res = new StmtFor(inliner.MapIndex(index), init_val->Clone(inliner), last_val->Clone(inliner), inc);
+    inliner.AddLoop(this, res);
+    res->AddBody(body->Clone(inliner));
+    return res;
+}
+
+NodeStatement* StmtFor::Inline(Inliner& inliner)
+{
+    inliner.InlineNestedCalls(init_val);
+    NodeStatement* res = inliner.Flush(this);
+    body->Inline(inliner);
+    return res;
+}
+
+void StmtFor::HoistExpressions(Hoister& hoister)
+{
+    hoister.Hoist(init_val);
+    hoister.Hoist(last_val);
+    bool speculative = hoister.IsSpeculative();
+    hoister.SetSpeculative(true);
+    body->HoistExpressions(hoister);
+    hoister.SetSpeculative(speculative);
+    ResetCache();
 }
 
 //---StmtWhile---
 
 bool StmtWhile::IsConditionAffectToVars()
 {
-    set<SymVar*> t;
+    VarsContainer t;
     condition->GetAllAffectedVars(t);
-    return !t.empty();
+    return !t.IsEmpty();
 }
 
-void StmtWhile::CalculateDependences(set<SymVar*>& affected_cont, set<SymVar*>& deps)
+void StmtWhile::CalculateDependences(VarsContainer& affected_cont, VarsContainer& deps)
 {
     condition->GetAllAffectedVars(affected_cont);
     condition->GetAllDependences(deps);    
 }
 
+void StmtWhile::HoistLoopExpressions(Hoister& hoister)
+{
+    HoistExpressions(hoister);
+}
+
 StmtWhile::StmtWhile(SyntaxNode* condition_, NodeStatement* body_):
     StmtLoop(body_),
     condition(condition_)
@@ -475,33 +768,64 @@ void StmtWhile::Generate(AsmCode& asm_code)
 {
     ObtainLabels(asm_code);
     asm_code.AddLabel(continue_label);
-    condition->GenerateValue(asm_code);
-    asm_code.AddCmd(ASM_POP, REG_EAX);
-    asm_code.AddCmd(ASM_TEST, REG_EAX, REG_EAX);
-    asm_code.AddCmd(ASM_JZ, break_label, SIZE_NONE);
+    condition->GenerateCondJump(asm_code, break_label, false);
     body->Generate(asm_code);
     asm_code.AddCmd(ASM_JMP, continue_label, SIZE_NONE);
     asm_code.AddLabel(break_label);
 }
 
+void StmtWhile::GenerateIR(IRBuilder& ir)
+{
+    IRBlock* check_block = ir.NewBlock();
+    IRBlock* body_block = ir.NewBlock();
+    IRBlock* break_block = ir.NewBlock();
+    ir.SetBlock(check_block);
+    condition->GenerateIRCondJump(ir, body_block, break_block);
+    ir.SetBlock(body_block);
+    ir.PushLoop(this, break_block, check_block);
+    body->GenerateIR(ir);
+    ir.PopLoop();
+    ir.Jump(check_block);
+    ir.SetBlock(break_block);
+}
+
+void StmtWhile::GenerateBC(BCBuilder& bc)
+{
+    int check_label = bc.NewLabel();
+    int break_label = bc.NewLabel();
+    bc.BindLabel(check_label);
+    condition->GenerateBCCondJump(bc, break_label, false);
+    bc.PushLoop(this, break_label, check_label);
+    body->GenerateBC(bc);
+    bc.PopLoop();
+    bc.Jump(check_label);
+    bc.BindLabel(break_label);
+}
+
 bool StmtWhile::IsHaveSideEffect()
 {
     return condition->IsHaveSideEffect() || body->IsHaveSideEffect();
 }
 
-void StmtWhile::GetAllAffectedVars(VarsContainer& res_cont)
+void StmtWhile::ComputeAffectedVars(VarsContainer& res_cont)
 {
     condition->GetAllAffectedVars(res_cont);
     body->GetAllAffectedVars(res_cont);
 }
 
-void StmtWhile::GetAllDependences(VarsContainer& res_cont, bool with_self)
+void StmtWhile::ComputeDependences(VarsContainer& res_cont, bool with_self)
 {
     condition->GetAllDependences(res_cont);
     body->GetAllDependences(res_cont);
 }
 
-bool StmtWhile::CanBeReplaced()
+void StmtWhile::GetAllCalls(ProcsContainer& res_cont)
+{
+    condition->GetAllCalls(res_cont);
+    body->GetAllCalls(res_cont);
+}
+
+bool StmtWhile::ComputeCanBeReplaced()
 {
     return condition->CanBeReplaced() && body->CanBeReplaced();
 }
@@ -510,6 +834,30 @@ void StmtWhile::Optimize()
 {
     condition->Optimize();
     body->Optimize();
+    ResetCache();
+}
+
+unsigned StmtWhile::GetCost()
+{
+    return 1 + condition->GetCost() + body->GetCost();
+}
+
+NodeStatement* StmtWhile::Clone(Inliner& inliner) const
+{
+    StmtWhile* res = new StmtWhile(condition->Clone(inliner));
+    inliner.AddLoop(this, res);
+    res->AddBody(body->Clone(inliner));
+    return res;
+}
+
+void StmtWhile::HoistExpressions(Hoister& hoister)
+{
+    hoister.Hoist(condition);
+    bool speculative = hoister.IsSpeculative();
+    hoister.SetSpeculative(true);
+    body->HoistExpressions(hoister);
+    hoister.SetSpeculative(speculative);
+    ResetCache();
 }
 
 //---StmtUntil---
@@ -538,13 +886,56 @@ void StmtUntil::Generate(AsmCode& asm_code)
     asm_code.AddLabel(start_label);
     body->Generate(asm_code);
     asm_code.AddLabel(continue_label);
-    condition->GenerateValue(asm_code);
-    asm_code.AddCmd(ASM_POP, REG_EAX);
-    asm_code.AddCmd(ASM_TEST, REG_EAX, REG_EAX);
-    asm_code.AddCmd(ASM_JZ, start_label, SIZE_NONE);
+    condition->GenerateCondJump(asm_code, start_label, false);
     asm_code.AddLabel(break_label);
 }
 
+void StmtUntil::GenerateIR(IRBuilder& ir)
+{
+    IRBlock* body_block = ir.NewBlock();
+    IRBlock* check_block = ir.NewBlock();
+    IRBlock* break_block = ir.NewBlock();
+    ir.SetBlock(body_block);
+    ir.PushLoop(this, break_block, check_block);
+    body->GenerateIR(ir);
+    ir.PopLoop();
+    ir.SetBlock(check_block);
+    condition->GenerateIRCondJump(ir, break_block, body_block);
+    ir.SetBlock(break_block);
+}
+
+void StmtUntil::GenerateBC(BCBuilder& bc)
+{
+    int start_label = bc.NewLabel();
+    int check_label = bc.NewLabel();
+    int break_label = bc.NewLabel();
+    bc.BindLabel(start_label);
+    bc.PushLoop(this, break_label, check_label);
+    body->GenerateBC(bc);
+    bc.PopLoop();
+    bc.BindLabel(check_label);
+    condition->GenerateBCCondJump(bc, start_label, false);
+    bc.BindLabel(break_label);
+}
+
+NodeStatement* StmtUntil::Clone(Inliner& inliner) const
+{
+    StmtUntil* res = new StmtUntil(NULL);
+    res->AddCondition(condition->Clone(inliner));
+    inliner.AddLoop(this, res);
+    res->AddBody(body->Clone(inliner));
+    return res;
+}
+
+void StmtUntil::HoistExpressions(Hoister& hoister)
+{
+    bool speculative = hoister.IsSpeculative();
+    body->HoistExpressions(hoister);
+    hoister.Hoist(condition);
+    hoister.SetSpeculative(speculative);
+    ResetCache();
+}
+
 //---StmtIf---
 
 bool StmtIf::OptimizeIf(NodeStatement*& res)
@@ -593,10 +984,7 @@ void StmtIf::Generate(AsmCode& asm_code)
     if (then_branch == NULL) return;
     AsmStrImmediate label_else(asm_code.GenLabel("else"));
     AsmStrImmediate label_fin(asm_code.GenLabel("fin"));
-    condition->GenerateValue(asm_code);
-    asm_code.AddCmd(ASM_POP, REG_EAX);
-    asm_code.AddCmd(ASM_TEST, REG_EAX, REG_EAX);
-    asm_code.AddCmd(ASM_JZ, label_else, SIZE_NONE);
+    condition->GenerateCondJump(asm_code, label_else, false);
     then_branch->Generate(asm_code);
     asm_code.AddCmd(ASM_JMP, label_fin, SIZE_NONE);
     asm_code.AddLabel(label_else);
@@ -604,6 +992,42 @@ void StmtIf::Generate(AsmCode& asm_code)
     asm_code.AddLabel(label_fin);
 }
 
+void StmtIf::GenerateIR(IRBuilder& ir)
+{
+    if (then_branch == NULL) return;
+    IRBlock* then_block = ir.NewBlock();
+    IRBlock* else_block = ir.NewBlock();
+    IRBlock* fin_block = else_branch != NULL ? ir.NewBlock() : else_block;
+    condition->GenerateIRCondJump(ir, then_block, else_block);
+    ir.SetBlock(then_block);
+    then_branch->GenerateIR(ir);
+    if (else_branch != NULL)
+    {
+        ir.Jump(fin_block);
+        ir.SetBlock(else_block);
+        else_branch->GenerateIR(ir);
+    }
+    ir.SetBlock(fin_block);
+}
+
+void StmtIf::GenerateBC(BCBuilder& bc)
+{
+    if (then_branch == NULL) return;
+    int else_label = bc.NewLabel();
+    condition->GenerateBCCondJump(bc, else_label, false);
+    then_branch->GenerateBC(bc);
+    if (else_branch != NULL)
+    {
+        int fin_label = bc.NewLabel();
+        bc.Jump(fin_label);
+        bc.BindLabel(else_label);
+        else_branch->GenerateBC(bc);
+        bc.BindLabel(fin_label);
+    }
+    else
+        bc.BindLabel(else_label);
+}
+
 bool StmtIf::IsHaveSideEffect()
 {
     return condition->IsHaveSideEffect() ||
@@ -611,26 +1035,33 @@ bool StmtIf::IsHaveSideEffect()
         (else_branch != NULL && else_branch->IsHaveSideEffect());
 }
 
-void StmtIf::GetAllAffectedVars(VarsContainer& res_cont)
+void StmtIf::ComputeAffectedVars(VarsContainer& res_cont)
 {
     condition->GetAllAffectedVars(res_cont);
     if (then_branch != NULL) then_branch->GetAllAffectedVars(res_cont);
     if (else_branch != NULL) else_branch->GetAllAffectedVars(res_cont);
 }
 
-void StmtIf::GetAllDependences(VarsContainer& res_cont, bool with_self)
+void StmtIf::ComputeDependences(VarsContainer& res_cont, bool with_self)
 {
     condition->GetAllDependences(res_cont);
     if (then_branch != NULL) then_branch->GetAllDependences(res_cont);
     if (else_branch != NULL) else_branch->GetAllDependences(res_cont);
 }
 
+void StmtIf::GetAllCalls(ProcsContainer& res_cont)
+{
+    condition->GetAllCalls(res_cont);
+    if (then_branch != NULL) then_branch->GetAllCalls(res_cont);
+    if (else_branch != NULL) else_branch->GetAllCalls(res_cont);
+}
+
 StmtClassName StmtIf::GetClassName() const
 {
     return STMT_IF;
 } 
 
-bool StmtIf::CanBeReplaced()
+bool StmtIf::ComputeCanBeReplaced()
 {
     return ((then_branch == NULL) || then_branch->CanBeReplaced()) &&
         ((else_branch == NULL || else_branch->CanBeReplaced()));    
@@ -646,6 +1077,62 @@ void StmtIf::Optimize()
 {
     if (then_branch != NULL) then_branch->Optimize();
     if (else_branch != NULL) else_branch->Optimize();
+    ResetCache();
+}
+
+bool StmtIf::ContainExit()
+{
+    return (then_branch != NULL && then_branch->ContainExit()) ||
+        (else_branch != NULL && else_branch->ContainExit());
+}
+
+unsigned StmtIf::GetCost()
+{
+    return 1 + condition->GetCost() + (then_branch != NULL ? then_branch->GetCost() : 0) +
+        (else_branch != NULL ? else_branch->GetCost() : 0);
+}
+
+NodeStatement* StmtIf::Clone(Inliner& inliner) const
+{
+    return new StmtIf(condition->Clone(inliner), then_branch != NULL ? then_branch->Clone(inliner) : NULL,
+        else_branch != NULL ? else_branch->Clone(inliner) : NULL);
+}
+
+NodeStatement* StmtIf::CloneWithTail(Inliner& inliner, const std::vector<NodeStatement*>& tail) const
+{
+    std::vector<NodeStatement*> then_stmts(tail);
+    std::vector<NodeStatement*> else_stmts(tail);
+    if (then_branch != NULL) then_stmts.insert(then_stmts.begin(), then_branch);
+    if (else_branch != NULL) else_stmts.insert(else_stmts.begin(), else_branch);
+    return new StmtIf(condition->Clone(inliner), inliner.CloneSequence(then_stmts), inliner.CloneSequence(else_stmts));
+}
+
+NodeStatement* StmtIf::Inline(Inliner& inliner)
+{
+    inliner.InlineNestedCalls(condition);
+    NodeStatement* res = inliner.Flush(this);
+    if (then_branch != NULL) then_branch = then_branch->Inline(inliner);
+    if (else_branch != NULL) else_branch = else_branch->Inline(inliner);
+    return res;
+}
+
+void StmtIf::HoistExpressions(Hoister& hoister)
+{
+    hoister.Hoist(condition);
+    bool speculative = hoister.IsSpeculative();
+    hoister.SetSpeculative(true);
+    if (then_branch != NULL) then_branch->HoistExpressions(hoister);
+    if (else_branch != NULL) else_branch->HoistExpressions(hoister);
+    hoister.SetSpeculative(speculative);
+    ResetCache();
+}
+
+NodeStatement* StmtIf::HoistInvariants(Hoister& hoister)
+{
+    if (then_branch != NULL) then_branch = then_branch->HoistInvariants(hoister);
+    if (else_branch != NULL) else_branch = else_branch->HoistInvariants(hoister);
+    ResetCache();
+    return this;
 }
 
 //---StmtJump---
@@ -667,7 +1154,17 @@ void StmtJump::Generate(AsmCode& asm_code)
     asm_code.AddCmd(ASM_JMP, label, SIZE_NONE);
 }
 
-void StmtJump::GetAllAffectedVars(VarsContainer& res_cont)
+void StmtJump::GenerateIR(IRBuilder& ir)
+{
+    ir.Jump(op.GetValue() == TOK_BREAK ? ir.GetBreakBlock(loop) : ir.GetContinueBlock(loop));
+}
+
+void StmtJump::GenerateBC(BCBuilder& bc)
+{
+    bc.Jump(op.GetValue() == TOK_BREAK ? bc.GetBreakLabel(loop) : bc.GetContinueLabel(loop));
+}
+
+void StmtJump::ComputeAffectedVars(VarsContainer& res_cont)
 {
 }
 
@@ -681,6 +1178,11 @@ bool StmtJump::ContainJump()
     return true;
 }
 
+NodeStatement* StmtJump::Clone(Inliner& inliner) const
+{
+    return new StmtJump(op, inliner.MapLoop(loop));
+}
+
 //---StmtExit---
 
 StmtExit::StmtExit(AsmStrImmediate exit_label):
@@ -698,7 +1200,17 @@ void StmtExit::Generate(AsmCode& asm_code)
     asm_code.AddCmd(ASM_JMP, label, SIZE_NONE);
 }
 
-void StmtExit::GetAllAffectedVars(VarsContainer& res_cont)
+void StmtExit::GenerateIR(IRBuilder& ir)
+{
+    ir.Jump(ir.GetExitBlock());
+}
+
+void StmtExit::GenerateBC(BCBuilder& bc)
+{
+    bc.Jump(bc.GetExitLabel());
+}
+
+void StmtExit::ComputeAffectedVars(VarsContainer& res_cont)
 {
 }
 
@@ -707,7 +1219,12 @@ StmtClassName StmtExit::GetClassName() const
     return STMT_EXIT;
 } 
 
-bool StmtExit::CanBeReplaced()
+bool StmtExit::ComputeCanBeReplaced()
 {
     return false;
 }
+
+bool StmtExit::ContainExit()
+{
+    return true;
+}
@@ -20,11 +20,18 @@ public:
     const SyntaxNode* GetRight() const;
     virtual void Print(ostream& o, int offset = 0) const;
     virtual void Generate(AsmCode& asm_code);
+    virtual void GenerateIR(IRBuilder& ir);
+    virtual void GenerateBC(BCBuilder& bc);
     virtual bool IsHaveSideEffect();
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer& res_cont);
     virtual StmtClassName GetClassName() const;
-    virtual bool CanBeReplaced();
+    virtual bool ComputeCanBeReplaced();
+    virtual unsigned GetCost();
+    virtual NodeStatement* Clone(Inliner& inliner) const;
+    virtual void HoistExpressions(Hoister& hoister);
+    virtual NodeStatement* Inline(Inliner& inliner);
 };
 
 class StmtBlock: public NodeStatement{
@@ -40,11 +47,20 @@ public:
     void CopyContent(StmtBlock* src);
     virtual void Print(ostream& o, int offset = 0) const;
     virtual void Generate(AsmCode& asm_code);
+    virtual void GenerateIR(IRBuilder& ir);
+    virtual void GenerateBC(BCBuilder& bc);
     virtual bool IsHaveSideEffect();    
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer& res_cont);
     virtual StmtClassName GetClassName() const;
-    virtual bool CanBeReplaced();
+    virtual bool ComputeCanBeReplaced();
+    virtual bool ContainExit();
+    virtual unsigned GetCost();
+    virtual NodeStatement* Clone(Inliner& inliner) const;
+    virtual void HoistExpressions(Hoister& hoister);
+    virtual NodeStatement* Inline(Inliner& inliner);
+    virtual NodeStatement* HoistInvariants(Hoister& hoister);
 //debug    virtual void Print(ostream& o, int offset = 0);
 };
 
@@ -56,11 +72,18 @@ public:
     StmtExpression(SyntaxNode* expression);
     virtual void Print(ostream& o, int offset = 0) const;
     virtual void Generate(AsmCode& asm_code);
+    virtual void GenerateIR(IRBuilder& ir);
+    virtual void GenerateBC(BCBuilder& bc);
     virtual bool IsHaveSideEffect();    
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer& res_cont);
     virtual StmtClassName GetClassName() const;
-    virtual bool CanBeReplaced();
+    virtual bool ComputeCanBeReplaced();
+    virtual unsigned GetCost();
+    virtual NodeStatement* Clone(Inliner& inliner) const;
+    virtual void HoistExpressions(Hoister& hoister);
+    virtual NodeStatement* Inline(Inliner& inliner);
 };
 
 class StmtLoop: public NodeStatement{
@@ -69,7 +92,7 @@ protected:
     AsmStrImmediate continue_label;
     StmtBlock* body;
     void ObtainLabels(AsmCode& asm_code);
-    virtual void CalculateDependences(set<SymVar*>& affectte_cont, set<SymVar*>& deps);
+    virtual void CalculateDependences(VarsContainer& affectte_cont, VarsContainer& deps);
 public:
     StmtBlock* GetBody() const;
     void TakeOutVars(std::vector<NodeStatement*>& before_loop);
@@ -80,6 +103,10 @@ public:
     bool IsDummyLoop();
     virtual StmtClassName GetClassName() const;
     virtual bool IsConditionAffectToVars();
+    virtual void HoistLoopExpressions(Hoister& hoister);
+    virtual bool ContainExit();
+    virtual NodeStatement* Inline(Inliner& inliner);
+    virtual NodeStatement* HoistInvariants(Hoister& hoister);
 };
 
 class StmtFor: public StmtLoop{
@@ -88,34 +115,48 @@ private:
     SyntaxNode* init_val;
     SyntaxNode* last_val;
     bool inc;
-    virtual void CalculateDependences(set<SymVar*>& affected_cont, set<SymVar*>& deps);
+    virtual void CalculateDependences(VarsContainer& affected_cont, VarsContainer& deps);
 public:
     StmtFor(SymVar* index_, SyntaxNode* init_value, SyntaxNode* last_value,
             bool is_inc, NodeStatement* body_ = NULL);
     virtual void Print(ostream& o, int offset = 0) const;
     virtual void Generate(AsmCode& asm_code);
+    virtual void GenerateIR(IRBuilder& ir);
+    virtual void GenerateBC(BCBuilder& bc);
     virtual bool IsHaveSideEffect();
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer& res_cont);
     virtual bool IsConditionAffectToVars();
-    virtual bool CanBeReplaced();
+    virtual bool ComputeCanBeReplaced();
     virtual void Optimize();
+    virtual unsigned GetCost();
+    virtual NodeStatement* Clone(Inliner& inliner) const;
+    virtual void HoistExpressions(Hoister& hoister);
+    virtual NodeStatement* Inline(Inliner& inliner);
 };
 
 class StmtWhile: public StmtLoop{
 protected:
     SyntaxNode* condition;    
-    virtual void CalculateDependences(set<SymVar*>& affected_cont, set<SymVar*>& deps);
+    virtual void CalculateDependences(VarsContainer& affected_cont, VarsContainer& deps);
 public:
     StmtWhile(SyntaxNode* condition_ = NULL , NodeStatement* body_ = NULL);
     virtual void Print(ostream& o, int offset = 0) const;
     virtual void Generate(AsmCode& asm_code);
+    virtual void GenerateIR(IRBuilder& ir);
+    virtual void GenerateBC(BCBuilder& bc);
     virtual bool IsHaveSideEffect();
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer& res_cont);
     virtual bool IsConditionAffectToVars();
-    virtual bool CanBeReplaced();
+    virtual void HoistLoopExpressions(Hoister& hoister);
+    virtual bool ComputeCanBeReplaced();
     virtual void Optimize();
+    virtual unsigned GetCost();
+    virtual NodeStatement* Clone(Inliner& inliner) const;
+    virtual void HoistExpressions(Hoister& hoister);
 };
 
 class StmtUntil: public StmtWhile{
@@ -124,6 +165,10 @@ public:
     void AddCondition(SyntaxNode* condition);
     virtual void Print(ostream& o, int offset = 0) const;
     virtual void Generate(AsmCode& asm_code);
+    virtual void GenerateIR(IRBuilder& ir);
+    virtual void GenerateBC(BCBuilder& bc);
+    virtual NodeStatement* Clone(Inliner& inliner) const;
+    virtual void HoistExpressions(Hoister& hoister);
 };
 
 class StmtIf: public NodeStatement{
@@ -136,13 +181,23 @@ public:
     StmtIf(SyntaxNode* condition_, NodeStatement* then_branch_, NodeStatement* else_branch_ = NULL);
     virtual void Print(ostream& o, int offset = 0) const;
     virtual void Generate(AsmCode& asm_code);
+    virtual void GenerateIR(IRBuilder& ir);
+    virtual void GenerateBC(BCBuilder& bc);
     virtual bool IsHaveSideEffect();
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer& res_cont);
     virtual StmtClassName GetClassName() const;
-    virtual bool CanBeReplaced();
+    virtual bool ComputeCanBeReplaced();
     virtual bool ContainJump();
     virtual void Optimize();
+    virtual bool ContainExit();
+    virtual unsigned GetCost();
+    virtual NodeStatement* Clone(Inliner& inliner) const;
+    virtual void HoistExpressions(Hoister& hoister);
+    NodeStatement* CloneWithTail(Inliner& inliner, const std::vector<NodeStatement*>& tail) const;
+    virtual NodeStatement* Inline(Inliner& inliner);
+    virtual NodeStatement* HoistInvariants(Hoister& hoister);
 };
 
 class StmtJump: public NodeStatement{
@@ -153,9 +208,12 @@ public:
     StmtJump(Token tok, StmtLoop* loop_);
     virtual void Print(ostream& o, int offset = 0) const;
     virtual void Generate(AsmCode& asm_code);
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
+    virtual void GenerateIR(IRBuilder& ir);
+    virtual void GenerateBC(BCBuilder& bc);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
     virtual StmtClassName GetClassName() const;
     virtual bool ContainJump();
+    virtual NodeStatement* Clone(Inliner& inliner) const;
 };
 
 class StmtExit: public NodeStatement{
@@ -165,9 +223,12 @@ public:
     StmtExit(AsmStrImmediate exit_label);
     virtual void Print(ostream& o, int offset = 0) const;
     virtual void Generate(AsmCode& asm_code);
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
+    virtual void GenerateIR(IRBuilder& ir);
+    virtual void GenerateBC(BCBuilder& bc);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
     virtual StmtClassName GetClassName() const;
-    virtual bool CanBeReplaced();
+    virtual bool ComputeCanBeReplaced();
+    virtual bool ContainExit();
 };
 
 #endif
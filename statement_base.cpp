@@ -11,6 +11,35 @@ void NodeStatement::Generate(AsmCode& asm_code)
 {
 }
 
+void NodeStatement::GenerateIR(IRBuilder& ir)
+{
+    ir.StackStmt(this);
+}
+
+void NodeStatement::GenerateBC(BCBuilder& bc)
+{
+}
+
+bool NodeStatement::ContainExit()
+{
+    return false;
+}
+
+NodeStatement* NodeStatement::Clone(Inliner& inliner) const
+{
+    return NULL;
+}
+
+NodeStatement* NodeStatement::Inline(Inliner& inliner)
+{
+    return this;
+}
+
+NodeStatement* NodeStatement::HoistInvariants(Hoister& hoister)
+{
+    return this;
+}
+
 /*void NodeStatement::Print(ostream& o, int offset) 
 {
     ((const NodeStatement*)this)->Print(o, offset);
@@ -7,6 +7,8 @@
 #include <vector>
 
 class SymVar;
+class Inliner;
+class Hoister;
 
 enum StmtClassName{
     STMT,
@@ -23,6 +25,12 @@ class NodeStatement: public SyntaxNodeBase{
 public:
     virtual StmtClassName GetClassName() const;
     virtual void Generate(AsmCode& asm_code);
+    virtual void GenerateIR(IRBuilder& ir);
+    virtual void GenerateBC(BCBuilder& bc);
+    virtual bool ContainExit();
+    virtual NodeStatement* Clone(Inliner& inliner) const;
+    virtual NodeStatement* Inline(Inliner& inliner);
+    virtual NodeStatement* HoistInvariants(Hoister& hoister);
 };
 
 #endif
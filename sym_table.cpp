@@ -43,6 +43,11 @@ const char* Symbol::GetName() const
     return token.GetName();
 }
 
+unsigned Symbol::GetId() const
+{
+    return token.GetId();
+}
+
 Token Symbol::GetToken() const
 {
     return token;
@@ -127,10 +132,10 @@ bool SymProc::IsDependOnParam(int index)
 SymProc::SymProc(Token name):
     Symbol(name),
     have_side_effect(false),
-    known_side_effect(false),
-    searching(false),
+    can_be_replaced(true),
+    dummy_proc(false),
     sym_table(NULL),
-    dummy_proc(false)
+    body(NULL)
 {
 }
 
@@ -172,9 +177,10 @@ void SymProc::AddBody(NodeStatement* body_)
 SymProc::SymProc(Token token, SymTable* syn_table_):
     Symbol(token),
     have_side_effect(false),
-    known_side_effect(false),
-    searching(false),
-    sym_table(syn_table_)
+    can_be_replaced(true),
+    dummy_proc(false),
+    sym_table(syn_table_),
+    body(NULL)
 {
 }
 
@@ -220,14 +226,28 @@ void SymProc::GenerateDeclaration(AsmCode& asm_code)
 {
     if (IsDummyProc()) return;
     asm_code.AddLabel(label);
-    asm_code.AddCmd(ASM_PUSH, REG_EBP);
-    asm_code.AddCmd(ASM_MOV, REG_ESP, REG_EBP);
-    if (sym_table->GetLocalsSize()) asm_code.AddCmd(ASM_SUB, sym_table->GetLocalsSize(), REG_ESP);
-    body->Generate(asm_code);
+    asm_code.GenFrameEnter();
+    if (asm_code.IsIREnabled())
+    {
+        IRFunction ir(sym_table->GetLocalsSize());
+        ir.Build(body);
+        ir.Lower(asm_code);
+    }
+    else
+    {
+        if (sym_table->GetLocalsSize()) asm_code.AddCmd(ASM_SUB, sym_table->GetLocalsSize(), REG_ESP);
+        body->Generate(asm_code);
+    }
     asm_code.AddLabel(exit_label);
-    asm_code.AddCmd(ASM_MOV, REG_EBP, REG_ESP);
-    asm_code.AddCmd(ASM_POP, REG_EBP);
-    asm_code.AddCmd(ASM_RET, sym_table->GetParamsSize() - GetResultType()->GetSize());
+    asm_code.GenFrameLeave(sym_table->GetParamsSize() - GetResultType()->GetSize());
+}
+
+void SymProc::PrintIR(ostream& o, bool allocate)
+{
+    if (IsDummyProc()) return;
+    IRFunction ir(sym_table->GetLocalsSize());
+    ir.Build(body);
+    ir.Print(o, token.GetName(), allocate);
 }
 
 AsmStrImmediate SymProc::GetLabel() const
@@ -257,7 +277,7 @@ bool SymProc::ValidateParams(SymProc* src)
     if (params.size() != src->params.size()) return false;
     for (int i = 0; i < params.size(); ++i)
         if (params[i]->GetVarType() != src->params[i]->GetVarType()
-            || strcmp(params[i]->GetName(), src->params[i]->GetName())) return false;
+            || params[i]->GetId() != src->params[i]->GetId()) return false;
     return true;
 }
 
@@ -268,48 +288,62 @@ bool SymProc::IsDummyProc()
 
 bool SymProc::IsHaveSideEffect()
 {
-    if (known_side_effect) return have_side_effect;
-    known_side_effect = true;
-    have_side_effect = body->IsHaveSideEffect();
     return have_side_effect;
 }
 
 bool SymProc::IsAffectToVar(SymVar* var)
 {
-    if (searching) return false;
-    searching = true;
-    bool res = body->IsAffectToVar(var);
-    searching = false;
-    return res;
+    return affected.IsContain(var);
 }
 
 bool SymProc::IsDependOnVar(SymVar* var)
 {
-    if (searching) return false;
-    searching = true;
-    bool res = body->IsDependOnVar(var);
-    searching = false;
-    return res;
+    return dependences.IsContain(var);
 }
 
 void SymProc::GetAllAffectedVars(VarsContainer& res_cont)
 {
-    if (searching) return;
-    searching = true;
-    body->GetAllAffectedVars(res_cont);
-    searching = false;
+    res_cont.Insert(affected);
 }
 
 void SymProc::GetAllDependences(VarsContainer& res_cont)
 {
-    if (searching) return;
-    searching = true;
-    body->GetAllDependences(res_cont);
-    searching = false;
+    res_cont.Insert(dependences);
+}
+
+void SymProc::GetAllCalls(ProcsContainer& res_cont)
+{
+    if (body != NULL) body->GetAllCalls(res_cont);
+}
+
+void SymProc::ClearSummary()
+{
+    have_side_effect = false;
+    can_be_replaced = true;
+    affected.Clear();
+    dependences.Clear();
+}
+
+bool SymProc::UpdateSummary()
+{
+    if (body == NULL) return false;
+    VarsContainer new_affected, new_dependences;
+    body->GetAllAffectedVars(new_affected);
+    body->GetAllDependences(new_dependences);
+    bool new_side_effect = body->IsHaveSideEffect();
+    bool new_can_be_replaced = body->CanBeReplaced();
+    bool changed = new_affected.GetSize() != affected.GetSize() || new_dependences.GetSize() != dependences.GetSize()
+        || new_side_effect != have_side_effect || new_can_be_replaced != can_be_replaced;
+    affected.Swap(new_affected);
+    dependences.Swap(new_dependences);
+    have_side_effect = new_side_effect;
+    can_be_replaced = new_can_be_replaced;
+    return changed;
 }
 
 void SymProc::Optimize()
 {
+    if (body == NULL) return;
     body->Optimize();
     dummy_proc = !IsHaveSideEffect();
     for (int i = 0; i < params.size() && dummy_proc; ++i)
@@ -318,11 +352,7 @@ void SymProc::Optimize()
 
 bool SymProc::CanBeReplaced()
 {
-    if (searching) return true; 
-    searching = true;
-    bool res = body->CanBeReplaced();
-    searching = false;
-    return res;
+    return can_be_replaced;
 }
 
 //---SymFunct---
@@ -339,11 +369,11 @@ SymFunct::SymFunct(Token name):
 {
 }
 
-void SymFunct::AddResultType(const SymType* result_type_)
+void SymFunct::AddResultType(const SymType* result_type_, unsigned params_offset)
 {
     result_type = result_type_;
     Token tok("Result", IDENTIFIER, TOK_UNRESERVED, -1, -1);
-    SymVarParam* param = new SymVarParam(tok, result_type, false, sym_table->GetParamsSize() + 8);
+    SymVarParam* param = new SymVarParam(tok, result_type, false, sym_table->GetParamsSize() + params_offset);
     sym_table->Add(param);
 }
 
@@ -372,10 +402,18 @@ bool SymFunct::IsDummyProc()
 
 //---SymVar---
 
+unsigned SymVar::vars_count = 0;
+
 SymVar::SymVar(Token token, const SymType* type_):
     Symbol(token),
-    type(type_)
+    type(type_),
+    index(vars_count++)
+{
+}
+
+unsigned SymVar::GetIndex() const
 {
+    return index;
 }
 
 SymbolClass SymVar::GetClassName() const
@@ -530,6 +568,11 @@ SymTypeRecord::SymTypeRecord(SymTable* sym_table_):
 {
 }
 
+SymTypeRecord::~SymTypeRecord()
+{
+    delete sym_table;
+}
+
 const SymVarLocal* SymTypeRecord::FindField(Token& field_name)
 {
     const Symbol* res = sym_table->Find(field_name);
@@ -704,6 +747,11 @@ bool SymVarParam::IsByRef() const
     return by_ref;
 }
 
+int SymVarParam::GetOffset() const
+{
+    return offset;
+}
+
 SymbolClass SymVarParam::GetClassName() const
 {
     return SymbolClass(SYM | SYM_VAR | SYM_VAR_PARAM);
@@ -800,15 +848,40 @@ void SymVarLocal::SetOffset(unsigned offset_)
 
 //---SymTable---
 
+const unsigned SYM_TABLE_INIT_SIZE = 16;
+
 SymTable::SymTable():
+    table(SYM_TABLE_INIT_SIZE, (Symbol*)NULL),
     params_size(0),
     locals_size(0)
 {
 }
 
+unsigned SymTable::FindSlot(unsigned id) const
+{
+    unsigned mask = table.size() - 1;
+    unsigned i = (id * 2654435761u) & mask;
+    while (table[i] != NULL && table[i]->GetId() != id) i = (i + 1) & mask;
+    return i;
+}
+
+void SymTable::Grow()
+{
+    std::vector<Symbol*> old(table.size() * 2, (Symbol*)NULL);
+    old.swap(table);
+    for (std::vector<Symbol*>::iterator it = decl_order.begin(); it != decl_order.end(); ++it)
+        table[FindSlot((*it)->GetId())] = *it;
+}
+
 void SymTable::Add(Symbol* sym)
 {
-    table.insert(sym);
+    unsigned slot = FindSlot(sym->GetId());
+    if (table[slot] == NULL)
+    {
+        table[slot] = sym;
+        decl_order.push_back(sym);
+        if (decl_order.size() * 2 > table.size()) Grow();
+    }
     if (sym->GetClassName() & SYM_VAR)
     {
         unsigned sym_size = ((SymVar*)sym)->GetVarType()->GetSize();
@@ -823,33 +896,44 @@ void SymTable::Add(Symbol* sym)
     }
 }
 
+const Symbol* SymTable::Find(unsigned id) const
+{
+    return table[FindSlot(id)];
+}
+
 const Symbol* SymTable::Find(Symbol* sym) const
 {
-    return (table.find(sym) != table.end()) ? *table.find(sym) : NULL;
+    return Find(sym->GetId());
 }
 
 const Symbol* SymTable::Find(const Token& tok) const
 {
-    Symbol sym(tok);
-    std::set<Symbol*, SymbLessComp>::const_iterator it = table.find(&sym);
-    if (it == table.end()) return NULL;
-    return *it;
+    return Find(tok.GetId());
 }
 
-void SymTable::Print(ostream& o, int offset) const
+const std::vector<Symbol*>& SymTable::GetSymbols() const
 {
-    std::vector<Symbol*> v;
-    for (std::set<Symbol*, SymbLessComp>::iterator it = table.begin(); it != table.end(); ++it)
-        v.push_back((*it));
+    return decl_order;
+}
+
+std::vector<Symbol*> SymTable::GetSortedSymbols() const
+{
+    std::vector<Symbol*> v(decl_order);
     SymbLessComp comp;
     sort(v.begin(), v.end(), comp);
+    return v;
+}
+
+void SymTable::Print(ostream& o, int offset) const
+{
+    std::vector<Symbol*> v = GetSortedSymbols();
     for (std::vector<Symbol*>::iterator it = v.begin(); it != v.end(); ++it)
         (*it)->PrintVerbose(o, offset);
 }
 
 bool SymTable::IsEmpty() const
 {
-    return table.empty();
+    return decl_order.empty();
 }
 
 unsigned SymTable::GetSize() const
@@ -869,7 +953,7 @@ unsigned SymTable::GetParamsSize() const
 
 void SymTable::GenerateDeclarations(AsmCode& asm_code) const
 {
-    for (std::set<Symbol*, SymbLessComp>::const_iterator it = table.begin(); it != table.end(); ++it)
+    for (std::vector<Symbol*>::const_iterator it = decl_order.begin(); it != decl_order.end(); ++it)
         if ((*it)->GetClassName() & SYM_VAR_GLOBAL)
         {
             SymVarGlobal* tmp = (SymVarGlobal*)*it;
@@ -879,6 +963,12 @@ void SymTable::GenerateDeclarations(AsmCode& asm_code) const
         (*it)->GenerateDeclaration(asm_code);
 }
 
+void SymTable::PrintIR(ostream& o, bool allocate) const
+{
+    for (std::vector<SymProc*>::const_iterator it = proc_decl_order.begin(); it != proc_decl_order.end(); ++it)
+        (*it)->PrintIR(o, allocate);
+}
+
 void SymTable::Optimize()
 {
     for (std::vector<SymProc*>::const_iterator it = proc_decl_order.begin(); it != proc_decl_order.end(); ++it)
@@ -4,6 +4,7 @@
 #include <string.h>
 #include "scanner.h"
 #include "statement_base.h"
+#include "arena.h"
 #include <map>
 #include <set>
 #include <vector>
@@ -39,13 +40,14 @@ extern SymType* top_type_real;
 extern SymType* top_type_untyped;
 extern SymType* top_type_str;
 
-class Symbol{
+class Symbol: public ArenaObject{
 protected:
     Token token;
 public:
     Symbol(Token token_);
     Symbol(const Symbol& sym);
     const char* GetName() const;
+    unsigned GetId() const;
     Token GetToken() const;
     virtual SymbolClass GetClassName() const;
     virtual void PrintVerbose(ostream& o, int offset) const;
@@ -66,9 +68,10 @@ public:
 class SymProc: public Symbol{
 protected:
     bool have_side_effect;
-    bool known_side_effect;
-    bool searching;
+    bool can_be_replaced;
     bool dummy_proc;
+    VarsContainer affected;
+    VarsContainer dependences;
     vector<SymVarParam*> params;
     SymTable* sym_table;
     NodeStatement* body;
@@ -89,6 +92,7 @@ public:
     NodeStatement* GetBody() const;
     void AddBody(NodeStatement* body_);
     void GenerateDeclaration(AsmCode& asm_code);
+    void PrintIR(ostream& o, bool allocate = false);
     AsmStrImmediate GetLabel() const;
     AsmStrImmediate GetExitLabel() const;
     void ObtainLabels(AsmCode& asm_code);
@@ -99,6 +103,9 @@ public:
     bool IsDependOnVar(SymVar* var);
     void GetAllAffectedVars(VarsContainer& res_cont);
     void GetAllDependences(VarsContainer& res_cont);
+    void GetAllCalls(ProcsContainer& res_cont);
+    void ClearSummary();
+    bool UpdateSummary();
     void Optimize();
     virtual bool IsDummyProc();
     virtual SymbolClass GetClassName() const;
@@ -114,7 +121,7 @@ protected:
 public:
     SymFunct(Token token_, SymTable* syn_table, const SymType* result_type_);
     SymFunct(Token name);
-    void AddResultType(const SymType* result_type_);
+    void AddResultType(const SymType* result_type_, unsigned params_offset);
     virtual SymbolClass GetClassName() const;
     virtual const SymType* GetResultType() const;
     virtual void Print(ostream& o, int offset = 0) const;
@@ -122,10 +129,14 @@ public:
 };
 
 class SymVar: public Symbol{
+private:
+    static unsigned vars_count;
 protected:
     const SymType* type;
+    unsigned index;
 public:
     SymVar(Token token, const SymType* type_);
+    unsigned GetIndex() const;
     virtual SymbolClass GetClassName() const;
     virtual void Print(ostream& o, int ofefset = 0) const;
     virtual void PrintVerbose(ostream& o, int offset) const;
@@ -184,6 +195,7 @@ private:
     SymTable* sym_table;
 public:
     SymTypeRecord(SymTable* sym_table_);
+    ~SymTypeRecord();
     const SymVarLocal* FindField(Token& field_name);
     virtual SymbolClass GetClassName() const;
     virtual void Print(ostream& o, int offset = 0) const;
@@ -237,6 +249,7 @@ protected:
 public:
     SymVarParam(Token name, const SymType* type, bool by_ref_, int offset_);
     bool IsByRef() const;
+    int GetOffset() const;
     virtual SymbolClass GetClassName() const;
     virtual void GenerateLValue(AsmCode& asm_code) const;
     virtual void GenerateValue(AsmCode& asm_code) const;
@@ -277,21 +290,28 @@ private:
             return strcmp(a->GetName(), b->GetName()) < 0;
         }
     };
-    std::set<Symbol*, SymbLessComp> table;
+    std::vector<Symbol*> table;
+    std::vector<Symbol*> decl_order;
+    std::vector<Symbol*> GetSortedSymbols() const;
+    unsigned FindSlot(unsigned id) const;
+    void Grow();
     std::vector<SymProc*> proc_decl_order;
     unsigned params_size;
     unsigned locals_size;
 public:
     SymTable();
     void Add(Symbol* sym);
+    const Symbol* Find(unsigned id) const;
     const Symbol* Find(Symbol* sym) const;
     const Symbol* Find(const Token& tok) const;
+    const std::vector<Symbol*>& GetSymbols() const;
     void Print(ostream& o, int offset = 0) const;
     bool IsEmpty() const;
     unsigned GetSize() const;
     unsigned GetLocalsSize() const;
     unsigned GetParamsSize() const;
     void GenerateDeclarations(AsmCode& asm_code) const;
+    void PrintIR(ostream& o, bool allocate = false) const;
     void Optimize();
 };
 
@@ -1,4 +1,8 @@
 #include "syntax_node.h"
+#include "encoder.h"
+#include "inliner.h"
+#include "hoister.h"
+#include <sstream>
 
 static void Error(string msg, Token token)
 {
@@ -20,6 +24,7 @@ void NodeCallBase::PrintArgs(ostream& o, int offset) const
 void NodeCallBase::AddArg(SyntaxNode* arg)
 {
     args.push_back(arg);
+    ResetCache();
 }
 
 void NodeCallBase::Optimize()
@@ -28,6 +33,34 @@ void NodeCallBase::Optimize()
     {
         (*it)->TryToBecomeConst(*it);
     }
+    ResetCache();
+}
+
+void NodeCallBase::GetAllCalls(ProcsContainer& res_cont)
+{
+    for (std::vector<SyntaxNode*>::iterator it = args.begin(); it != args.end(); ++it)
+        (*it)->GetAllCalls(res_cont);
+}
+
+unsigned NodeCallBase::GetCost()
+{
+    unsigned res = INLINE_CALL_COST;
+    for (std::vector<SyntaxNode*>::iterator it = args.begin(); it != args.end(); ++it)
+        res += (*it)->GetCost();
+    return res;
+}
+
+void NodeCallBase::InlineNestedCalls(Inliner& inliner, SyntaxNode*& link)
+{
+    for (std::vector<SyntaxNode*>::iterator it = args.begin(); it != args.end(); ++it)
+        (*it)->InlineNestedCalls(inliner, *it);
+}
+
+void NodeCallBase::HoistExpressions(Hoister& hoister)
+{
+    for (std::vector<SyntaxNode*>::iterator it = args.begin(); it != args.end(); ++it)
+        hoister.Hoist(*it);
+    ResetCache();
 }
 
 //---NodeCall---
@@ -75,26 +108,60 @@ void NodeCall::GenerateValue(AsmCode& asm_code) const
     asm_code.AddCmd(ASM_CALL, AsmMemory(funct->GetLabel()));
 }
 
+int NodeCall::GenerateIRValue(IRBuilder& ir) const
+{
+    if (funct->IsDummyProc()) return IR_NO_TEMP;
+    if (funct->GetResultType()->GetSize())
+        ir.Reserve(funct->GetResultType()->GetSize());
+    for (int i = args.size() - 1 ; 0 <= i ; --i)
+        if (funct->GetArg(i)->IsByRef())
+            ir.Arg(args[i]->GenerateIRLValue(ir));
+        else if (args[i]->GetSymType()->GetSize() == 4)
+            ir.Arg(args[i]->GenerateIRValue(ir));
+        else
+            ir.StackArg(args[i]);
+    return ir.Call(funct, IRTypeOf(funct->GetResultType()));
+}
+
+int NodeCall::GenerateBCValue(BCBuilder& bc) const
+{
+    if (funct->IsDummyProc()) return BC_NO_REG;
+    std::vector<int> values(args.size());
+    for (int i = args.size() - 1 ; 0 <= i ; --i)
+    {
+        if (funct->GetArg(i)->IsByRef())
+        {
+            values[i] = args[i]->GenerateBCLValue(bc);
+            continue;
+        }
+        values[i] = args[i]->GenerateBCValue(bc);
+        for (int j = 0; j < i && !bc.IsTemp(values[i]); ++j)
+            if (args[j]->IsHaveSideEffect())
+                values[i] = bc.Snapshot(values[i], args[i]->GetSymType()->GetSize());
+    }
+    return bc.Call(funct, values);
+}
+
 bool NodeCall::IsHaveSideEffect()
 {
     for (int i = 0; i < args.size(); ++i)
     {
-        if (funct->IsAffectToParam(i)) return true;
+        if (funct->IsAffectToParam(i) || args[i]->IsHaveSideEffect()) return true;
     }
     return funct->IsHaveSideEffect();
 }
 
-void NodeCall::GetAllAffectedVars(VarsContainer& res_cont)
+void NodeCall::ComputeAffectedVars(VarsContainer& res_cont)
 {
     for (int i = 0; i < args.size(); ++i)
     {
         args[i]->GetAllAffectedVars(res_cont);
-        if (funct->IsAffectToParam(i)) res_cont.insert(args[i]->GetAffectedVar());
+        if (funct->IsAffectToParam(i)) res_cont.Insert(args[i]->GetAffectedVar());
     }
     return funct->GetAllAffectedVars(res_cont);
 }
 
-void NodeCall::GetAllDependences(VarsContainer& res_cont, bool with_self)
+void NodeCall::ComputeDependences(VarsContainer& res_cont, bool with_self)
 {
     for (int i = 0; i < args.size(); ++i)
     {
@@ -103,7 +170,13 @@ void NodeCall::GetAllDependences(VarsContainer& res_cont, bool with_self)
     funct->GetAllDependences(res_cont);
 }
 
-bool NodeCall::CanBeReplaced()
+void NodeCall::GetAllCalls(ProcsContainer& res_cont)
+{
+    res_cont.insert(funct);
+    NodeCallBase::GetAllCalls(res_cont);
+}
+
+bool NodeCall::ComputeCanBeReplaced()
 {
     for (int i = 0; i < args.size(); ++i)
     {
@@ -112,6 +185,36 @@ bool NodeCall::CanBeReplaced()
     return funct->CanBeReplaced();
 }
 
+SyntaxNode* NodeCall::Clone(Inliner& inliner) const
+{
+    NodeCall* res = new NodeCall(funct);
+    for (std::vector<SyntaxNode*>::const_iterator it = args.begin(); it != args.end(); ++it)
+        res->AddArg((*it)->Clone(inliner));
+    return res;
+}
+
+bool NodeCall::InlineCall(Inliner& inliner, SyntaxNode* target)
+{
+    return inliner.Expand(this, funct, args, target);
+}
+
+void NodeCall::InlineNestedCalls(Inliner& inliner, SyntaxNode*& link)
+{
+    SyntaxNode* res = inliner.ExpandNested(this, funct, args);
+    if (res != NULL) link = res;
+    else NodeCallBase::InlineNestedCalls(inliner, link);
+}
+
+void NodeCall::HoistExpressions(Hoister& hoister)
+{
+    for (int i = 0; i < args.size(); ++i)
+        if (funct->GetArg(i)->IsByRef())
+            args[i]->HoistExpressions(hoister);
+        else
+            hoister.Hoist(args[i]);
+    ResetCache();
+}
+
 //---NodeWriteCall---
 
 NodeWriteCall::NodeWriteCall(bool new_line_):
@@ -141,6 +244,39 @@ void NodeWriteCall::GenerateValue(AsmCode& asm_code) const
     if (new_line) asm_code.GenWriteNewLine();
 }
 
+int NodeWriteCall::GenerateIRValue(IRBuilder& ir) const
+{
+    for (std::vector<SyntaxNode*>::const_iterator it = args.begin(); it != args.end(); ++it)
+    {
+        const SymType* type = (*it)->GetSymType();
+        if (type == top_type_int)
+            ir.Write((*it)->GenerateIRValue(ir), IR_INT);
+        else if (type == top_type_real)
+            ir.Write((*it)->GenerateIRValue(ir), IR_REAL);
+        else
+            ir.WriteStr((*it)->GenerateIRValue(ir));
+    }
+    if (new_line) ir.WriteLn();
+    return IR_NO_TEMP;
+}
+
+int NodeWriteCall::GenerateBCValue(BCBuilder& bc) const
+{
+    for (std::vector<SyntaxNode*>::const_iterator it = args.begin(); it != args.end(); ++it)
+    {
+        const SymType* type = (*it)->GetSymType();
+        int value = (*it)->GenerateBCValue(bc);
+        if (type == top_type_int)
+            bc.Emit(BC_WRITEI, value);
+        else if (type == top_type_real)
+            bc.Emit(BC_WRITEF, value);
+        else
+            bc.Emit(BC_WRITES, value);
+    }
+    if (new_line) bc.Emit(BC_WRITELN);
+    return BC_NO_REG;
+}
+
 const SymType* NodeWriteCall::GetSymType() const
 {
     return top_type_untyped;
@@ -151,23 +287,31 @@ bool NodeWriteCall::IsHaveSideEffect()
     return true;
 }
 
-void NodeWriteCall::GetAllAffectedVars(VarsContainer& res_cont)
+void NodeWriteCall::ComputeAffectedVars(VarsContainer& res_cont)
 {
     for (std::vector<SyntaxNode*>::iterator it = args.begin(); it != args.end(); ++ it)
         (*it)->GetAllAffectedVars(res_cont);
 }
 
-void NodeWriteCall::GetAllDependences(VarsContainer& res_cont, bool with_self)
+void NodeWriteCall::ComputeDependences(VarsContainer& res_cont, bool with_self)
 {
     for (std::vector<SyntaxNode*>::iterator it = args.begin(); it != args.end(); ++ it)
         (*it)->GetAllDependences(res_cont);
 }
 
-bool NodeWriteCall::CanBeReplaced()
+bool NodeWriteCall::ComputeCanBeReplaced()
 {
     return false;
 }
 
+SyntaxNode* NodeWriteCall::Clone(Inliner& inliner) const
+{
+    NodeWriteCall* res = new NodeWriteCall(new_line);
+    for (std::vector<SyntaxNode*>::const_iterator it = args.begin(); it != args.end(); ++it)
+        res->AddArg((*it)->Clone(inliner));
+    return res;
+}
+
 //---NodeBinaryOp---
 
 void NodeBinaryOp::FinGenForIntRelationalOp(AsmCode& asm_code) const
@@ -285,6 +429,11 @@ void NodeBinaryOp::GenerateForInt(AsmCode& asm_code) const
 
 void NodeBinaryOp::GenerateForReal(AsmCode& asm_code) const
 {
+    if (asm_code.IsSSEEnabled())
+    {
+        GenerateForRealSSE(asm_code);
+        return;
+    }
     asm_code.AddCmd(ASM_FLD, AsmMemory(REG_ESP, 4), SIZE_SHORT);
     asm_code.AddCmd(ASM_FLD, AsmMemory(REG_ESP), SIZE_SHORT);
     asm_code.AddCmd(ASM_ADD, 4, REG_ESP);
@@ -309,11 +458,70 @@ void NodeBinaryOp::GenerateForReal(AsmCode& asm_code) const
     asm_code.AddCmd(ASM_FSTP, AsmMemory(REG_ESP), SIZE_SHORT);
 }
 
-NodeBinaryOp::NodeBinaryOp(const Token& name, SyntaxNode* left_, SyntaxNode* right_):
+void NodeBinaryOp::GenerateForRealSSE(AsmCode& asm_code) const
+{
+    asm_code.AddCmd(ASM_MOVSS, AsmMemory(REG_ESP, 4), REG_XMM0, SIZE_NONE);
+    AsmCmdName cmd;
+    switch (token.GetValue())
+    {
+        case TOK_PLUS:
+            asm_code.AddCmd(ASM_ADDSS, AsmMemory(REG_ESP), REG_XMM0, SIZE_NONE);
+        break;
+        case TOK_MINUS:
+            asm_code.AddCmd(ASM_SUBSS, AsmMemory(REG_ESP), REG_XMM0, SIZE_NONE);
+        break;
+        case TOK_MULT:
+            asm_code.AddCmd(ASM_MULSS, AsmMemory(REG_ESP), REG_XMM0, SIZE_NONE);
+        break;
+        case TOK_DIVISION:
+            asm_code.AddCmd(ASM_DIVSS, AsmMemory(REG_ESP), REG_XMM0, SIZE_NONE);
+        break;
+        default:
+            switch (token.GetValue())
+            {
+                case TOK_GREATER:
+                    cmd = ASM_SETA;
+                break;
+                case TOK_GREATER_OR_EQUAL:
+                    cmd = ASM_SETAE;
+                break;
+                case TOK_LESS:
+                    cmd = ASM_SETB;
+                break;
+                case TOK_LESS_OR_EQUAL:
+                    cmd = ASM_SETBE;
+                break;
+                case TOK_EQUAL:
+                    cmd = ASM_SETE;
+                break;
+                default:
+                    cmd = ASM_SETNE;
+            }
+            asm_code.AddCmd(ASM_UCOMISS, AsmMemory(REG_ESP), REG_XMM0, SIZE_NONE);
+            asm_code.AddCmd(cmd, REG_AL, SIZE_NONE);
+            asm_code.AddCmd(ASM_MOVZB, REG_AL, REG_EAX);
+            asm_code.AddCmd(ASM_ADD, 4, REG_ESP);
+            asm_code.AddCmd(ASM_MOV, REG_EAX, AsmMemory(REG_ESP));
+            return;
+    }
+    asm_code.AddCmd(ASM_ADD, 4, REG_ESP);
+    asm_code.AddCmd(ASM_MOVSS, REG_XMM0, AsmMemory(REG_ESP), SIZE_NONE);
+}
+
+NodeBinaryOp::NodeBinaryOp(const Token& name, SyntaxNode* left_, SyntaxNode* right_, bool short_circuit_):
     token(name),
     left(left_),
-    right(right_)
+    right(right_),
+    sym_type(name.IsRelationalOp() ? top_type_int : left_->GetSymType()),
+    short_circuit(short_circuit_)
+{
+}
+
+bool NodeBinaryOp::CanShortCircuit() const
 {
+    if (token.GetValue() != TOK_OR && (token.GetValue() != TOK_AND || !left->IsBoolean() || !right->IsBoolean()))
+        return false;
+    return short_circuit || !right->IsHaveSideEffect();
 }
 
 void NodeBinaryOp::Print(ostream& o, int offset) const
@@ -327,8 +535,7 @@ void NodeBinaryOp::Print(ostream& o, int offset) const
 
 const SymType* NodeBinaryOp::GetSymType() const
 {
-    if (token.IsRelationalOp()) return top_type_int;
-    return left->GetSymType();
+    return sym_type;
 }
 
 void NodeBinaryOp::GenerateValue(AsmCode& asm_code) const
@@ -339,6 +546,250 @@ void NodeBinaryOp::GenerateValue(AsmCode& asm_code) const
     else GenerateForReal(asm_code);
 }
 
+void NodeBinaryOp::GenerateCondJump(AsmCode& asm_code, AsmStrImmediate label, bool jump_if) const
+{
+    if (CanShortCircuit())
+    {
+        bool is_or = token.GetValue() == TOK_OR;
+        if (is_or == jump_if)
+        {
+            left->GenerateCondJump(asm_code, label, jump_if);
+            right->GenerateCondJump(asm_code, label, jump_if);
+            return;
+        }
+        AsmStrImmediate skip_label(asm_code.GenLabel(is_or ? "or_true" : "and_false"));
+        left->GenerateCondJump(asm_code, skip_label, !jump_if);
+        right->GenerateCondJump(asm_code, label, jump_if);
+        asm_code.AddLabel(skip_label);
+        return;
+    }
+    if (!token.IsRelationalOp())
+    {
+        SyntaxNode::GenerateCondJump(asm_code, label, jump_if);
+        return;
+    }
+    bool is_int = left->GetSymType() == top_type_int;
+    AsmCmdName cmd;
+    switch (token.GetValue())
+    {
+        case TOK_GREATER:
+            cmd = is_int ? (jump_if ? ASM_JG : ASM_JNG) : (jump_if ? ASM_JA : ASM_JBE);
+        break;
+        case TOK_GREATER_OR_EQUAL:
+            cmd = is_int ? (jump_if ? ASM_JNL : ASM_JL) : (jump_if ? ASM_JAE : ASM_JB);
+        break;
+        case TOK_LESS:
+            cmd = is_int ? (jump_if ? ASM_JL : ASM_JNL) : (jump_if ? ASM_JB : ASM_JAE);
+        break;
+        case TOK_LESS_OR_EQUAL:
+            cmd = is_int ? (jump_if ? ASM_JNG : ASM_JG) : (jump_if ? ASM_JBE : ASM_JA);
+        break;
+        case TOK_EQUAL:
+            cmd = jump_if ? ASM_JZ : ASM_JNE;
+        break;
+        default:
+            cmd = jump_if ? ASM_JNE : ASM_JZ;
+    }
+    left->GenerateValue(asm_code);
+    right->GenerateValue(asm_code);
+    if (is_int)
+    {
+        asm_code.AddCmd(ASM_POP, REG_EBX);
+        asm_code.AddCmd(ASM_POP, REG_EAX);
+        asm_code.AddCmd(ASM_CMP, REG_EBX, REG_EAX);
+    }
+    else if (asm_code.IsSSEEnabled())
+    {
+        asm_code.AddCmd(ASM_MOVSS, AsmMemory(REG_ESP, 4), REG_XMM0, SIZE_NONE);
+        asm_code.AddCmd(ASM_MOVSS, AsmMemory(REG_ESP), REG_XMM1, SIZE_NONE);
+        asm_code.AddCmd(ASM_ADD, 8, REG_ESP);
+        asm_code.AddCmd(ASM_UCOMISS, REG_XMM1, REG_XMM0, SIZE_NONE);
+    }
+    else
+    {
+        asm_code.AddCmd(ASM_FLD, AsmMemory(REG_ESP), SIZE_SHORT);
+        asm_code.AddCmd(ASM_FLD, AsmMemory(REG_ESP, 4), SIZE_SHORT);
+        asm_code.AddCmd(ASM_ADD, 8, REG_ESP);
+        asm_code.AddCmd(ASM_FCOMPP, SIZE_NONE);
+        asm_code.AddCmd(ASM_FNSTSW, REG_AX, SIZE_NONE);
+        asm_code.AddCmd(ASM_SAHF, SIZE_NONE);
+    }
+    asm_code.AddCmd(cmd, label, SIZE_NONE);
+}
+
+int NodeBinaryOp::GenerateIRValue(IRBuilder& ir) const
+{
+    IROpcode op;
+    switch (token.GetValue())
+    {
+        case TOK_PLUS:
+            op = IR_ADD;
+        break;
+        case TOK_MINUS:
+            op = IR_SUB;
+        break;
+        case TOK_MULT:
+            op = IR_MUL;
+        break;
+        case TOK_DIV:
+        case TOK_DIVISION:
+            op = IR_DIV;
+        break;
+        case TOK_MOD:
+            op = IR_MOD;
+        break;
+        case TOK_AND:
+            op = IR_AND;
+        break;
+        case TOK_OR:
+            op = IR_OR;
+        break;
+        case TOK_XOR:
+            op = IR_XOR;
+        break;
+        case TOK_SHL:
+            op = IR_SHL;
+        break;
+        case TOK_SHR:
+            op = IR_SHR;
+        break;
+        case TOK_EQUAL:
+            op = IR_EQ;
+        break;
+        case TOK_NOT_EQUAL:
+            op = IR_NE;
+        break;
+        case TOK_LESS:
+            op = IR_LT;
+        break;
+        case TOK_LESS_OR_EQUAL:
+            op = IR_LE;
+        break;
+        case TOK_GREATER:
+            op = IR_GT;
+        break;
+        case TOK_GREATER_OR_EQUAL:
+            op = IR_GE;
+        break;
+        default:
+            return SyntaxNode::GenerateIRValue(ir);
+    }
+    int l = left->GenerateIRValue(ir);
+    int r = right->GenerateIRValue(ir);
+    return ir.Binary(op, left->GetSymType() == top_type_int ? IR_INT : IR_REAL, l, r);
+}
+
+void NodeBinaryOp::GenerateIRCondJump(IRBuilder& ir, IRBlock* on_true, IRBlock* on_false) const
+{
+    if (!CanShortCircuit())
+    {
+        SyntaxNode::GenerateIRCondJump(ir, on_true, on_false);
+        return;
+    }
+    IRBlock* right_block = ir.NewBlock();
+    if (token.GetValue() == TOK_OR)
+        left->GenerateIRCondJump(ir, on_true, right_block);
+    else
+        left->GenerateIRCondJump(ir, right_block, on_false);
+    ir.SetBlock(right_block);
+    right->GenerateIRCondJump(ir, on_true, on_false);
+}
+
+int NodeBinaryOp::GenerateBCValue(BCBuilder& bc) const
+{
+    bool is_int = left->GetSymType() == top_type_int;
+    BCOpcode op;
+    switch (token.GetValue())
+    {
+        case TOK_PLUS:
+            op = is_int ? BC_ADD : BC_FADD;
+        break;
+        case TOK_MINUS:
+            op = is_int ? BC_SUB : BC_FSUB;
+        break;
+        case TOK_MULT:
+            op = is_int ? BC_MUL : BC_FMUL;
+        break;
+        case TOK_DIV:
+        case TOK_DIVISION:
+            op = is_int ? BC_DIV : BC_FDIV;
+        break;
+        case TOK_MOD:
+            op = BC_MOD;
+        break;
+        case TOK_AND:
+            op = BC_AND;
+        break;
+        case TOK_OR:
+            op = BC_OR;
+        break;
+        case TOK_XOR:
+            op = BC_XOR;
+        break;
+        case TOK_SHL:
+            op = BC_SHL;
+        break;
+        case TOK_SHR:
+            op = BC_SHR;
+        break;
+        case TOK_EQUAL:
+            op = is_int ? BC_EQ : BC_FEQ;
+        break;
+        case TOK_NOT_EQUAL:
+            op = is_int ? BC_NE : BC_FNE;
+        break;
+        case TOK_LESS:
+            op = is_int ? BC_LT : BC_FLT;
+        break;
+        case TOK_LESS_OR_EQUAL:
+            op = is_int ? BC_LE : BC_FLE;
+        break;
+        case TOK_GREATER:
+            op = is_int ? BC_GT : BC_FGT;
+        break;
+        case TOK_GREATER_OR_EQUAL:
+            op = is_int ? BC_GE : BC_FGE;
+        break;
+        default:
+            return SyntaxNode::GenerateBCValue(bc);
+    }
+    int l = left->GenerateBCValue(bc);
+    if (!bc.IsTemp(l) && right->IsHaveSideEffect()) l = bc.Snapshot(l);
+    if ((op == BC_ADD || op == BC_SUB) && right->IsConst())
+    {
+        int value = right->ComputeIntConstExpr();
+        return bc.BinaryImm(BC_ADDI, l, op == BC_ADD ? value : -(unsigned)value);
+    }
+    return bc.Binary(op, l, right->GenerateBCValue(bc));
+}
+
+void NodeBinaryOp::GenerateBCCondJump(BCBuilder& bc, int label, bool jump_if) const
+{
+    if (!CanShortCircuit())
+    {
+        SyntaxNode::GenerateBCCondJump(bc, label, jump_if);
+        return;
+    }
+    bool is_or = token.GetValue() == TOK_OR;
+    if (is_or == jump_if)
+    {
+        left->GenerateBCCondJump(bc, label, jump_if);
+        right->GenerateBCCondJump(bc, label, jump_if);
+        return;
+    }
+    int skip_label = bc.NewLabel();
+    left->GenerateBCCondJump(bc, skip_label, !jump_if);
+    right->GenerateBCCondJump(bc, label, jump_if);
+    bc.BindLabel(skip_label);
+}
+
+bool NodeBinaryOp::IsBoolean() const
+{
+    if (token.IsRelationalOp()) return true;
+    TokenValue op = token.GetValue();
+    return (op == TOK_AND || op == TOK_OR || op == TOK_XOR) && left->IsBoolean() && right->IsBoolean();
+}
+
 bool NodeBinaryOp::IsConst() const
 {
     return left->IsConst() && right->IsConst();
@@ -452,6 +903,7 @@ bool NodeBinaryOp::TryToBecomeConst(SyntaxNode*& link)
 {
     left->TryToBecomeConst(left);
     right->TryToBecomeConst(right);
+    ResetCache();
     bool lc = left->IsConst();
     bool rc = right->IsConst();
     if (!lc && !rc) return false;
@@ -468,22 +920,66 @@ bool NodeBinaryOp::IsHaveSideEffect()
     return left->IsHaveSideEffect() || right->IsHaveSideEffect();
 }
 
-void NodeBinaryOp::GetAllAffectedVars(VarsContainer& res_cont)
+void NodeBinaryOp::ComputeAffectedVars(VarsContainer& res_cont)
 {
     left->GetAllAffectedVars(res_cont);
     right->GetAllAffectedVars(res_cont);
 }
 
-void NodeBinaryOp::GetAllDependences(VarsContainer& res_cont, bool with_self)
+void NodeBinaryOp::ComputeDependences(VarsContainer& res_cont, bool with_self)
 {
     left->GetAllDependences(res_cont);
     right->GetAllDependences(res_cont);
 }
 
+void NodeBinaryOp::GetAllCalls(ProcsContainer& res_cont)
+{
+    left->GetAllCalls(res_cont);
+    right->GetAllCalls(res_cont);
+}
+
 void NodeBinaryOp::Optimize()
 {
     left->Optimize();
     right->Optimize();
+    ResetCache();
+}
+
+unsigned NodeBinaryOp::GetCost()
+{
+    return 1 + left->GetCost() + right->GetCost();
+}
+
+SyntaxNode* NodeBinaryOp::Clone(Inliner& inliner) const
+{
+    return new NodeBinaryOp(token, left->Clone(inliner), right->Clone(inliner), short_circuit);
+}
+
+void NodeBinaryOp::InlineNestedCalls(Inliner& inliner, SyntaxNode*& link)
+{
+    left->InlineNestedCalls(inliner, left);
+    if (token.GetValue() != TOK_AND && token.GetValue() != TOK_OR) right->InlineNestedCalls(inliner, right);
+}
+
+void NodeBinaryOp::HoistExpressions(Hoister& hoister)
+{
+    hoister.Hoist(left);
+    bool speculative = hoister.IsSpeculative();
+    if (CanShortCircuit()) hoister.SetSpeculative(true);
+    hoister.Hoist(right);
+    hoister.SetSpeculative(speculative);
+    ResetCache();
+}
+
+bool NodeBinaryOp::CanBeHoisted(bool speculative) const
+{
+    if (token.GetValue() == TOK_DIV || token.GetValue() == TOK_MOD)
+    {
+        if (!right->IsConst()) return false;
+        int divisor = right->ComputeIntConstExpr();
+        if (divisor == 0 || divisor == -1) return false;
+    }
+    return left->CanBeHoisted(speculative) && right->CanBeHoisted(speculative);
 }
 
 //---NodeUnaryOp---
@@ -510,6 +1006,11 @@ void NodeUnaryOp::GenerateForInt(AsmCode& asm_code) const
 void NodeUnaryOp::GenerateForReal(AsmCode& asm_code) const
 {
     if (token.GetValue() != TOK_MINUS) return;
+    if (asm_code.IsSSEEnabled())
+    {
+        asm_code.AddCmd(ASM_XOR, AsmIntImmediate(0x80000000), AsmMemory(REG_ESP));
+        return;
+    }
     asm_code.AddCmd(ASM_FLD, AsmMemory(REG_ESP), SIZE_SHORT);
     asm_code.AddCmd(ASM_FCH, SIZE_SHORT);
     asm_code.AddCmd(ASM_FSTP, AsmMemory(REG_ESP), SIZE_SHORT);
@@ -541,6 +1042,24 @@ void NodeUnaryOp::GenerateValue(AsmCode& asm_code) const
     else GenerateForReal(asm_code);
 }
 
+int NodeUnaryOp::GenerateIRValue(IRBuilder& ir) const
+{
+    int res = child->GenerateIRValue(ir);
+    IRType type = GetSymType() == top_type_int ? IR_INT : IR_REAL;
+    if (token.GetValue() == TOK_MINUS) return ir.Unary(IR_NEG, type, res);
+    if (token.GetValue() == TOK_NOT && type == IR_INT) return ir.Unary(IR_NOT, type, res);
+    return res;
+}
+
+int NodeUnaryOp::GenerateBCValue(BCBuilder& bc) const
+{
+    int res = child->GenerateBCValue(bc);
+    bool is_int = GetSymType() == top_type_int;
+    if (token.GetValue() == TOK_MINUS) return bc.Unary(is_int ? BC_NEG : BC_FNEG, res);
+    if (token.GetValue() == TOK_NOT && is_int) return bc.Unary(BC_NOT, res);
+    return res;
+}
+
 bool NodeUnaryOp::IsConst() const
 {
     return child->IsConst();
@@ -573,7 +1092,7 @@ float NodeUnaryOp::ComputeRealConstExpr() const
 bool NodeUnaryOp::TryToBecomeConst(SyntaxNode*& link)
 {
     if (!child->IsConst()) return false;
-    Token tok_val(child->ComputeConstExpr());
+    Token tok_val(ComputeConstExpr());
     SymVarConst* sym = new SymVarConst(tok_val, tok_val, GetSymType());
     link = new NodeVar(sym);
     delete this;
@@ -585,19 +1104,51 @@ bool NodeUnaryOp::IsHaveSideEffect()
     return child->IsHaveSideEffect();
 }
 
-void NodeUnaryOp::GetAllAffectedVars(VarsContainer& res_cont)
+void NodeUnaryOp::ComputeAffectedVars(VarsContainer& res_cont)
 {
     return child->GetAllAffectedVars(res_cont);
 }
 
-void NodeUnaryOp::GetAllDependences(VarsContainer& res_cont, bool with_self)
+void NodeUnaryOp::ComputeDependences(VarsContainer& res_cont, bool with_self)
 {
     return child->GetAllDependences(res_cont);
 }
 
+void NodeUnaryOp::GetAllCalls(ProcsContainer& res_cont)
+{
+    child->GetAllCalls(res_cont);
+}
+
 void NodeUnaryOp::Optimize()
 {
     child->Optimize();
+    ResetCache();
+}
+
+unsigned NodeUnaryOp::GetCost()
+{
+    return 1 + child->GetCost();
+}
+
+SyntaxNode* NodeUnaryOp::Clone(Inliner& inliner) const
+{
+    return new NodeUnaryOp(token, child->Clone(inliner));
+}
+
+void NodeUnaryOp::InlineNestedCalls(Inliner& inliner, SyntaxNode*& link)
+{
+    child->InlineNestedCalls(inliner, child);
+}
+
+void NodeUnaryOp::HoistExpressions(Hoister& hoister)
+{
+    hoister.Hoist(child);
+    ResetCache();
+}
+
+bool NodeUnaryOp::CanBeHoisted(bool speculative) const
+{
+    return child->CanBeHoisted(speculative);
 }
 
 //---NodeIntToRealConv---
@@ -624,15 +1175,36 @@ const SymType* NodeIntToRealConv::GetSymType() const
 void NodeIntToRealConv::GenerateValue(AsmCode& asm_code) const
 {
     child->GenerateValue(asm_code);
+    if (asm_code.IsSSEEnabled())
+    {
+        asm_code.AddCmd(ASM_CVTSI2SS, AsmMemory(REG_ESP), REG_XMM0);
+        asm_code.AddCmd(ASM_MOVSS, REG_XMM0, AsmMemory(REG_ESP), SIZE_NONE);
+        return;
+    }
     asm_code.AddCmd(ASM_FILD, AsmMemory(REG_ESP), SIZE_SHORT);
     asm_code.AddCmd(ASM_FSTP, AsmMemory(REG_ESP), SIZE_SHORT);
 }
 
+int NodeIntToRealConv::GenerateIRValue(IRBuilder& ir) const
+{
+    return ir.Unary(IR_INT_TO_REAL, IR_INT, child->GenerateIRValue(ir));
+}
+
+int NodeIntToRealConv::GenerateBCValue(BCBuilder& bc) const
+{
+    return bc.Unary(BC_ITOF, child->GenerateBCValue(bc));
+}
+
 float NodeIntToRealConv::ComputeRealConstExpr() const
 {
     return child->ComputeRealConstExpr();
 }
 
+SyntaxNode* NodeIntToRealConv::Clone(Inliner& inliner) const
+{
+    return new NodeIntToRealConv(child->Clone(inliner), real_type);
+}
+
 //---NodeVar---
 
 NodeVar::NodeVar(SymVar* var_):
@@ -675,6 +1247,54 @@ void NodeVar::GenerateValue(AsmCode& asm_code) const
     var->GenerateValue(asm_code);
 }
 
+int NodeVar::GenerateIRLValue(IRBuilder& ir) const
+{
+    return ir.VarAddr(var);
+}
+
+int NodeVar::GenerateIRValue(IRBuilder& ir) const
+{
+    if (!(var->GetClassName() & SYM_VAR_CONST)) return ir.LoadVar(var, IRTypeOf(GetSymType()));
+    Token value = ((SymVarConst*)var)->GetValueTok();
+    if (value.GetType() == INT_CONST) return ir.Const(value.GetIntValue());
+    if (value.GetType() != REAL_CONST) return SyntaxNode::GenerateIRValue(ir);
+    float f = value.GetRealValue();
+    return ir.Const(*(int*)&f, IR_REAL);
+}
+
+void NodeVar::GenerateIRStore(IRBuilder& ir, int value) const
+{
+    ir.StoreVar(var, value);
+}
+
+int NodeVar::GenerateBCCell(BCBuilder& bc) const
+{
+    return bc.VarCell(var);
+}
+
+int NodeVar::GenerateBCLValue(BCBuilder& bc) const
+{
+    return bc.VarAddr(var);
+}
+
+int NodeVar::GenerateBCValue(BCBuilder& bc) const
+{
+    if (!(var->GetClassName() & SYM_VAR_CONST)) return bc.LoadVar(var);
+    Token value = ((SymVarConst*)var)->GetValueTok();
+    if (value.GetType() == INT_CONST) return bc.Const(value.GetIntValue());
+    if (value.GetType() != REAL_CONST) return bc.String(UnescapeAsmString(var->GetName()));
+    stringstream s;
+    s << value.GetName();
+    float f;
+    s >> f;
+    return bc.Const(*(int*)&f);
+}
+
+void NodeVar::GenerateBCStore(BCBuilder& bc, int value) const
+{
+    bc.StoreVar(var, value);
+}
+
 int NodeVar::ComputeIntConstExpr() const
 {
     return ((SymVarConst*)var)->GetValueTok().GetIntValue();
@@ -695,13 +1315,23 @@ bool NodeVar::IsHaveSideEffect()
     return false;
 }
 
-void NodeVar::GetAllAffectedVars(VarsContainer& res_cont)
+void NodeVar::ComputeAffectedVars(VarsContainer& res_cont)
+{
+}
+
+void NodeVar::ComputeDependences(VarsContainer& res_cont, bool with_self)
+{
+    if (with_self) res_cont.Insert(var);
+}
+
+SyntaxNode* NodeVar::Clone(Inliner& inliner) const
 {
+    return inliner.CloneVar(var);
 }
 
-void NodeVar::GetAllDependences(VarsContainer& res_cont, bool with_self)
+bool NodeVar::CanBeHoisted(bool speculative) const
 {
-    if (with_self) res_cont.insert(var);
+    return true;
 }
 
 //---NodeArrayAccess----
@@ -767,27 +1397,111 @@ void NodeArrayAccess::GenerateValue(AsmCode& asm_code) const
     }
 }
 
+int NodeArrayAccess::GenerateIRLValue(IRBuilder& ir) const
+{
+    int base = arr->GenerateIRLValue(ir);
+    int offset = index->GenerateIRValue(ir);
+    offset = ir.Binary(IR_SUB, IR_INT, offset, ir.Const(((SymTypeArray*)arr->GetSymType())->GetLow()));
+    offset = ir.Binary(IR_MUL, IR_INT, offset, ir.Const(GetSymType()->GetSize()));
+    return ir.Binary(IR_ADD, IR_INT, base, offset);
+}
+
+int NodeArrayAccess::GenerateIRValue(IRBuilder& ir) const
+{
+    return ir.Load(GenerateIRLValue(ir), IRTypeOf(GetSymType()));
+}
+
+int NodeArrayAccess::GenerateBCCell(BCBuilder& bc) const
+{
+    if (!index->IsConst()) return BC_NO_REG;
+    int cell = arr->GenerateBCCell(bc);
+    if (cell == BC_NO_REG) return BC_NO_REG;
+    int low = ((SymTypeArray*)arr->GetSymType())->GetLow();
+    return cell + (index->ComputeIntConstExpr() - low) * (int)GetSymType()->GetSize();
+}
+
+int NodeArrayAccess::GenerateBCLValue(BCBuilder& bc) const
+{
+    int cell = GenerateBCCell(bc);
+    if (cell != BC_NO_REG) return bc.CellAddr(cell);
+    int size = GetSymType()->GetSize();
+    int base = arr->GenerateBCLValue(bc);
+    int offset = bc.BinaryImm(BC_MULI, index->GenerateBCValue(bc), size);
+    int res = bc.Binary(BC_ADD, base, offset);
+    int low = ((SymTypeArray*)arr->GetSymType())->GetLow() * size;
+    return low ? bc.BinaryImm(BC_ADDI, res, -low) : res;
+}
+
+int NodeArrayAccess::GenerateBCValue(BCBuilder& bc) const
+{
+    int cell = GenerateBCCell(bc);
+    if (cell != BC_NO_REG) return cell;
+    return bc.Load(GenerateBCLValue(bc), 0, GetSymType()->GetSize());
+}
+
+void NodeArrayAccess::GenerateBCStore(BCBuilder& bc, int value) const
+{
+    int cell = GenerateBCCell(bc);
+    if (cell != BC_NO_REG) bc.Move(cell, value, GetSymType()->GetSize());
+    else SyntaxNode::GenerateBCStore(bc, value);
+}
+
 bool NodeArrayAccess::IsHaveSideEffect()
 {
     return index->IsHaveSideEffect();
 }
 
-void NodeArrayAccess::GetAllAffectedVars(VarsContainer& res_cont)
+void NodeArrayAccess::ComputeAffectedVars(VarsContainer& res_cont)
 {
     index->GetAllAffectedVars(res_cont);
     arr->GetAllAffectedVars(res_cont);
 }
 
-void NodeArrayAccess::GetAllDependences(VarsContainer& res_cont, bool with_self)
+void NodeArrayAccess::ComputeDependences(VarsContainer& res_cont, bool with_self)
 {
     index->GetAllDependences(res_cont);
     arr->GetAllDependences(res_cont, with_self);
 }
 
+void NodeArrayAccess::GetAllCalls(ProcsContainer& res_cont)
+{
+    index->GetAllCalls(res_cont);
+    arr->GetAllCalls(res_cont);
+}
+
 void NodeArrayAccess::Optimize()
 {
     index->Optimize();
     index->TryToBecomeConst(index);
+    ResetCache();
+}
+
+unsigned NodeArrayAccess::GetCost()
+{
+    return 1 + arr->GetCost() + index->GetCost();
+}
+
+SyntaxNode* NodeArrayAccess::Clone(Inliner& inliner) const
+{
+    return new NodeArrayAccess(arr->Clone(inliner), index->Clone(inliner));
+}
+
+void NodeArrayAccess::InlineNestedCalls(Inliner& inliner, SyntaxNode*& link)
+{
+    index->InlineNestedCalls(inliner, index);
+}
+
+void NodeArrayAccess::HoistExpressions(Hoister& hoister)
+{
+    arr->HoistExpressions(hoister);
+    hoister.Hoist(index);
+    ResetCache();
+}
+
+bool NodeArrayAccess::CanBeHoisted(bool speculative) const
+{
+    if (speculative) return false;
+    return arr->CanBeHoisted(speculative) && index->CanBeHoisted(speculative);
 }
 
 //---NodeRecordAccess---
@@ -838,16 +1552,85 @@ void NodeRecordAccess::GenerateValue(AsmCode& asm_code) const
     asm_code.PushMemory(field->GetVarType()->GetSize());
 }
 
+int NodeRecordAccess::GenerateIRLValue(IRBuilder& ir) const
+{
+    return ir.AddOffset(record->GenerateIRLValue(ir), field->GetOffset());
+}
+
+int NodeRecordAccess::GenerateIRValue(IRBuilder& ir) const
+{
+    return ir.Load(GenerateIRLValue(ir), IRTypeOf(GetSymType()));
+}
+
+int NodeRecordAccess::GenerateBCCell(BCBuilder& bc) const
+{
+    int cell = record->GenerateBCCell(bc);
+    return cell == BC_NO_REG ? BC_NO_REG : cell + (int)field->GetOffset();
+}
+
+int NodeRecordAccess::GenerateBCLValue(BCBuilder& bc) const
+{
+    int cell = GenerateBCCell(bc);
+    if (cell != BC_NO_REG) return bc.CellAddr(cell);
+    int res = record->GenerateBCLValue(bc);
+    return field->GetOffset() ? bc.BinaryImm(BC_ADDI, res, field->GetOffset()) : res;
+}
+
+int NodeRecordAccess::GenerateBCValue(BCBuilder& bc) const
+{
+    int cell = GenerateBCCell(bc);
+    if (cell != BC_NO_REG) return cell;
+    return bc.Load(record->GenerateBCLValue(bc), field->GetOffset(), GetSymType()->GetSize());
+}
+
+void NodeRecordAccess::GenerateBCStore(BCBuilder& bc, int value) const
+{
+    int cell = GenerateBCCell(bc);
+    if (cell != BC_NO_REG) bc.Move(cell, value, GetSymType()->GetSize());
+    else bc.Store(record->GenerateBCLValue(bc), field->GetOffset(), value, GetSymType()->GetSize());
+}
+
 bool NodeRecordAccess::IsHaveSideEffect()
 {
     return false;
 }
 
-void NodeRecordAccess::GetAllAffectedVars(VarsContainer& res_cont)
+void NodeRecordAccess::ComputeAffectedVars(VarsContainer& res_cont)
+{
+}
+
+void NodeRecordAccess::ComputeDependences(VarsContainer& res_cont, bool with_self)
+{
+    record->GetAllDependences(res_cont, with_self);
+}
+
+void NodeRecordAccess::GetAllCalls(ProcsContainer& res_cont)
+{
+    record->GetAllCalls(res_cont);
+}
+
+unsigned NodeRecordAccess::GetCost()
+{
+    return 1 + record->GetCost();
+}
+
+SyntaxNode* NodeRecordAccess::Clone(Inliner& inliner) const
+{
+    return new NodeRecordAccess(record->Clone(inliner), field->GetToken());
+}
+
+void NodeRecordAccess::InlineNestedCalls(Inliner& inliner, SyntaxNode*& link)
+{
+    record->InlineNestedCalls(inliner, record);
+}
+
+void NodeRecordAccess::HoistExpressions(Hoister& hoister)
 {
+    record->HoistExpressions(hoister);
+    ResetCache();
 }
 
-void NodeRecordAccess::GetAllDependences(VarsContainer& res_cont, bool with_self)
+bool NodeRecordAccess::CanBeHoisted(bool speculative) const
 {
-    if (with_self) res_cont.insert(GetAffectedVar());
+    return record->CanBeHoisted(speculative);
 }
@@ -14,6 +14,10 @@ protected:
 public:
     void AddArg(SyntaxNode* arg);
     virtual void Optimize();
+    virtual void GetAllCalls(ProcsContainer& res_cont);
+    virtual unsigned GetCost();
+    virtual void InlineNestedCalls(Inliner& inliner, SyntaxNode*& link);
+    virtual void HoistExpressions(Hoister& hoister);
 };
 
 class NodeCall: public NodeCallBase{
@@ -26,10 +30,17 @@ public:
     virtual void Print(ostream& o, int offset = 0) const;
     virtual const SymType* GetSymType() const;
     virtual void GenerateValue(AsmCode& asm_code) const;
+    virtual int GenerateIRValue(IRBuilder& ir) const;
+    virtual int GenerateBCValue(BCBuilder& bc) const;
     virtual bool IsHaveSideEffect();    
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self);
-    virtual bool CanBeReplaced();
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer& res_cont);
+    virtual bool ComputeCanBeReplaced();
+    virtual SyntaxNode* Clone(Inliner& inliner) const;
+    virtual bool InlineCall(Inliner& inliner, SyntaxNode* target);
+    virtual void InlineNestedCalls(Inliner& inliner, SyntaxNode*& link);
+    virtual void HoistExpressions(Hoister& hoister);
 };
 
 class NodeWriteCall: public NodeCallBase{
@@ -39,11 +50,14 @@ public:
     NodeWriteCall(bool new_line_ = false);
     virtual void Print(ostream& o, int offset = 0) const;
     virtual void GenerateValue(AsmCode& asm_code) const;
+    virtual int GenerateIRValue(IRBuilder& ir) const;
+    virtual int GenerateBCValue(BCBuilder& bc) const;
     virtual const SymType* GetSymType() const;
     virtual bool IsHaveSideEffect();    
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual bool CanBeReplaced();
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual bool ComputeCanBeReplaced();
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual SyntaxNode* Clone(Inliner& inliner) const;
 };
 
 class NodeBinaryOp: public SyntaxNode{
@@ -51,23 +65,39 @@ private:
     Token token;
     SyntaxNode* left;
     SyntaxNode* right;
+    const SymType* sym_type;
+    bool short_circuit;
+    bool CanShortCircuit() const;
     void FinGenForIntRelationalOp(AsmCode& asm_code) const;
     void FinGenForRealRelationalOp(AsmCode& asm_code) const;
     void GenerateForInt(AsmCode& asm_code) const;
     void GenerateForReal(AsmCode& asm_code) const;
+    void GenerateForRealSSE(AsmCode& asm_code) const;
 public:
-    NodeBinaryOp(const Token& name, SyntaxNode* left_, SyntaxNode* right_);
+    NodeBinaryOp(const Token& name, SyntaxNode* left_, SyntaxNode* right_, bool short_circuit_ = false);
     virtual void Print(ostream& o, int offset = 0) const;
     virtual const SymType* GetSymType() const;
     virtual void GenerateValue(AsmCode& asm_code) const;
+    virtual void GenerateCondJump(AsmCode& asm_code, AsmStrImmediate label, bool jump_if) const;
+    virtual int GenerateIRValue(IRBuilder& ir) const;
+    virtual void GenerateIRCondJump(IRBuilder& ir, IRBlock* on_true, IRBlock* on_false) const;
+    virtual int GenerateBCValue(BCBuilder& bc) const;
+    virtual void GenerateBCCondJump(BCBuilder& bc, int label, bool jump_if) const;
+    virtual bool IsBoolean() const;
     virtual bool IsConst() const;
     virtual int ComputeIntConstExpr() const;
     virtual float ComputeRealConstExpr() const;
     virtual bool TryToBecomeConst(SyntaxNode*& link);
     virtual bool IsHaveSideEffect();    
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer& res_cont);
     virtual void Optimize();
+    virtual unsigned GetCost();
+    virtual SyntaxNode* Clone(Inliner& inliner) const;
+    virtual void InlineNestedCalls(Inliner& inliner, SyntaxNode*& link);
+    virtual void HoistExpressions(Hoister& hoister);
+    virtual bool CanBeHoisted(bool speculative) const;
 };
 
 class NodeUnaryOp: public SyntaxNode{
@@ -81,14 +111,22 @@ public:
     virtual void Print(ostream& o, int offset = 0) const;
     virtual const SymType* GetSymType() const;
     void GenerateValue(AsmCode& asm_code) const;
+    virtual int GenerateIRValue(IRBuilder& ir) const;
+    virtual int GenerateBCValue(BCBuilder& bc) const;
     virtual bool IsConst() const;
     virtual int ComputeIntConstExpr() const;
     virtual float ComputeRealConstExpr() const;
     virtual bool TryToBecomeConst(SyntaxNode*& link);
     virtual bool IsHaveSideEffect();    
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer& res_cont);
     virtual void Optimize();
+    virtual unsigned GetCost();
+    virtual SyntaxNode* Clone(Inliner& inliner) const;
+    virtual void InlineNestedCalls(Inliner& inliner, SyntaxNode*& link);
+    virtual void HoistExpressions(Hoister& hoister);
+    virtual bool CanBeHoisted(bool speculative) const;
 };
 
 class NodeIntToRealConv: public NodeUnaryOp{
@@ -99,7 +137,10 @@ public:
     virtual void Print(ostream& o, int offset = 0) const;
     virtual const SymType* GetSymType() const;
     virtual void GenerateValue(AsmCode& asm_code) const;
+    virtual int GenerateIRValue(IRBuilder& ir) const;
+    virtual int GenerateBCValue(BCBuilder& bc) const;
     virtual float ComputeRealConstExpr() const;
+    virtual SyntaxNode* Clone(Inliner& inliner) const;
 };
 
 class NodeVar: public SyntaxNode{
@@ -114,12 +155,21 @@ public:
     virtual SymVar* GetAffectedVar() const;
     virtual void GenerateLValue(AsmCode& asm_code) const;
     virtual void GenerateValue(AsmCode& asm_code) const;
+    virtual int GenerateIRLValue(IRBuilder& ir) const;
+    virtual int GenerateIRValue(IRBuilder& ir) const;
+    virtual void GenerateIRStore(IRBuilder& ir, int value) const;
+    virtual int GenerateBCCell(BCBuilder& bc) const;
+    virtual int GenerateBCLValue(BCBuilder& bc) const;
+    virtual int GenerateBCValue(BCBuilder& bc) const;
+    virtual void GenerateBCStore(BCBuilder& bc, int value) const;
     virtual int ComputeIntConstExpr() const;
     virtual float ComputeRealConstExpr() const;
     virtual bool IsConst() const;
     virtual bool IsHaveSideEffect();    
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual SyntaxNode* Clone(Inliner& inliner) const;
+    virtual bool CanBeHoisted(bool speculative) const;
 };
 
 class NodeArrayAccess: public SyntaxNode{
@@ -135,10 +185,22 @@ public:
     virtual SymVar* GetAffectedVar() const;
     virtual void GenerateLValue(AsmCode& asm_code) const;
     virtual void GenerateValue(AsmCode& asm_code) const; 
+    virtual int GenerateIRLValue(IRBuilder& ir) const;
+    virtual int GenerateIRValue(IRBuilder& ir) const;
+    virtual int GenerateBCCell(BCBuilder& bc) const;
+    virtual int GenerateBCLValue(BCBuilder& bc) const;
+    virtual int GenerateBCValue(BCBuilder& bc) const;
+    virtual void GenerateBCStore(BCBuilder& bc, int value) const;
     virtual bool IsHaveSideEffect();    
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer& res_cont);
     virtual void Optimize();
+    virtual unsigned GetCost();
+    virtual SyntaxNode* Clone(Inliner& inliner) const;
+    virtual void InlineNestedCalls(Inliner& inliner, SyntaxNode*& link);
+    virtual void HoistExpressions(Hoister& hoister);
+    virtual bool CanBeHoisted(bool speculative) const;
 };
 
 class NodeRecordAccess: public SyntaxNode{
@@ -153,9 +215,21 @@ public:
     virtual SymVar* GetAffectedVar() const;
     virtual void GenerateLValue(AsmCode& asm_code) const;
     virtual void GenerateValue(AsmCode& asm_code) const; 
+    virtual int GenerateIRLValue(IRBuilder& ir) const;
+    virtual int GenerateIRValue(IRBuilder& ir) const;
+    virtual int GenerateBCCell(BCBuilder& bc) const;
+    virtual int GenerateBCLValue(BCBuilder& bc) const;
+    virtual int GenerateBCValue(BCBuilder& bc) const;
+    virtual void GenerateBCStore(BCBuilder& bc, int value) const;
     virtual bool IsHaveSideEffect();    
-    virtual void GetAllAffectedVars(VarsContainer& res_cont);
-    virtual void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer& res_cont);
+    virtual unsigned GetCost();
+    virtual SyntaxNode* Clone(Inliner& inliner) const;
+    virtual void InlineNestedCalls(Inliner& inliner, SyntaxNode*& link);
+    virtual void HoistExpressions(Hoister& hoister);
+    virtual bool CanBeHoisted(bool speculative) const;
 };
 
 #endif
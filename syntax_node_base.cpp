@@ -1,35 +1,118 @@
 #include "syntax_node_base.h"
+#include "sym_table.h"
+
+const unsigned WORD_BITS = sizeof(unsigned long) * 8;
+
+//---VarsContainer---
+
+void VarsContainer::Insert(const SymVar* var)
+{
+    unsigned word = var->GetIndex() / WORD_BITS;
+    if (words.size() <= word) words.resize(word + 1, 0);
+    words[word] |= 1UL << var->GetIndex() % WORD_BITS;
+}
+
+void VarsContainer::Insert(const VarsContainer& src)
+{
+    if (words.size() < src.words.size()) words.resize(src.words.size(), 0);
+    for (unsigned i = 0; i < src.words.size(); ++i)
+        words[i] |= src.words[i];
+}
+
+bool VarsContainer::IsContain(const SymVar* var) const
+{
+    unsigned word = var->GetIndex() / WORD_BITS;
+    return word < words.size() && (words[word] >> var->GetIndex() % WORD_BITS & 1);
+}
+
+bool VarsContainer::IsIntersect(const VarsContainer& src) const
+{
+    unsigned size = std::min(words.size(), src.words.size());
+    for (unsigned i = 0; i < size; ++i)
+        if (words[i] & src.words[i]) return true;
+    return false;
+}
+
+bool VarsContainer::IsEmpty() const
+{
+    for (unsigned i = 0; i < words.size(); ++i)
+        if (words[i]) return false;
+    return true;
+}
+
+unsigned VarsContainer::GetSize() const
+{
+    unsigned res = 0;
+    for (unsigned i = 0; i < words.size(); ++i)
+        res += __builtin_popcountl(words[i]);
+    return res;
+}
+
+void VarsContainer::Clear()
+{
+    words.clear();
+}
+
+void VarsContainer::Swap(VarsContainer& src)
+{
+    words.swap(src.words);
+}
 
 //---SyntaxNodeBase---
 
+unsigned SyntaxNodeBase::cache_epoch = 1;
+
+SyntaxNodeBase::SyntaxNodeBase():
+    cached_epoch(0),
+    can_be_replaced_cache(true)
+{
+}
+
+void SyntaxNodeBase::UpdateCache()
+{
+    if (cached_epoch == cache_epoch) return;
+    affected_cache.Clear();
+    dependences_cache.Clear();
+    ComputeAffectedVars(affected_cache);
+    ComputeDependences(dependences_cache, true);
+    can_be_replaced_cache = ComputeCanBeReplaced();
+    cached_epoch = cache_epoch;
+}
+
+void SyntaxNodeBase::ResetCache()
+{
+    cached_epoch = 0;
+}
+
+void SyntaxNodeBase::ResetAllCaches()
+{
+    ++cache_epoch;
+}
+
 void SyntaxNodeBase::Optimize()
 {
 }
 
+void SyntaxNodeBase::HoistExpressions(Hoister& hoister)
+{
+}
 
-bool SyntaxNodeBase::IsDependOnVars(std::set<SymVar*>& vars)
+bool SyntaxNodeBase::IsDependOnVars(const VarsContainer& vars)
 {
-    std::set<SymVar*> t;
-    GetAllDependences(t);
-    for (set<SymVar*>::iterator it = vars.begin(); it != vars.end(); ++it)
-        if (t.find(*it) != t.end()) return true;
-    return false;
+    UpdateCache();
+    return dependences_cache.IsIntersect(vars);
 }
 
-bool SyntaxNodeBase::IsAffectToVars(std::set<SymVar*>& vars)
+bool SyntaxNodeBase::IsAffectToVars(const VarsContainer& vars)
 {
-    std::set<SymVar*> t;
-    GetAllAffectedVars(t);
-    for (set<SymVar*>::iterator it = vars.begin(); it != vars.end(); ++it)
-        if (t.find(*it) != t.end()) return true;
-    return false;
+    UpdateCache();
+    return affected_cache.IsIntersect(vars);
 }
 
 bool SyntaxNodeBase::IsAffectToVars()
 {
-    std::set<SymVar*> t;
-    GetAllAffectedVars(t);
-    return !t.empty();
+    UpdateCache();
+    return !affected_cache.IsEmpty();
 }
 
 void SyntaxNodeBase::Print(ostream& o, int offset) const
@@ -43,27 +126,52 @@ bool SyntaxNodeBase::IsHaveSideEffect()
 
 bool SyntaxNodeBase::IsDependOnVar(SymVar* var)
 {
-    std::set<SymVar*> t;
-    GetAllDependences(t);
-    return (t.find(var) != t.end());
+    UpdateCache();
+    return dependences_cache.IsContain(var);
 }
 
 bool SyntaxNodeBase::IsAffectToVar(SymVar* var)
 {
-    std::set<SymVar*> t;
-    GetAllAffectedVars(t);
-    return (t.find(var) != t.end());
+    UpdateCache();
+    return affected_cache.IsContain(var);
 }
 
-void SyntaxNodeBase::GetAllAffectedVars(VarsContainer&)
+void SyntaxNodeBase::GetAllAffectedVars(VarsContainer& res_cont)
 {
+    UpdateCache();
+    res_cont.Insert(affected_cache);
 }
 
-void SyntaxNodeBase::GetAllDependences(VarsContainer&, bool with_self)
+void SyntaxNodeBase::GetAllDependences(VarsContainer& res_cont, bool with_self)
+{
+    if (!with_self)
+    {
+        ComputeDependences(res_cont, false);
+        return;
+    }
+    UpdateCache();
+    res_cont.Insert(dependences_cache);
+}
+
+void SyntaxNodeBase::ComputeAffectedVars(VarsContainer&)
+{
+}
+
+void SyntaxNodeBase::ComputeDependences(VarsContainer&, bool with_self)
+{
+}
+
+void SyntaxNodeBase::GetAllCalls(ProcsContainer&)
 {
 }
 
 bool SyntaxNodeBase::CanBeReplaced()
+{
+    UpdateCache();
+    return can_be_replaced_cache;
+}
+
+bool SyntaxNodeBase::ComputeCanBeReplaced()
 {
     return true;
 }
@@ -73,6 +181,11 @@ bool SyntaxNodeBase:: ContainJump()
     return false;
 }
 
+unsigned SyntaxNodeBase::GetCost()
+{
+    return 1;
+}
+
 //---SyntaxNode---
 
 const SymType* SyntaxNode::GetSymType() const
@@ -98,6 +211,64 @@ void SyntaxNode::GenerateValue(AsmCode& asm_code) const
 {
 }
 
+void SyntaxNode::GenerateCondJump(AsmCode& asm_code, AsmStrImmediate label, bool jump_if) const
+{
+    GenerateValue(asm_code);
+    asm_code.AddCmd(ASM_POP, REG_EAX);
+    asm_code.AddCmd(ASM_TEST, REG_EAX, REG_EAX);
+    asm_code.AddCmd(jump_if ? ASM_JNZ : ASM_JZ, label, SIZE_NONE);
+}
+
+int SyntaxNode::GenerateIRLValue(IRBuilder& ir) const
+{
+    return IR_NO_TEMP;
+}
+
+int SyntaxNode::GenerateIRValue(IRBuilder& ir) const
+{
+    return ir.StackValue(this, GetSymType() == top_type_real ? IR_REAL : IR_INT);
+}
+
+void SyntaxNode::GenerateIRStore(IRBuilder& ir, int value) const
+{
+    ir.Store(GenerateIRLValue(ir), value);
+}
+
+void SyntaxNode::GenerateIRCondJump(IRBuilder& ir, IRBlock* on_true, IRBlock* on_false) const
+{
+    ir.Branch(GenerateIRValue(ir), on_true, on_false);
+}
+
+int SyntaxNode::GenerateBCCell(BCBuilder& bc) const
+{
+    return BC_NO_REG;
+}
+
+int SyntaxNode::GenerateBCLValue(BCBuilder& bc) const
+{
+    return BC_NO_REG;
+}
+
+int SyntaxNode::GenerateBCValue(BCBuilder& bc) const
+{
+    return BC_NO_REG;
+}
+
+void SyntaxNode::GenerateBCStore(BCBuilder& bc, int value) const
+{
+    bc.Store(GenerateBCLValue(bc), 0, value, GetSymType()->GetSize());
+}
+
+void SyntaxNode::GenerateBCCondJump(BCBuilder& bc, int label, bool jump_if) const
+{
+    bc.Branch(jump_if ? BC_JNZ : BC_JZ, GenerateBCValue(bc), 0, label);
+}
+
+bool SyntaxNode::IsBoolean() const
+{
+    return false;
+}
+
 bool SyntaxNode::IsConst() const
 {
     return false;
@@ -123,6 +294,25 @@ bool SyntaxNode::TryToBecomeConst(SyntaxNode*& link)
 {
     return false;
 }
+
+SyntaxNode* SyntaxNode::Clone(Inliner& inliner) const
+{
+    return NULL;
+}
+
+bool SyntaxNode::InlineCall(Inliner& inliner, SyntaxNode* target)
+{
+    return false;
+}
+
+void SyntaxNode::InlineNestedCalls(Inliner& inliner, SyntaxNode*& link)
+{
+}
+
+bool SyntaxNode::CanBeHoisted(bool speculative) const
+{
+    return false;
+}
     
 
 
@@ -3,35 +3,73 @@
 
 #include "scanner.h"
 #include "generator.h"
+#include "ir.h"
+#include "bytecode.h"
+#include "arena.h"
 #include <ostream>
 #include <set>
+#include <vector>
 
 class SymType;
 class SymVar;
+class SymProc;
+class Inliner;
+class Hoister;
 
 extern SymType* top_type_int;
 extern SymType* top_type_real;
 extern SymType* top_type_untyped;
 extern SymType* top_type_str;
 
-typedef std::set<SymVar*> VarsContainer;
+class VarsContainer{
+private:
+    std::vector<unsigned long> words;
+public:
+    void Insert(const SymVar* var);
+    void Insert(const VarsContainer& src);
+    bool IsContain(const SymVar* var) const;
+    bool IsIntersect(const VarsContainer& src) const;
+    bool IsEmpty() const;
+    unsigned GetSize() const;
+    void Clear();
+    void Swap(VarsContainer& src);
+};
+
 typedef std::map<SymVar*, std::set<SymVar*> > DependencyGraph;
 typedef std::set<SymVar*> DependedVerts;
+typedef std::set<SymProc*> ProcsContainer;
 
-class SyntaxNodeBase{
+class SyntaxNodeBase: public ArenaObject{
+private:
+    static unsigned cache_epoch;
+    unsigned cached_epoch;
+    VarsContainer affected_cache;
+    VarsContainer dependences_cache;
+    bool can_be_replaced_cache;
+    void UpdateCache();
+protected:
+    void ResetCache();
 public:
-    bool IsDependOnVars(std::set<SymVar*>& vars);
-    bool IsAffectToVars(std::set<SymVar*>& vars);
+    SyntaxNodeBase();
+    static void ResetAllCaches();
+    bool IsDependOnVars(const VarsContainer& vars);
+    bool IsAffectToVars(const VarsContainer& vars);
     bool IsAffectToVars();
     bool IsAffectToVar(SymVar* var);
     bool IsDependOnVar(SymVar* var);    
     virtual bool IsHaveSideEffect();    
     virtual void Print(ostream& o, int offset = 0) const;
-    virtual void GetAllAffectedVars(VarsContainer&);
-    virtual void GetAllDependences(VarsContainer&, bool with_self = true);
-    virtual bool CanBeReplaced();
+    void GetAllAffectedVars(VarsContainer& res_cont);
+    void GetAllDependences(VarsContainer& res_cont, bool with_self = true);
+    virtual void ComputeAffectedVars(VarsContainer& res_cont);
+    virtual void ComputeDependences(VarsContainer& res_cont, bool with_self);
+    virtual void GetAllCalls(ProcsContainer&);
+    bool CanBeReplaced();
+    virtual bool ComputeCanBeReplaced();
     virtual bool ContainJump();
+    virtual unsigned GetCost();
     virtual void Optimize();
+    virtual void HoistExpressions(Hoister& hoister);
 };
 
 class SyntaxNode: public SyntaxNodeBase{
@@ -41,11 +79,26 @@ public:
     virtual SymVar* GetAffectedVar() const;
     virtual void GenerateLValue(AsmCode& asm_code) const;    
     virtual void GenerateValue(AsmCode& asm_code) const;
+    virtual void GenerateCondJump(AsmCode& asm_code, AsmStrImmediate label, bool jump_if) const;
+    virtual int GenerateIRLValue(IRBuilder& ir) const;
+    virtual int GenerateIRValue(IRBuilder& ir) const;
+    virtual void GenerateIRStore(IRBuilder& ir, int value) const;
+    virtual void GenerateIRCondJump(IRBuilder& ir, IRBlock* on_true, IRBlock* on_false) const;
+    virtual int GenerateBCCell(BCBuilder& bc) const;
+    virtual int GenerateBCLValue(BCBuilder& bc) const;
+    virtual int GenerateBCValue(BCBuilder& bc) const;
+    virtual void GenerateBCStore(BCBuilder& bc, int value) const;
+    virtual void GenerateBCCondJump(BCBuilder& bc, int label, bool jump_if) const;
+    virtual bool IsBoolean() const;
     virtual bool IsConst() const;
     virtual Token ComputeConstExpr() const;
     virtual int ComputeIntConstExpr() const;
     virtual float ComputeRealConstExpr() const;
     virtual bool TryToBecomeConst(SyntaxNode*& link);
+    virtual SyntaxNode* Clone(Inliner& inliner) const;
+    virtual bool InlineCall(Inliner& inliner, SyntaxNode* target);
+    virtual void InlineNestedCalls(Inliner& inliner, SyntaxNode*& link);
+    virtual bool CanBeHoisted(bool speculative) const;
 };
 
 #endif
@@ -0,0 +1,24 @@
+#!/bin/sh
+
+num=0
+fail=""
+for file in *.in
+do
+    num=$((num+1));
+    i=${file%%.in}
+    tmp=""
+    for opt in v V
+    do
+        ../debug -$opt $i.in > $i.res 2> $i.res
+        tmp="$tmp$(diff -q -b $i.out $i.res)"
+    done
+    if [ -z $1 ] && [ "$1" != "n" ]; then echo "$i: $tmp"; fi
+    if [ -n "$tmp" ]; then fail="$fail $i"; fi
+done
+echo "Number of tests: $num"
+if [ -z  "$fail" ]
+then
+    echo "Ok";
+else
+    echo "Failed: $fail"
+fi
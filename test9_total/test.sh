@@ -1,31 +1,51 @@
 #!/bin/sh
 
-num=0
-fail=""
-for file in *.in
+# usage: sh test.sh [-n] [modes]
+# every program is compiled in each of the modes (by default all of them):
+#   g - 32 bit GNU assembler, x - 64 bit GNU assembler, e - ELF64 object file,
+#   j - jit, v - bytecode virtual machine
+
+modes=${2:-"g x e j v"}
+for mode in $modes
 do
-    num=$((num+1));
-    i=${file%%.in}
-    ../debug -g $i.in > $i.s
-    if [ "$?" -eq "0" ]
-    then
-        gcc -m32 $i.s -o a 2> $i.res
-        if [ -e a ]
+    num=0
+    fail=""
+    for file in *.in
+    do
+        num=$((num+1));
+        i=${file%%.in}
+        case $mode in
+            g) gcc_flags="-m32"; ext="s";;
+            x) gcc_flags="-no-pie"; ext="s";;
+            e) gcc_flags="-no-pie"; ext="o";;
+            *) ext="";;
+        esac
+        if [ -z "$ext" ]
         then
-                ./a > $i.res 2> $i.res
-                rm a
+            ../debug -$mode $i.in > $i.res 2> $i.res
+        else
+            ../debug -$mode $i.in > $i.$ext
+            if [ "$?" -eq "0" ]
+            then
+                gcc $gcc_flags $i.$ext -o a 2> $i.res
+                if [ -e a ]
+                then
+                        ./a > $i.res 2> $i.res
+                        rm a
+                fi
+            else
+                cp $i.$ext $i.res
+            fi
         fi
+        tmp=$(diff -q -b $i.out $i.res)
+        if [ -z $1 ] && [ "$1" != "n" ]; then echo "-$mode $i: $tmp"; fi
+        if [ -n "$tmp" ]; then fail="$fail $i"; fi
+    done
+    echo "-$mode: Number of tests: $num"
+    if [ -z  "$fail" ]
+    then
+        echo "Ok";
     else
-        cp $i.s $i.res
+        echo "Failed: $fail"
     fi
-    tmp=$(diff -q -b $i.out $i.res)
-    if [ -z $1 ] && [ "$1" != "n" ]; then echo "$i: $tmp"; fi
-    if [ -n "$tmp" ]; then fail="$fail $i"; fi
 done
-echo "Number of tests: $num"
-if [ -z  "$fail" ]
-then
-    echo "Ok";
-else
-    echo "Failed: $fail"
-fi
@@ -0,0 +1,303 @@
+#include "vm.h"
+#include "exception.h"
+#include <stdio.h>
+#include <string.h>
+
+static const unsigned VM_STACK_SIZE = 8 * 1024 * 1024;
+
+union VMCell{
+    int i;
+    float f;
+};
+
+#define CELL(base, offset) (*(VMCell*)((base) + (offset)))
+#define REG(offset) CELL(fp, offset)
+
+#ifdef __GNUC__
+#define VM_OP(name) L_##name:
+#define VM_DISPATCH() goto *pc->handler
+#else
+#define VM_OP(name) case name:
+#define VM_DISPATCH() goto dispatch
+#endif
+#define VM_NEXT() ++pc; VM_DISPATCH()
+#define VM_JUMP(target) pc = &code[0] + (target); VM_DISPATCH()
+
+static int Divide(int a, int b, bool remainder)
+{
+    if (b == 0) throw CompilerException("division by zero");
+    long long dividend = (unsigned)a;
+    long long quotient = dividend / b;
+    if (quotient != (int)quotient) throw CompilerException("division overflow");
+    return remainder ? (int)(dividend % b) : (int)quotient;
+}
+
+//---VirtualMachine---
+
+VirtualMachine::VirtualMachine(const BCProgram& program_):
+    program(program_)
+{
+}
+
+unsigned char* VirtualMachine::Address(int addr, unsigned size)
+{
+    if (addr < 0 || (unsigned)addr > memory.size() - size)
+        throw CompilerException("invalid memory access");
+    return &memory[0] + addr;
+}
+
+void VirtualMachine::Load(const void* const* handlers)
+{
+    unsigned stack_base = program.globals_size + program.main_temps_size;
+    unsigned strings_base = stack_base + VM_STACK_SIZE;
+    memory.assign(strings_base + program.strings.size(), 0);
+    memcpy(&memory[0] + strings_base, program.strings.data(), program.strings.size());
+    code.resize(program.code.size());
+    for (unsigned i = 0; i < program.code.size(); ++i)
+    {
+        const BCInstr& src = program.code[i];
+        Instr& dst = code[i];
+        dst.handler = handlers != NULL ? handlers[src.op] : NULL;
+        dst.op = src.op;
+        dst.a = src.a;
+        dst.b = src.b;
+        dst.c = src.c;
+        if (src.op == BC_LDS)
+        {
+            dst.handler = handlers != NULL ? handlers[BC_LDI] : NULL;
+            dst.op = BC_LDI;
+            dst.b = strings_base + src.b;
+        }
+        else if (src.op == BC_CALL)
+        {
+            const BCFunction& func = program.functions[src.a];
+            dst.a = func.entry;
+            dst.b = func.args_size;
+            dst.c = func.frame_size;
+        }
+    }
+}
+
+void VirtualMachine::Run()
+{
+#ifdef __GNUC__
+    static const void* const HANDLERS[] = {
+        &&L_BC_MOV, &&L_BC_LDI, &&L_BC_LDS, &&L_BC_LDG, &&L_BC_STG, &&L_BC_LEA,
+        &&L_BC_LOAD, &&L_BC_STORE, &&L_BC_BMOV, &&L_BC_BLOAD, &&L_BC_BSTORE,
+        &&L_BC_ADD, &&L_BC_ADDI, &&L_BC_SUB, &&L_BC_MUL, &&L_BC_MULI, &&L_BC_DIV, &&L_BC_MOD,
+        &&L_BC_AND, &&L_BC_OR, &&L_BC_XOR, &&L_BC_SHL, &&L_BC_SHR,
+        &&L_BC_EQ, &&L_BC_NE, &&L_BC_LT, &&L_BC_LE, &&L_BC_GT, &&L_BC_GE, &&L_BC_NEG, &&L_BC_NOT,
+        &&L_BC_FADD, &&L_BC_FSUB, &&L_BC_FMUL, &&L_BC_FDIV,
+        &&L_BC_FEQ, &&L_BC_FNE, &&L_BC_FLT, &&L_BC_FLE, &&L_BC_FGT, &&L_BC_FGE, &&L_BC_FNEG, &&L_BC_ITOF,
+        &&L_BC_JMP, &&L_BC_JZ, &&L_BC_JNZ, &&L_BC_JLE, &&L_BC_JGE,
+        &&L_BC_ARG, &&L_BC_BARG, &&L_BC_CALL, &&L_BC_RES, &&L_BC_BRES, &&L_BC_RET,
+        &&L_BC_WRITEI, &&L_BC_WRITEF, &&L_BC_WRITES, &&L_BC_WRITELN
+    };
+    typedef char HandlersCheck[sizeof(HANDLERS) / sizeof(HANDLERS[0]) == BC_OPCODES_COUNT ? 1 : -1];
+    (void)sizeof(HandlersCheck);
+    Load(HANDLERS);
+#else
+    Load(NULL);
+#endif
+    unsigned char* base = &memory[0];
+    unsigned char* stack_limit = base + program.globals_size + program.main_temps_size;
+    unsigned char* fp = base;
+    unsigned char* sp = stack_limit + VM_STACK_SIZE;
+    const Instr* pc = &code[0];
+    frames.clear();
+#ifdef __GNUC__
+    VM_DISPATCH();
+#else
+dispatch:
+    switch (pc->op)
+    {
+#endif
+    VM_OP(BC_MOV)
+        REG(pc->a) = REG(pc->b);
+        VM_NEXT();
+    VM_OP(BC_LDI)
+    VM_OP(BC_LDS)
+        REG(pc->a).i = pc->b;
+        VM_NEXT();
+    VM_OP(BC_LDG)
+        REG(pc->a) = CELL(base, pc->b);
+        VM_NEXT();
+    VM_OP(BC_STG)
+        CELL(base, pc->a) = REG(pc->b);
+        VM_NEXT();
+    VM_OP(BC_LEA)
+        REG(pc->a).i = fp - base + pc->b;
+        VM_NEXT();
+    VM_OP(BC_LOAD)
+        REG(pc->a) = *(VMCell*)Address(REG(pc->b).i + pc->c, 4);
+        VM_NEXT();
+    VM_OP(BC_STORE)
+        *(VMCell*)Address(REG(pc->a).i + pc->b, 4) = REG(pc->c);
+        VM_NEXT();
+    VM_OP(BC_BMOV)
+        memmove(fp + pc->a, fp + pc->b, pc->c);
+        VM_NEXT();
+    VM_OP(BC_BLOAD)
+        memmove(fp + pc->a, Address(REG(pc->b).i, pc->c), pc->c);
+        VM_NEXT();
+    VM_OP(BC_BSTORE)
+        memmove(Address(REG(pc->a).i, pc->c), fp + pc->b, pc->c);
+        VM_NEXT();
+    VM_OP(BC_ADD)
+        REG(pc->a).i = (unsigned)REG(pc->b).i + (unsigned)REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_ADDI)
+        REG(pc->a).i = (unsigned)REG(pc->b).i + (unsigned)pc->c;
+        VM_NEXT();
+    VM_OP(BC_SUB)
+        REG(pc->a).i = (unsigned)REG(pc->b).i - (unsigned)REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_MUL)
+        REG(pc->a).i = (unsigned)REG(pc->b).i * (unsigned)REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_MULI)
+        REG(pc->a).i = (unsigned)REG(pc->b).i * (unsigned)pc->c;
+        VM_NEXT();
+    VM_OP(BC_DIV)
+        REG(pc->a).i = Divide(REG(pc->b).i, REG(pc->c).i, false);
+        VM_NEXT();
+    VM_OP(BC_MOD)
+        REG(pc->a).i = Divide(REG(pc->b).i, REG(pc->c).i, true);
+        VM_NEXT();
+    VM_OP(BC_AND)
+        REG(pc->a).i = REG(pc->b).i & REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_OR)
+        REG(pc->a).i = REG(pc->b).i | REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_XOR)
+        REG(pc->a).i = REG(pc->b).i ^ REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_SHL)
+        REG(pc->a).i = (unsigned)REG(pc->b).i << (REG(pc->c).i & 31);
+        VM_NEXT();
+    VM_OP(BC_SHR)
+        REG(pc->a).i = REG(pc->b).i >> (REG(pc->c).i & 31);
+        VM_NEXT();
+    VM_OP(BC_EQ)
+        REG(pc->a).i = REG(pc->b).i == REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_NE)
+        REG(pc->a).i = REG(pc->b).i != REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_LT)
+        REG(pc->a).i = REG(pc->b).i < REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_LE)
+        REG(pc->a).i = REG(pc->b).i <= REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_GT)
+        REG(pc->a).i = REG(pc->b).i > REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_GE)
+        REG(pc->a).i = REG(pc->b).i >= REG(pc->c).i;
+        VM_NEXT();
+    VM_OP(BC_NEG)
+        REG(pc->a).i = 0u - (unsigned)REG(pc->b).i;
+        VM_NEXT();
+    VM_OP(BC_NOT)
+        REG(pc->a).i = !REG(pc->b).i;
+        VM_NEXT();
+    VM_OP(BC_FADD)
+        REG(pc->a).f = REG(pc->b).f + REG(pc->c).f;
+        VM_NEXT();
+    VM_OP(BC_FSUB)
+        REG(pc->a).f = REG(pc->b).f - REG(pc->c).f;
+        VM_NEXT();
+    VM_OP(BC_FMUL)
+        REG(pc->a).f = REG(pc->b).f * REG(pc->c).f;
+        VM_NEXT();
+    VM_OP(BC_FDIV)
+        REG(pc->a).f = REG(pc->b).f / REG(pc->c).f;
+        VM_NEXT();
+    VM_OP(BC_FEQ)
+        REG(pc->a).i = !(REG(pc->b).f < REG(pc->c).f || REG(pc->b).f > REG(pc->c).f);
+        VM_NEXT();
+    VM_OP(BC_FNE)
+        REG(pc->a).i = REG(pc->b).f < REG(pc->c).f || REG(pc->b).f > REG(pc->c).f;
+        VM_NEXT();
+    VM_OP(BC_FLT)
+        REG(pc->a).i = !(REG(pc->b).f >= REG(pc->c).f);
+        VM_NEXT();
+    VM_OP(BC_FLE)
+        REG(pc->a).i = !(REG(pc->b).f > REG(pc->c).f);
+        VM_NEXT();
+    VM_OP(BC_FGT)
+        REG(pc->a).i = REG(pc->b).f > REG(pc->c).f;
+        VM_NEXT();
+    VM_OP(BC_FGE)
+        REG(pc->a).i = REG(pc->b).f >= REG(pc->c).f;
+        VM_NEXT();
+    VM_OP(BC_FNEG)
+        REG(pc->a).i = REG(pc->b).i ^ 0x80000000;
+        VM_NEXT();
+    VM_OP(BC_ITOF)
+        REG(pc->a).f = REG(pc->b).i;
+        VM_NEXT();
+    VM_OP(BC_JMP)
+        VM_JUMP(pc->c);
+    VM_OP(BC_JZ)
+        if (REG(pc->a).i) { VM_NEXT(); }
+        VM_JUMP(pc->c);
+    VM_OP(BC_JNZ)
+        if (!REG(pc->a).i) { VM_NEXT(); }
+        VM_JUMP(pc->c);
+    VM_OP(BC_JLE)
+        if (REG(pc->a).i > REG(pc->b).i) { VM_NEXT(); }
+        VM_JUMP(pc->c);
+    VM_OP(BC_JGE)
+        if (REG(pc->a).i < REG(pc->b).i) { VM_NEXT(); }
+        VM_JUMP(pc->c);
+    VM_OP(BC_ARG)
+        CELL(sp, pc->a) = REG(pc->b);
+        VM_NEXT();
+    VM_OP(BC_BARG)
+        memmove(sp + pc->a, fp + pc->b, pc->c);
+        VM_NEXT();
+    VM_OP(BC_CALL)
+    {
+        Frame frame = { pc + 1, fp, sp };
+        frames.push_back(frame);
+        fp = sp - pc->b;
+        sp = fp - pc->c;
+        if (sp < stack_limit) throw CompilerException("stack overflow");
+        VM_JUMP(pc->a);
+    }
+    VM_OP(BC_RES)
+        REG(pc->a) = CELL(sp, pc->b);
+        VM_NEXT();
+    VM_OP(BC_BRES)
+        memmove(fp + pc->a, sp + pc->b, pc->c);
+        VM_NEXT();
+    VM_OP(BC_RET)
+        if (frames.empty()) goto halt;
+        pc = frames.back().pc;
+        fp = frames.back().fp;
+        sp = frames.back().sp;
+        frames.pop_back();
+        VM_DISPATCH();
+    VM_OP(BC_WRITEI)
+        printf("%d", REG(pc->a).i);
+        VM_NEXT();
+    VM_OP(BC_WRITEF)
+        printf("%f", (double)REG(pc->a).f);
+        VM_NEXT();
+    VM_OP(BC_WRITES)
+        printf("%s", (const char*)Address(REG(pc->a).i, 1));
+        VM_NEXT();
+    VM_OP(BC_WRITELN)
+        printf("\n");
+        VM_NEXT();
+#ifndef __GNUC__
+        default:
+        break;
+    }
+#endif
+halt:
+    fflush(stdout);
+}
@@ -0,0 +1,32 @@
+#ifndef VM
+#define VM
+
+#include "bytecode.h"
+#include <vector>
+
+class VirtualMachine{
+private:
+    struct Instr{
+        const void* handler;
+        BCOpcode op;
+        int a;
+        int b;
+        int c;
+    };
+    struct Frame{
+        const Instr* pc;
+        unsigned char* fp;
+        unsigned char* sp;
+    };
+    const BCProgram& program;
+    std::vector<unsigned char> memory;
+    std::vector<Instr> code;
+    std::vector<Frame> frames;
+    void Load(const void* const* handlers);
+    unsigned char* Address(int addr, unsigned size);
+public:
+    VirtualMachine(const BCProgram& program_);
+    void Run();
+};
+
+#endif